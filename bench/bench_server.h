@@ -0,0 +1,112 @@
+// Helpers for the benchmarks that start a real messenger process and drive it
+// over HTTP. The server is started with MESSENGER_TOKEN_SECRET set, so the
+// bench can mint valid access tokens instead of logging in.
+#pragma once
+
+#include "common/auth_middleware.h"
+#include "common/token_signer.h"
+#include <httplib.h>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace bench {
+
+constexpr const char* kTokenSecret = "messenger-bench-secret";
+
+struct ProcessUsage {
+    size_t threads;
+    size_t rss_kb;
+};
+
+// Must run before minting tokens
+inline void use_server_key() {
+    TokenSigner::instance().add_key("default", kTokenSecret);
+}
+
+inline std::string mint_token(const std::string& username) {
+    return AuthMiddleware::generate_jwt_token(username, "bench-" + username);
+}
+
+inline pid_t start_server(const char* binary, const std::vector<std::string>& args) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+        const int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        setenv("MESSENGER_TOKEN_SECRET", kTokenSecret, 1);
+
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(binary));
+        for (const auto& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        execv(binary, argv.data());
+        std::_Exit(127);
+    }
+    return pid;
+}
+
+inline bool wait_until_healthy(int port, std::chrono::seconds timeout) {
+    httplib::Client client("localhost", port);
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        auto result = client.Get("/health", {});
+        if (result && result->status == 200) {
+            // Give the other listeners (and workers) a moment as well
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
+inline void stop_server(pid_t pid) {
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+}
+
+// Threads and resident memory of one process, from /proc/<pid>/status
+inline ProcessUsage process_usage(pid_t pid) {
+    ProcessUsage usage{0, 0};
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string key;
+    while (status >> key) {
+        if (key == "Threads:") {
+            status >> usage.threads;
+        } else if (key == "VmRSS:") {
+            status >> usage.rss_kb;
+        }
+        status.ignore(256, '\n');
+    }
+    return usage;
+}
+
+inline double percentile(std::vector<double> samples, double fraction) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    const size_t index = std::min(samples.size() - 1, static_cast<size_t>(fraction * static_cast<double>(samples.size())));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<long>(index), samples.end());
+    return samples[index];
+}
+
+template <typename Fn>
+double milliseconds(Fn&& fn) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace bench
@@ -0,0 +1,129 @@
+// The four-port layout against `messenger --gateway`: threads and resident
+// memory when idle and after load, the latency of a keep-alive request, and a
+// client start-up that touches every service on fresh connections (four
+// connections on four ports, or one on the gateway). The bench starts and
+// stops the server itself. Build with -DMESSENGER_BUILD_BENCHMARKS=ON.
+//
+//   gateway_layout_bench ./messenger [rounds=2000]
+#include "bench_server.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int kGatewayPort = 8080;
+
+struct Layout {
+    const char* name;
+    std::vector<std::string> args;
+    // Port for each of auth, users, messages and websocket
+    int ports[4];
+};
+
+struct LayoutResult {
+    bench::ProcessUsage idle;
+    bench::ProcessUsage loaded;
+    std::vector<double> request_ms;
+    std::vector<double> startup_ms;
+};
+
+// What the web client does on load: one call to each service
+struct Call {
+    int service;
+    const char* method;
+    const char* path;
+};
+constexpr Call kStartupCalls[] = {
+    {0, "POST", "/api/auth/verify"},
+    {1, "GET", "/api/users/profile"},
+    {2, "GET", "/api/conversations"},
+    {3, "GET", "/api/websocket/online"},
+};
+
+bool run_call(httplib::Client& client, const Call& call, const httplib::Headers& headers) {
+    auto result = std::string(call.method) == "GET" ? client.Get(call.path, headers)
+                                                    : client.Post(call.path, headers, "", "application/json");
+    return result && result->status == 200;
+}
+
+LayoutResult run_layout(const char* binary, const Layout& layout, size_t rounds, size_t& failures) {
+    LayoutResult result{};
+    const pid_t server = bench::start_server(binary, layout.args);
+    if (server < 0 || !bench::wait_until_healthy(layout.ports[0], std::chrono::seconds(15))) {
+        std::fprintf(stderr, "%s layout did not come up\n", layout.name);
+        if (server > 0) {
+            bench::stop_server(server);
+        }
+        ++failures;
+        return result;
+    }
+    result.idle = bench::process_usage(server);
+
+    const httplib::Headers headers = {{"Authorization", "Bearer " + bench::mint_token("alice")}};
+
+    // Steady state: one keep-alive connection, the same read over and over
+    httplib::Client client("localhost", layout.ports[2]);
+    client.set_keep_alive(true);
+    for (size_t i = 0; i < rounds; ++i) {
+        result.request_ms.push_back(bench::milliseconds([&] {
+            failures += run_call(client, kStartupCalls[2], headers) ? 0 : 1;
+        }));
+    }
+
+    // Start-up: fresh connections, one client per distinct port
+    for (size_t i = 0; i < rounds / 10; ++i) {
+        result.startup_ms.push_back(bench::milliseconds([&] {
+            std::vector<std::pair<int, std::unique_ptr<httplib::Client>>> clients;
+            for (const auto& call : kStartupCalls) {
+                const int port = layout.ports[call.service];
+                auto it = std::find_if(clients.begin(), clients.end(), [&](const auto& c) { return c.first == port; });
+                if (it == clients.end()) {
+                    clients.emplace_back(port, std::make_unique<httplib::Client>("localhost", port));
+                    clients.back().second->set_keep_alive(true);
+                    it = clients.end() - 1;
+                }
+                failures += run_call(*it->second, call, headers) ? 0 : 1;
+            }
+        }));
+    }
+
+    result.loaded = bench::process_usage(server);
+    bench::stop_server(server);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <messenger binary> [rounds]\n", argv[0]);
+        return 2;
+    }
+    const char* binary = argv[1];
+    const size_t rounds = argc > 2 ? static_cast<size_t>(std::max(10, std::atoi(argv[2]))) : 2000;
+
+    bench::use_server_key();
+
+    const Layout layouts[] = {
+        {"four-port", {}, {8001, 8002, 8003, 8004}},
+        {"gateway", {"--gateway", std::to_string(kGatewayPort)}, {kGatewayPort, kGatewayPort, kGatewayPort, kGatewayPort}},
+    };
+
+    std::printf("%10s %8s %10s %8s %10s %10s %10s %12s %12s\n", "layout", "threads", "rss KiB",
+                "threads*", "rss KiB*", "req p50", "req p99", "startup p50", "startup p99");
+    size_t failures = 0;
+    for (const auto& layout : layouts) {
+        const LayoutResult result = run_layout(binary, layout, rounds, failures);
+        std::printf("%10s %8zu %10zu %8zu %10zu %8.3fms %8.3fms %10.3fms %10.3fms\n", layout.name,
+                    result.idle.threads, result.idle.rss_kb, result.loaded.threads, result.loaded.rss_kb,
+                    bench::percentile(result.request_ms, 0.50), bench::percentile(result.request_ms, 0.99),
+                    bench::percentile(result.startup_ms, 0.50), bench::percentile(result.startup_ms, 0.99));
+    }
+    std::printf("* after the run; %zu failed requests\n", failures);
+    return failures == 0 ? 0 : 1;
+}
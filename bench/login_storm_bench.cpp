@@ -0,0 +1,184 @@
+// Message-send latency with and without a login storm, in the four-port layout
+// and in gateway mode. Logins come from many loopback addresses (127.0.0.2 and
+// up), so the per-address login rate limit doesn't absorb the storm before it
+// reaches the password hasher. Sends are paced under their own rate limits.
+// Build with -DMESSENGER_BUILD_BENCHMARKS=ON.
+//
+//   login_storm_bench ./messenger [seconds=10] [gateway threads=4]
+#include "bench_server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kGatewayPort = 8080;
+constexpr size_t kSenders = 20;          // Each sends twice a second: well under both send limits
+constexpr auto kSendInterval = std::chrono::milliseconds(500);
+constexpr size_t kStormThreads = 64;
+
+struct PhaseResult {
+    std::vector<double> send_ms;
+    size_t send_errors;
+    std::map<int, size_t> login_statuses;  // 0 when the connection failed
+};
+
+// One login over a fresh connection from the given source address; returns the HTTP status
+int raw_login(int port, uint32_t source_address) {
+    const int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return 0;
+    }
+
+    sockaddr_in source{};
+    source.sin_family = AF_INET;
+    source.sin_addr.s_addr = htonl(source_address);
+    sockaddr_in server{};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(static_cast<uint16_t>(port));
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int status = 0;
+    if (bind(sock, reinterpret_cast<sockaddr*>(&source), sizeof(source)) == 0 &&
+        connect(sock, reinterpret_cast<sockaddr*>(&server), sizeof(server)) == 0) {
+        const std::string body = R"({"username":"alice","password":"not-the-password"})";
+        const std::string request = "POST /api/auth/login HTTP/1.1\r\nHost: localhost\r\n"
+                                    "Content-Type: application/json\r\nConnection: close\r\n"
+                                    "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        if (send(sock, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size())) {
+            char buffer[64] = {};
+            const ssize_t received = recv(sock, buffer, sizeof(buffer) - 1, 0);
+            if (received > 12 && std::strncmp(buffer, "HTTP/1.1 ", 9) == 0) {
+                status = std::atoi(buffer + 9);
+            }
+        }
+    }
+    close(sock);
+    return status;
+}
+
+PhaseResult run_phase(int auth_port, int message_port, std::chrono::seconds duration, bool storm) {
+    PhaseResult result{};
+    std::mutex result_mutex;
+    std::atomic<bool> running{true};
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < kSenders; ++i) {
+        threads.emplace_back([&, i] {
+            httplib::Client client("localhost", message_port);
+            client.set_keep_alive(true);
+            const httplib::Headers headers = {{"Authorization", "Bearer " + bench::mint_token("sender" + std::to_string(i))}};
+            const std::string body = R"({"to_user":"reader)" + std::to_string(i) + R"(","content":"hello"})";
+
+            std::vector<double> latencies;
+            size_t errors = 0;
+            auto next = std::chrono::steady_clock::now();
+            while (running.load(std::memory_order_relaxed)) {
+                bool sent = false;
+                latencies.push_back(bench::milliseconds([&] {
+                    auto response = client.Post("/api/messages/send", headers, body, "application/json");
+                    sent = response && response->status == 201;
+                }));
+                errors += sent ? 0 : 1;
+                next += kSendInterval;
+                std::this_thread::sleep_until(next);
+            }
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+            result.send_ms.insert(result.send_ms.end(), latencies.begin(), latencies.end());
+            result.send_errors += errors;
+        });
+    }
+
+    if (storm) {
+        for (size_t i = 0; i < kStormThreads; ++i) {
+            threads.emplace_back([&, i] {
+                std::map<int, size_t> statuses;
+                // 127.0.0.2 - 127.0.0.254, spread over the threads
+                uint32_t host = 2 + static_cast<uint32_t>(i);
+                while (running.load(std::memory_order_relaxed)) {
+                    ++statuses[raw_login(auth_port, (127u << 24) | host)];
+                    host = host >= 254 ? 2 : host + 1;
+                }
+
+                std::lock_guard<std::mutex> lock(result_mutex);
+                for (const auto& [status, count] : statuses) {
+                    result.login_statuses[status] += count;
+                }
+            });
+        }
+    }
+
+    std::this_thread::sleep_for(duration);
+    running = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return result;
+}
+
+void print_phase(const char* layout, const char* phase, const PhaseResult& result) {
+    std::string logins;
+    for (const auto& [status, count] : result.login_statuses) {
+        logins += " " + std::to_string(status) + ":" + std::to_string(count);
+    }
+    std::printf("%10s %8s %8zu %10.2f %10.2f %10.2f %8zu  %s\n", layout, phase, result.send_ms.size(),
+                bench::percentile(result.send_ms, 0.50), bench::percentile(result.send_ms, 0.99),
+                bench::percentile(result.send_ms, 1.0), result.send_errors, logins.empty() ? "-" : logins.c_str());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <messenger binary> [seconds] [gateway threads]\n", argv[0]);
+        return 2;
+    }
+    const char* binary = argv[1];
+    const std::chrono::seconds duration(argc > 2 ? std::max(1, std::atoi(argv[2])) : 10);
+    const std::string gateway_threads = argc > 3 ? argv[3] : "4";
+
+    bench::use_server_key();
+
+    struct Layout {
+        const char* name;
+        std::vector<std::string> args;
+        int auth_port;
+        int message_port;
+    };
+    const Layout layouts[] = {
+        {"four-port", {}, 8001, 8003},
+        {"gateway", {"--gateway", std::to_string(kGatewayPort), "--gateway-threads", gateway_threads},
+         kGatewayPort, kGatewayPort},
+    };
+
+    std::printf("%10s %8s %8s %10s %10s %10s %8s  %s\n", "layout", "phase", "sends", "p50 ms", "p99 ms",
+                "max ms", "errors", "login statuses");
+    for (const auto& layout : layouts) {
+        const pid_t server = bench::start_server(binary, layout.args);
+        if (server < 0 || !bench::wait_until_healthy(layout.message_port, std::chrono::seconds(15))) {
+            std::fprintf(stderr, "%s layout did not come up\n", layout.name);
+            if (server > 0) {
+                bench::stop_server(server);
+            }
+            return 1;
+        }
+
+        print_phase(layout.name, "quiet", run_phase(layout.auth_port, layout.message_port, duration, false));
+        print_phase(layout.name, "storm", run_phase(layout.auth_port, layout.message_port, duration, true));
+        bench::stop_server(server);
+    }
+    return 0;
+}
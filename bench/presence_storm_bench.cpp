@@ -0,0 +1,137 @@
+// Presence traffic during a reconnect storm: the events the old per-transition
+// broadcast sent against the digest events PresenceTracker lets out, for a few
+// grace periods. Build with -DMESSENGER_BUILD_BENCHMARKS=ON.
+#include "data/connection_manager.h"
+#include "data/contact_graph.h"
+#include "data/presence_tracker.h"
+#include "data/user_id_interner.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr size_t kUsers = 1000;
+constexpr size_t kContactsPerSide = 10;   // Mutual contacts with the 10 users on either side
+constexpr size_t kRounds = 20;
+constexpr size_t kFlappersPerRound = 300;
+constexpr size_t kLeavers = 50;           // Drop for good at the end of the storm
+constexpr std::chrono::milliseconds kDigestInterval{20};
+
+struct StormResult {
+    size_t raw_transitions;
+    size_t broadcast_events;  // One per online contact per raw transition
+    size_t published_changes;
+    size_t digest_events;     // One per online contact per digest
+};
+
+StormResult run_storm(std::chrono::milliseconds grace_period) {
+    auto user_ids = std::make_shared<UserIdInterner>();
+    ContactGraph contacts(user_ids);
+    ConnectionManager connections(user_ids);
+    PresenceTracker tracker(grace_period);
+
+    std::vector<std::string> users;
+    for (size_t i = 0; i < kUsers; ++i) {
+        users.push_back("user" + std::to_string(i));
+    }
+    for (size_t i = 0; i < kUsers; ++i) {
+        for (size_t d = 1; d <= kContactsPerSide; ++d) {
+            contacts.add_contact(users[i], users[(i + d) % kUsers]);
+            contacts.add_contact(users[i], users[(i + kUsers - d) % kUsers]);
+        }
+    }
+
+    StormResult result{};
+    std::vector<std::string> transitions;
+    connections.set_presence_listener([&](const std::string& user_id, bool is_connected) {
+        tracker.on_connection_state(user_id, is_connected);
+        transitions.push_back(user_id);
+    });
+
+    // What the old code did: every transition straight to every online mutual contact
+    auto broadcast = [&] {
+        for (const auto& user : transitions) {
+            result.broadcast_events += connections.filter_online_users(contacts.get_mutual_contacts(user)).size();
+        }
+        transitions.clear();
+    };
+
+    // What publish_presence_digest does: one event per online contact per digest
+    auto digest = [&] {
+        std::unordered_map<std::string, size_t> recipients;
+        for (const auto& change : tracker.collect_digest()) {
+            for (const auto& contact : connections.filter_online_users(contacts.get_mutual_contacts(change.user_id))) {
+                ++recipients[contact];
+            }
+        }
+        tracker.record_delivery(recipients.size());
+    };
+
+    std::unordered_map<std::string, uint64_t> connection_of;
+    for (const auto& user : users) {
+        connection_of[user] = connections.add_connection(user);
+    }
+    broadcast();
+    digest();
+
+    // Each round a block of users drops, stays away for one to three digest intervals and comes back
+    for (size_t round = 0; round < kRounds; ++round) {
+        const size_t first = (round * 37) % kUsers;
+        for (size_t i = 0; i < kFlappersPerRound; ++i) {
+            connections.remove_connection(connection_of[users[(first + i) % kUsers]]);
+        }
+        broadcast();
+        for (size_t tick = 0; tick <= round % 3; ++tick) {
+            std::this_thread::sleep_for(kDigestInterval);
+            digest();
+        }
+        for (size_t i = 0; i < kFlappersPerRound; ++i) {
+            const auto& user = users[(first + i) % kUsers];
+            connection_of[user] = connections.add_connection(user);
+        }
+        broadcast();
+        std::this_thread::sleep_for(kDigestInterval);
+        digest();
+    }
+
+    for (size_t i = 0; i < kLeavers; ++i) {
+        connections.remove_connection(connection_of[users[i * (kUsers / kLeavers)]]);
+    }
+    broadcast();
+    std::this_thread::sleep_for(grace_period + kDigestInterval);
+    digest();
+
+    const json stats = tracker.get_stats();
+    result.raw_transitions = stats["raw_transitions"].get<size_t>();
+    result.published_changes = stats["published_changes"].get<size_t>();
+    result.digest_events = stats["digest_events"].get<size_t>();
+    return result;
+}
+
+} // namespace
+
+int main() {
+    std::printf("users: %zu, mutual contacts: %zu each, rounds: %zu x %zu flapping, digest every %lld ms\n",
+                kUsers, 2 * kContactsPerSide, kRounds, kFlappersPerRound,
+                static_cast<long long>(kDigestInterval.count()));
+    std::printf("%8s %16s %16s %18s %14s %10s\n",
+                "grace", "raw_transitions", "broadcast_events", "published_changes", "digest_events", "reduction");
+
+    bool leavers_seen = true;
+    for (auto grace : {std::chrono::milliseconds(0), std::chrono::milliseconds(50), std::chrono::milliseconds(100)}) {
+        const StormResult result = run_storm(grace);
+        std::printf("%6lldms %16zu %16zu %18zu %14zu %9.1fx\n", static_cast<long long>(grace.count()),
+                    result.raw_transitions, result.broadcast_events, result.published_changes,
+                    result.digest_events,
+                    static_cast<double>(result.broadcast_events) /
+                        static_cast<double>(result.digest_events == 0 ? 1 : result.digest_events));
+        // Whatever the grace period, the users who really left must still be announced
+        leavers_seen = leavers_seen && result.published_changes >= kLeavers;
+    }
+    return leavers_seen ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+// Per-message cost of TextScanner::scan for each kernel, on 1000-character
+// messages in three scripts. Build with -DMESSENGER_BUILD_BENCHMARKS=ON.
+#include "common/text_scanner.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+constexpr size_t kCharacters = 1000;
+constexpr size_t kIterations = 20000;
+
+std::string repeat(const std::string& piece, size_t characters) {
+    std::string text;
+    for (size_t i = 0; i < characters; ++i) {
+        text += piece;
+    }
+    return text;
+}
+
+} // namespace
+
+int main() {
+    const std::pair<const char*, std::string> inputs[] = {
+        {"ascii", repeat("a", kCharacters)},
+        {"cyrillic", repeat("\xD0\xB6", kCharacters)},
+        {"emoji", repeat("\xF0\x9F\x98\x80", kCharacters)}
+    };
+    const char* const kernels[] = {"scalar", "ssse3", "avx2"};
+
+    std::printf("%-10s", "");
+    for (const char* kernel : kernels) {
+        std::printf("%12s", kernel);
+    }
+    std::printf("   (ns per %zu-character message; active: %s)\n", kCharacters, TextScanner::implementation());
+
+    size_t checksum = 0;
+    for (const auto& [name, text] : inputs) {
+        std::printf("%-10s", name);
+        for (const char* kernel : kernels) {
+            if (!TextScanner::scan_using(kernel, text)) {
+                std::printf("%12s", "n/a");
+                continue;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < kIterations; ++i) {
+                checksum += TextScanner::scan_using(kernel, text)->code_points;
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            std::printf("%12.1f", std::chrono::duration<double, std::nano>(elapsed).count() / kIterations);
+        }
+        std::printf("\n");
+    }
+    return checksum == 0 ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// Throughput of `messenger --workers N` for N = 1, 2, 4, ... up to the core count.
+// The bench starts and stops the server itself; pass the path of the messenger
+// binary. Clients read the last page of their own direct conversation, which is
+// partitioned by conversation id, so most requests take the forwarding hop a
+// real client would. The load runs on the same machine, which caps what the
+// largest N can show. Build with -DMESSENGER_BUILD_BENCHMARKS=ON.
+//
+//   worker_scaling_bench ./messenger [seconds=10] [clients=64]
+#include "bench_server.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kMessagePort = 8003;
+
+struct RunResult {
+    size_t requests;
+    size_t errors;
+    double requests_per_second;
+    double p50_ms;
+    double p99_ms;
+};
+
+RunResult run_load(size_t clients, std::chrono::seconds duration) {
+    // Tokens signed with the server's key; pairs of clients share a conversation
+    std::vector<std::string> tokens;
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < clients; ++i) {
+        const std::string user = "bench" + std::to_string(i);
+        const std::string peer = "bench" + std::to_string(i ^ 1);
+        tokens.push_back(bench::mint_token(user));
+        paths.push_back("/api/conversations/conv_" + std::min(user, peer) + "_" + std::max(user, peer) +
+                        "/messages?limit=20");
+    }
+
+    httplib::Client setup("localhost", kMessagePort);
+    for (size_t i = 0; i < clients; i += 2) {
+        const httplib::Headers headers = {{"Authorization", "Bearer " + tokens[i]}};
+        const std::string body = R"({"to_user":"bench)" + std::to_string(i + 1) + R"(","content":"hello"})";
+        setup.Post("/api/messages/send", headers, body, "application/json");
+    }
+
+    std::atomic<bool> running{true};
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<size_t> errors(clients, 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i] {
+            httplib::Client client("localhost", kMessagePort);
+            client.set_keep_alive(true);
+            const httplib::Headers headers = {{"Authorization", "Bearer " + tokens[i]}};
+            while (running.load(std::memory_order_relaxed)) {
+                const auto start = std::chrono::steady_clock::now();
+                auto result = client.Get(paths[i], headers);
+                const auto elapsed = std::chrono::steady_clock::now() - start;
+                if (result && result->status == 200) {
+                    latencies[i].push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+                } else {
+                    ++errors[i];
+                }
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    running = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<double> all;
+    RunResult result{};
+    for (size_t i = 0; i < clients; ++i) {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        result.errors += errors[i];
+    }
+    result.requests = all.size();
+    result.requests_per_second = static_cast<double>(all.size()) / static_cast<double>(duration.count());
+    result.p50_ms = bench::percentile(all, 0.50);
+    result.p99_ms = bench::percentile(all, 0.99);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <messenger binary> [seconds] [clients]\n", argv[0]);
+        return 2;
+    }
+    const char* binary = argv[1];
+    const std::chrono::seconds duration(argc > 2 ? std::max(1, std::atoi(argv[2])) : 10);
+    const size_t clients = argc > 3 ? static_cast<size_t>(std::max(2, std::atoi(argv[3]))) & ~size_t{1} : 64;
+    const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    bench::use_server_key();
+
+    std::vector<int> worker_counts;
+    for (int workers = 1; workers < cores; workers *= 2) {
+        worker_counts.push_back(workers);
+    }
+    worker_counts.push_back(cores);
+
+    std::printf("cores: %d, clients: %zu, %lld s per run\n", cores, clients, static_cast<long long>(duration.count()));
+    std::printf("%8s %12s %10s %10s %10s %8s\n", "workers", "requests/s", "p50 ms", "p99 ms", "errors", "scaling");
+
+    double baseline = 0.0;
+    for (int workers : worker_counts) {
+        const pid_t server = bench::start_server(binary, {"--workers", std::to_string(workers)});
+        if (server < 0 || !bench::wait_until_healthy(kMessagePort, std::chrono::seconds(15))) {
+            std::fprintf(stderr, "messenger --workers %d did not come up\n", workers);
+            if (server > 0) {
+                bench::stop_server(server);
+            }
+            return 1;
+        }
+
+        const RunResult result = run_load(clients, duration);
+        bench::stop_server(server);
+
+        if (baseline == 0.0) {
+            baseline = result.requests_per_second;
+        }
+        std::printf("%8d %12.0f %10.2f %10.2f %10zu %7.2fx\n", workers, result.requests_per_second,
+                    result.p50_ms, result.p99_ms, result.errors,
+                    baseline > 0.0 ? result.requests_per_second / baseline : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Bounds concurrent work for a service and for individual routes. Requests
+// beyond the current limit wait in a bounded queue until their deadline;
+// anything else is shed immediately. Each limit adapts AIMD-style to the
+// latency it observes: it grows by one per window of fast completions and
+// shrinks by 10% when requests run slower than the target.
+class AdmissionController {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Limits {
+        size_t max_concurrency;
+        size_t min_concurrency;
+        size_t max_queue;
+        std::chrono::milliseconds deadline;
+        std::chrono::milliseconds target_latency;
+    };
+
+    static Limits default_limits();
+
+    // Handle for an admitted request; gates are released when it completes
+    struct Ticket {
+        std::vector<size_t> gates;
+        Clock::time_point started_at;
+        Clock::time_point deadline;
+    };
+
+    explicit AdmissionController(Limits service_limits = default_limits());
+
+    // Routes are matched by path prefix; must be configured before the service starts
+    void set_route_limits(const std::string& path_prefix, Limits limits);
+
+    // Waits (bounded by the deadline) for a slot. Returns false when the request must be shed.
+    bool admit(const std::string& path, std::chrono::milliseconds requested_deadline, Ticket& ticket);
+    // Route gate only, for work nested in a request that already holds a service-wide slot.
+    // Admits right away when no route limit covers the path.
+    bool admit_route(const std::string& path, std::chrono::milliseconds requested_deadline, Ticket& ticket);
+    // Latency feeds the route gate when there is one, otherwise the service-wide gate
+    void complete(const Ticket& ticket);
+
+    int retry_after_seconds() const;
+    json get_stats();
+
+private:
+    struct Gate {
+        std::string prefix;
+        Limits limits;
+        double limit;
+        size_t in_flight;
+        size_t waiting;
+        Clock::time_point last_decrease;
+
+        size_t admitted;
+        size_t shed;
+        size_t timed_out;
+        size_t deadline_exceeded;
+
+        std::mutex mutex;
+        std::condition_variable slot_freed;
+    };
+
+    size_t route_gate_for(const std::string& path) const;
+    void start_ticket(size_t gate, std::chrono::milliseconds requested_deadline, Ticket& ticket) const;
+    static std::unique_ptr<Gate> make_gate(const std::string& prefix, const Limits& limits);
+    bool acquire(Gate& gate, Clock::time_point deadline);
+    void release(Gate& gate, std::chrono::nanoseconds latency);
+
+    // gates_[0] is the whole service, the rest are per-route
+    std::vector<std::unique_ptr<Gate>> gates_;
+};
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "common/token_signer.h"
+#include "data/session_store.h"
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include <memory>
+#include <optional>
 #include <string>
 
 using json = nlohmann::json;
@@ -11,14 +15,45 @@ public:
     struct AuthResult {
         bool is_valid;
         std::string username;
+        std::string session_id;
         std::string error_message;
     };
 
+    static constexpr int64_t kAccessTokenTtlSeconds = 3600;
+
+    // While alive on this thread, requests carrying the given Authorization header get `result`
+    // without re-verifying the signature (sub-requests of a batch that was validated once).
+    // Revocation is still checked on every request.
+    class ValidatedScope {
+    public:
+        ValidatedScope(const std::string& authorization, const AuthResult& result);
+        ~ValidatedScope();
+
+        ValidatedScope(const ValidatedScope&) = delete;
+        ValidatedScope& operator=(const ValidatedScope&) = delete;
+
+    private:
+        friend class AuthMiddleware;
+        const std::string& authorization_;
+        const AuthResult& result_;
+        const ValidatedScope* previous_;
+    };
+
     static AuthResult validate_token(const httplib::Request& req);
-    static std::string generate_jwt_token(const std::string& username);
+    static std::string generate_jwt_token(const std::string& username, const std::string& session_id);
     static bool verify_jwt_token(const std::string& token);
     static std::string extract_username_from_token(const std::string& token);
 
+    // Signature check (served from the verified-token cache when the token was seen before),
+    // then the session revocation check
+    static std::optional<TokenSigner::Claims> verify_token(const std::string& token);
+    static json get_token_cache_stats();
+
+    // Set once at startup, before any request is served
+    static void set_session_store(std::shared_ptr<SessionStore> session_store);
+
 private:
+    static std::shared_ptr<SessionStore> session_store_;
+
     static bool validate_credentials(const std::string& username, const std::string& password);
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Unpadded base64url (RFC 4648 section 5), as used in tokens and password hashes
+class Base64Url {
+public:
+    static std::string encode(std::string_view data);
+    static std::optional<std::string> decode(std::string_view data);
+};
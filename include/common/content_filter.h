@@ -0,0 +1,63 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Blocked-term filter for message text. The blocklist is compiled into an
+// Aho-Corasick DFA over byte classes, stored as one flat transition table, so
+// a scan is a single table walk over the content (ASCII case-insensitive).
+// Reloads build a new automaton off to the side and swap it in atomically;
+// scans in flight keep the one they started with.
+class ContentFilter {
+public:
+    ContentFilter();
+
+    // Replaces the blocklist. Returns the number of patterns loaded.
+    size_t load_patterns(const std::vector<std::string>& patterns);
+    // One pattern per line; blank lines and lines starting with '#' are skipped
+    bool load_file(const std::string& path);
+    // Re-reads the last file given to load_file
+    bool reload();
+
+    // The blocked pattern found in the text, if any
+    std::optional<std::string> find_blocked_term(std::string_view text);
+
+    json get_stats() const;
+
+private:
+    struct Automaton {
+        std::array<uint8_t, 256> byte_class{};
+        uint32_t class_count = 1;
+        // Entry (row + class) holds the next state's row offset; kAcceptBit marks accepting states
+        std::vector<uint32_t> transitions;
+        // Pattern index per accepting row offset / class_count
+        std::vector<uint32_t> match;
+        std::vector<std::string> patterns;
+        size_t state_count = 1;
+    };
+
+    static constexpr uint32_t kAcceptBit = 0x80000000u;
+
+    static std::shared_ptr<const Automaton> build(const std::vector<std::string>& patterns);
+
+    std::atomic<std::shared_ptr<const Automaton>> automaton_;
+
+    std::mutex path_mutex_;
+    std::string path_;
+
+    std::atomic<uint64_t> reloads_{0};
+    std::atomic<uint64_t> scanned_{0};
+    std::atomic<uint64_t> blocked_{0};
+    std::atomic<uint64_t> scan_nanoseconds_{0};
+    std::atomic<uint64_t> max_scan_nanoseconds_{0};
+};
@@ -1,8 +1,20 @@
 #pragma once
 #include "common/service_base.h"
+#include "common/admission_controller.h"
+#include "common/rate_limiter.h"
+#include "common/router.h"
+#include "common/worker_cluster.h"
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <regex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -11,12 +23,71 @@ public:
     explicit HttpService(const std::string& service_name, int port);
     virtual ~HttpService() = default;
 
+    // Lets a replacement process bind the same ports while this one drains (hot restart).
+    // Process-wide; must be set before services start.
+    static void set_reuse_port(bool enabled);
+    static bool is_reuse_port_enabled();
+
+    // Gateway mode: the service keeps its handlers and background work but does not listen;
+    // its routes are served by the gateway instead
+    void set_listener_enabled(bool enabled);
+    void register_routes(Router& router);
+    virtual std::vector<std::string> route_prefixes() const;
+
+    // Size of the request worker pool (0 sizes it to the admission limits)
+    void set_worker_threads(size_t worker_threads);
+
+    // Load shedding; must be configured before the service starts
+    void set_admission_limits(const AdmissionController::Limits& limits);
+    const std::vector<std::pair<std::string, AdmissionController::Limits>>& route_limits() const;
+    const std::vector<std::pair<std::string, RateLimiter::Policy>>& rate_policies() const;
+
+    // Body of GET /metrics; services extend it with their own counters
+    virtual json collect_metrics();
+
+    // Validator for a GET route, built from version counters without running the handler.
+    // Returns nullopt when the request can't be tagged (bad token, state held by other workers).
+    using EntityTagFunction = std::function<std::optional<std::string>(const httplib::Request& req,
+                                                                       const std::smatch& match)>;
+    struct EntityTagRoute {
+        std::string pattern;
+        std::regex regex;
+        EntityTagFunction tag;
+    };
+    const std::vector<EntityTagRoute>& entity_tag_routes() const;
+
+    // POST /api/batch runs up to this many sub-requests against the service's routes
+    static constexpr size_t kMaxBatchSize = 20;
+
 protected:
     void on_start() override;
     void on_stop() override;
     void run_service() override;
 
-    virtual void setup_routes() = 0;
+    virtual void setup_routes(Router& router) = 0;
+    // Worker-to-worker endpoints, served on the internal socket only (multi-worker mode)
+    virtual void setup_internal_routes(Router& router);
+
+    // Tighter concurrency limit for routes under a path prefix
+    void limit_route(const std::string& path_prefix, const AdmissionController::Limits& limits);
+    // Per-user / per-address request rate for routes under a path prefix
+    void limit_rate(const std::string& path_prefix, const RateLimiter::Policy& policy);
+    // Strong ETags and If-None-Match handling for GET requests whose path matches the pattern
+    void tag_route(const std::string& pattern, EntityTagFunction tag);
+
+    // Runs before routing on the public listener; returns true when it produced the response
+    virtual bool handle_before_routing(const httplib::Request& req, httplib::Response& res);
+
+    // Multi-worker routing. Called before routing on the public listener; returns true
+    // when the request was answered by (or on behalf of) other workers.
+    virtual bool route_to_worker(const httplib::Request& req, httplib::Response& res);
+    // Key that decides which worker owns the state a request touches
+    virtual std::optional<std::string> partition_key(const httplib::Request& req);
+
+    bool forward_to_owner(const std::string& key, const httplib::Request& req, httplib::Response& res);
+    // For ids that name the worker holding them; false (handle locally) when that's this one
+    bool forward_to_worker(int worker, const httplib::Request& req, httplib::Response& res);
+    std::vector<json> gather_from_workers(const httplib::Request& req);
 
     static void send_json_response(httplib::Response& res, int status, const json& data);
 
@@ -25,8 +96,42 @@ protected:
     httplib::Server& get_server() const { return *server_; }
 
 private:
+    static std::atomic<bool> reuse_port_;
+
     std::unique_ptr<httplib::Server> server_;
+    Router router_;
+    bool listener_enabled_;
+    size_t worker_threads_;
+
+    AdmissionController::Limits admission_limits_;
+    std::vector<std::pair<std::string, AdmissionController::Limits>> route_limits_;
+    std::unique_ptr<AdmissionController> admission_;
+
+    std::vector<std::pair<std::string, RateLimiter::Policy>> rate_policies_;
+    std::unique_ptr<RateLimiter> rate_limiter_;
+
+    std::vector<EntityTagRoute> entity_tag_routes_;
+    std::atomic<uint64_t> tagged_responses_{0};
+    std::atomic<uint64_t> not_modified_responses_{0};
+
+    // The listener's worker pool, borrowed to run batch sub-requests in parallel
+    std::atomic<httplib::TaskQueue*> task_queue_{nullptr};
+    std::atomic<uint64_t> batches_{0};
+    std::atomic<uint64_t> batch_subrequests_{0};
+
+    // Worker-to-worker listener on a Unix socket (multi-worker mode only)
+    std::unique_ptr<httplib::Server> internal_server_;
+    Router internal_router_;
+    std::thread internal_thread_;
 
-    void setup_middleware() const;
+    void configure_listener();
+    void setup_middleware();
+    bool check_rate_limit(const httplib::Request& req, httplib::Response& res);
+    bool admit_request(const httplib::Request& req, httplib::Response& res);
+    bool answer_not_modified(const httplib::Request& req, httplib::Response& res);
+    void handle_batch(const httplib::Request& req, httplib::Response& res);
+    void execute_subrequest(httplib::Request& req, httplib::Response& res);
+    void run_in_parallel(const std::vector<std::function<void()>>& tasks);
+    void complete_request();
     void log_request(const httplib::Request& req, const httplib::Response& res) const;
-};
\ No newline at end of file
+};
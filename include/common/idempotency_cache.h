@@ -0,0 +1,82 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+// Responses to requests that carried an Idempotency-Key, so a client retrying
+// after a timeout gets the original answer instead of a second write. Keys are
+// scoped to the user and remembered for a fixed TTL in bounded, sharded FIFOs
+// (one TTL means insertion order is expiry order). A key is claimed before the
+// request runs; retries arriving while it is still running wait for it.
+class IdempotencyCache {
+public:
+    struct StoredResponse {
+        int status;
+        std::string body;
+        std::string content_type;
+    };
+
+    struct Claim {
+        enum class Kind {
+            Owner,     // First to use the key: run the request, then complete() or abandon()
+            Replay,    // Already answered; response holds the answer
+            Mismatch,  // Key was used for a different request
+            Busy       // Still running after the wait ran out
+        } kind;
+        StoredResponse response;
+    };
+
+    static constexpr int64_t kDefaultTtlSeconds = 24 * 60 * 60;
+    static constexpr std::chrono::milliseconds kInFlightWait{5000};
+
+    explicit IdempotencyCache(size_t capacity_per_shard = 4096, int64_t ttl_seconds = kDefaultTtlSeconds);
+
+    // fingerprint identifies the request (route and body), so a reused key can't replay the wrong answer
+    Claim claim(const std::string& username, const std::string& key, uint64_t fingerprint, int64_t now);
+    void complete(const std::string& username, const std::string& key, StoredResponse response);
+    // The request failed in a way worth retrying; forget the key and wake anyone waiting on it
+    void abandon(const std::string& username, const std::string& key);
+
+    json get_stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t fingerprint;
+        int64_t expires_at;
+        bool done;
+        StoredResponse response;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::condition_variable settled;
+        std::list<Entry> entries;  // Oldest first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    };
+
+    static constexpr size_t kShardCount = 16;
+
+    static std::string scoped_key(const std::string& username, const std::string& key);
+    Shard& shard_for(const std::string& scoped);
+    void evict(Shard& shard, int64_t now);
+
+    const size_t capacity_per_shard_;
+    const int64_t ttl_seconds_;
+    std::array<Shard, kShardCount> shards_;
+
+    std::atomic<uint64_t> stored_{0};
+    std::atomic<uint64_t> replays_{0};
+    std::atomic<uint64_t> waits_{0};
+    std::atomic<uint64_t> mismatches_{0};
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <iostream>
 #include <string>
 #include <chrono>
@@ -20,7 +21,12 @@ public:
     static void error(const std::string& message);
     static void debug(const std::string& message);
 
+    static void set_debug_enabled(bool enabled);
+    static bool is_debug_enabled();
+
 private:
+    static std::atomic<bool> debug_enabled_;
+
     static std::string get_current_time();
     static std::string level_to_string(Level level);
 };
@@ -28,4 +34,4 @@ private:
 #define LOG_INFO(msg) Logger::info(msg)
 #define LOG_WARNING(msg) Logger::warning(msg)
 #define LOG_ERROR(msg) Logger::error(msg)
-#define LOG_DEBUG(msg) Logger::debug(msg)
\ No newline at end of file
+#define LOG_DEBUG(msg) do { if (Logger::is_debug_enabled()) Logger::debug(msg); } while (0)
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+// PBKDF2-HMAC-SHA256 password hashing on its own small thread pool, so a
+// login burst is capped at `threads` cores instead of taking over the HTTP
+// workers. The queue is bounded: when it is full, submissions fail
+// immediately and the caller answers 503.
+//
+// Hashes are stored as "pbkdf2-sha256$<iterations>$<salt>$<hash>" (base64url),
+// so verifying a hash made with older parameters still works and reports that
+// it should be rehashed.
+class PasswordHasher {
+public:
+    struct Options {
+        uint32_t iterations = 60000;
+        size_t salt_bytes = 16;
+        size_t threads = 2;
+        size_t max_queue = 64;
+    };
+
+    struct VerifyResult {
+        bool matches;
+        // Set when the password matched but was hashed with other parameters
+        std::optional<std::string> rehashed;
+    };
+
+    explicit PasswordHasher(Options options);
+    ~PasswordHasher();
+
+    // std::nullopt means the queue is full
+    std::optional<std::future<std::string>> hash_async(std::string password);
+    std::optional<std::future<VerifyResult>> verify_async(std::string password, std::string encoded_hash);
+
+    // Synchronous variants for seeding data at startup
+    std::string hash(const std::string& password) const;
+    VerifyResult verify(const std::string& password, const std::string& encoded_hash) const;
+
+    const Options& get_options() const { return options_; }
+    json get_stats();
+
+private:
+    bool submit(std::function<void()> job);
+    void worker_loop();
+
+    const Options options_;
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> queue_;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    bool stopping_;
+
+    std::atomic<size_t> running_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> busy_microseconds_{0};
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Token buckets keyed by user and by client address, one set per route policy.
+// Each bucket is a single atomic word in GCRA form (the time at which the bucket
+// will be full again), so refill is lazy and a check is one CAS. A bucket that
+// has fully refilled carries no state and is dropped by the shard sweep.
+class RateLimiter {
+public:
+    struct Policy {
+        double requests_per_second;
+        double burst;
+        bool per_user;
+        bool per_address;
+    };
+
+    struct Decision {
+        bool allowed;
+        std::chrono::milliseconds retry_after;
+    };
+
+    RateLimiter() = default;
+
+    // Every policy whose path prefix matches applies; must be configured before the service starts
+    void add_policy(const std::string& path_prefix, const Policy& policy);
+    bool has_policies() const { return !policies_.empty(); }
+
+    // username may be empty for unauthenticated requests
+    Decision check(const std::string& path, const std::string& username, const std::string& address);
+
+    json get_stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct CompiledPolicy {
+        std::string prefix;
+        Policy policy;
+        int64_t emission_interval_ns;  // time to earn one token
+        int64_t tolerance_ns;          // burst window
+    };
+
+    struct Bucket {
+        std::atomic<int64_t> full_at_ns{0};
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<uint64_t, std::unique_ptr<Bucket>> buckets;
+        size_t inserts_since_sweep = 0;
+    };
+
+    static constexpr size_t kShardCount = 64;
+    static constexpr size_t kSweepEvery = 1024;
+
+    bool take(const CompiledPolicy& policy, uint64_t key, int64_t now_ns, int64_t& retry_after_ns);
+    static bool spend(const CompiledPolicy& policy, Bucket& bucket, int64_t now_ns, int64_t& retry_after_ns);
+    void sweep(Shard& shard, int64_t now_ns);
+    int64_t now_ns() const;
+
+    static uint64_t bucket_key(size_t policy_index, char scope, const std::string& id);
+
+    std::vector<CompiledPolicy> policies_;
+    std::array<Shard, kShardCount> shards_;
+    const Clock::time_point epoch_ = Clock::now();
+
+    std::atomic<uint64_t> checks_{0};
+    std::atomic<uint64_t> limited_{0};
+    std::atomic<uint64_t> evicted_{0};
+};
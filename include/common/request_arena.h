@@ -0,0 +1,66 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Per-thread monotonic arena for the allocations a request makes while it is
+// handled (response documents, temporaries). A Scope around the handler makes
+// the arena current; when the outermost scope ends everything is released at
+// once and the thread's initial block is reused by its next request. Outside a
+// scope, arena allocators fall back to the global heap.
+class RequestArena {
+public:
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    static std::pmr::memory_resource* current();
+
+    static json get_stats();
+};
+
+// Allocator bound to whichever resource is current when it is constructed.
+// nlohmann::basic_json default-constructs its allocators, so values built
+// inside a scope live in the arena; they must not outlive the scope.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept : resource_(RequestArena::current()) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : resource_(other.resource()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t n) noexcept {
+        resource_->deallocate(pointer, n * sizeof(T), alignof(T));
+    }
+
+    std::pmr::memory_resource* resource() const noexcept { return resource_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return resource_ == other.resource(); }
+
+private:
+    std::pmr::memory_resource* resource_;
+};
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+// Response document allocated in the request arena
+using ArenaJson = nlohmann::basic_json<std::map, std::vector, ArenaString, bool, std::int64_t, std::uint64_t,
+                                       double, ArenaAllocator>;
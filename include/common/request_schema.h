@@ -0,0 +1,314 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+using json = nlohmann::json;
+
+// 256-entry byte table built once from a range spec such as "a-zA-Z0-9_"
+class CharClass {
+public:
+    explicit CharClass(std::string_view ranges);
+
+    bool contains(unsigned char c) const { return table_[c]; }
+    bool all_of(std::string_view text) const;
+
+    static const CharClass& username();
+
+private:
+    std::array<bool, 256> table_{};
+};
+
+// Hand-rolled replacement for the old email regex ^[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}$
+bool is_valid_email_address(std::string_view email);
+
+struct StringRule {
+    size_t min_length = 0;
+    size_t max_length = std::string::npos;
+    const CharClass* chars = nullptr;
+    bool email = false;
+    // Replaces the generic error for a length, character or format violation
+    std::string message;
+
+    static StringRule length(size_t min_length, size_t max_length) {
+        StringRule rule;
+        rule.min_length = min_length;
+        rule.max_length = max_length;
+        return rule;
+    }
+
+    StringRule with_chars(const CharClass& char_class) && {
+        chars = &char_class;
+        return std::move(*this);
+    }
+
+    StringRule as_email() && {
+        email = true;
+        return std::move(*this);
+    }
+
+    StringRule with_message(std::string text) && {
+        message = std::move(text);
+        return std::move(*this);
+    }
+};
+
+// Declarative body schema bound to a request struct through member pointers.
+// Built once (usually as a function-local static) and then used to parse
+// bodies in a single SAX pass: no DOM is built, unknown fields are skipped
+// without being stored, and only the declared fields are copied into T.
+template <typename T>
+class RequestSchema {
+public:
+    RequestSchema& string(std::string name, std::string T::*member, StringRule rule = {}) {
+        fields_.push_back({std::move(name), true, std::move(rule), member});
+        return *this;
+    }
+
+    RequestSchema& optional_string(std::string name, std::optional<std::string> T::*member, StringRule rule = {}) {
+        fields_.push_back({std::move(name), false, std::move(rule), member});
+        return *this;
+    }
+
+    RequestSchema& boolean(std::string name, bool T::*member) {
+        fields_.push_back({std::move(name), true, {}, member});
+        return *this;
+    }
+
+    RequestSchema& optional_boolean(std::string name, std::optional<bool> T::*member) {
+        fields_.push_back({std::move(name), false, {}, member});
+        return *this;
+    }
+
+    RequestSchema& optional_unsigned(std::string name, std::optional<uint64_t> T::*member) {
+        fields_.push_back({std::move(name), false, {}, member});
+        return *this;
+    }
+
+    RequestSchema& string_array(std::string name, std::vector<std::string> T::*member, size_t max_items) {
+        StringRule rule;
+        rule.max_length = max_items;
+        fields_.push_back({std::move(name), true, std::move(rule), member});
+        return *this;
+    }
+
+    // Returns an error message, or std::nullopt when `out` was filled in
+    std::optional<std::string> parse(const std::string& body, T& out) const {
+        if (body.empty()) {
+            return std::string("Request body is empty");
+        }
+
+        Handler handler(*this, out);
+        const bool parsed = json::sax_parse(body, &handler, json::input_format_t::json, false);
+        if (!handler.error.empty()) {
+            return handler.error;
+        }
+        if (!parsed) {
+            return std::string("Invalid JSON format");
+        }
+
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            if (fields_[i].required && (handler.seen & (uint64_t{1} << i)) == 0) {
+                return "Missing required field: " + fields_[i].name;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    using Member = std::variant<std::string T::*, std::optional<std::string> T::*, bool T::*,
+                                std::optional<bool> T::*, std::optional<uint64_t> T::*,
+                                std::vector<std::string> T::*>;
+
+    struct Field {
+        std::string name;
+        bool required;
+        StringRule rule;
+        Member member;
+    };
+
+    static std::optional<std::string> check_string(const Field& field, std::string_view value) {
+        const auto& rule = field.rule;
+        const char* violation = nullptr;
+
+        if (value.size() < rule.min_length || value.size() > rule.max_length) {
+            violation = "has an invalid length";
+        } else if (rule.chars != nullptr && !rule.chars->all_of(value)) {
+            violation = "contains invalid characters";
+        } else if (rule.email && !is_valid_email_address(value)) {
+            violation = "is not a valid email address";
+        }
+
+        if (violation == nullptr) {
+            return std::nullopt;
+        }
+        return rule.message.empty() ? "Field '" + field.name + "' " + violation : rule.message;
+    }
+
+    // SAX consumer: tracks depth and routes top-level values to the field named by the preceding key
+    struct Handler : json::json_sax_t {
+        Handler(const RequestSchema& schema, T& out) : schema(schema), out(out) {}
+
+        const RequestSchema& schema;
+        T& out;
+        int depth = 0;
+        const Field* current = nullptr;
+        uint64_t seen = 0;
+        bool in_string_array = false;
+        std::string error;
+
+        bool fail(std::string message) {
+            error = std::move(message);
+            return false;
+        }
+
+        bool type_error() {
+            return fail("Field '" + current->name + "' has the wrong type");
+        }
+
+        // A scalar at depth 1 belongs to `current`; anything deeper is ignored unless collected into an array
+        bool on_scalar() {
+            if (depth == 0) {
+                return fail("Request body must be a JSON object");
+            }
+            if (in_string_array && depth == 2) {
+                return type_error();
+            }
+            if (depth == 1 && current != nullptr) {
+                return type_error();
+            }
+            return true;
+        }
+
+        bool null() override {
+            return on_scalar();
+        }
+
+        bool boolean(bool value) override {
+            if (depth == 1 && current != nullptr) {
+                if (auto* member = std::get_if<bool T::*>(&current->member)) {
+                    out.*(*member) = value;
+                    return true;
+                }
+                if (auto* member = std::get_if<std::optional<bool> T::*>(&current->member)) {
+                    out.*(*member) = value;
+                    return true;
+                }
+            }
+            return on_scalar();
+        }
+
+        bool number_integer(number_integer_t) override { return on_scalar(); }
+        bool number_unsigned(number_unsigned_t value) override {
+            if (depth == 1 && current != nullptr) {
+                if (auto* member = std::get_if<std::optional<uint64_t> T::*>(&current->member)) {
+                    out.*(*member) = value;
+                    return true;
+                }
+            }
+            return on_scalar();
+        }
+        bool number_float(number_float_t, const string_t&) override { return on_scalar(); }
+        bool binary(binary_t&) override { return on_scalar(); }
+
+        bool string(string_t& value) override {
+            if (in_string_array && depth == 2) {
+                auto& items = out.*std::get<std::vector<std::string> T::*>(current->member);
+                if (items.size() >= current->rule.max_length) {
+                    return fail("Field '" + current->name + "' has too many items");
+                }
+                items.push_back(std::move(value));
+                return true;
+            }
+
+            if (depth == 0) {
+                return fail("Request body must be a JSON object");
+            }
+            if (depth == 1 && current != nullptr) {
+                if (auto check = check_string(*current, value)) {
+                    return fail(std::move(*check));
+                }
+                if (auto* member = std::get_if<std::string T::*>(&current->member)) {
+                    out.*(*member) = std::move(value);
+                    return true;
+                }
+                if (auto* member = std::get_if<std::optional<std::string> T::*>(&current->member)) {
+                    out.*(*member) = std::move(value);
+                    return true;
+                }
+                return type_error();
+            }
+            return true;
+        }
+
+        bool start_object(std::size_t) override {
+            if ((depth == 1 && current != nullptr) || in_string_array) {
+                return type_error();
+            }
+            ++depth;
+            current = nullptr;
+            return true;
+        }
+
+        bool key(string_t& name) override {
+            if (depth != 1) {
+                return true;
+            }
+
+            current = nullptr;
+            for (size_t i = 0; i < schema.fields_.size(); ++i) {
+                if (schema.fields_[i].name == name) {
+                    current = &schema.fields_[i];
+                    seen |= uint64_t{1} << i;
+                    break;
+                }
+            }
+            return true;
+        }
+
+        bool end_object() override {
+            --depth;
+            current = nullptr;
+            return true;
+        }
+
+        bool start_array(std::size_t) override {
+            if (depth == 0) {
+                return fail("Request body must be a JSON object");
+            }
+            if (in_string_array) {
+                return type_error();
+            }
+            if (depth == 1 && current != nullptr) {
+                if (!std::holds_alternative<std::vector<std::string> T::*>(current->member)) {
+                    return type_error();
+                }
+                in_string_array = true;
+            }
+            ++depth;
+            return true;
+        }
+
+        bool end_array() override {
+            --depth;
+            if (depth == 1) {
+                in_string_array = false;
+                current = nullptr;
+            }
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override {
+            return false;
+        }
+    };
+
+    std::vector<Field> fields_;
+};
@@ -4,7 +4,6 @@
 #include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
-#include <regex>
 
 using json = nlohmann::json;
 
@@ -25,6 +24,8 @@ public:
     static bool is_valid_email(const std::string& email);
     static bool is_valid_username(const std::string& username);
 
-private:
-    static const std::regex email_regex_;
+    // Every path that sends message text checks it here: non-empty, valid UTF-8, at most
+    // kMaxMessageCharacters code points, no control characters and not only whitespace
+    static constexpr size_t kMaxMessageCharacters = 1000;
+    static bool is_valid_message_content(const std::string& content, std::string& error_message);
 };
\ No newline at end of file
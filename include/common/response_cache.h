@@ -0,0 +1,67 @@
+#pragma once
+
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+// Serialized responses of read endpoints, keyed by route, user and query.
+// Each entry records the data version it was built from (a counter the owning
+// manager bumps on every mutation); a lookup with a newer version misses, so
+// nothing is ever invalidated explicitly. Entries also lapse after max_age,
+// which bounds how stale time-derived fields (last_seen, timestamps) can get.
+// Sharded LRU capped by total body bytes.
+class ResponseCache {
+public:
+    static constexpr size_t kDefaultMaxBytes = 8 * 1024 * 1024;
+    static constexpr std::chrono::seconds kDefaultMaxAge{30};
+
+    explicit ResponseCache(size_t max_bytes = kDefaultMaxBytes, std::chrono::seconds max_age = kDefaultMaxAge);
+
+    static std::string make_key(const httplib::Request& req, const std::string& username);
+
+    // Writes the stored body into res if it was built at this version
+    bool serve(const std::string& key, uint64_t version, httplib::Response& res);
+    // Keeps a successful JSON response built at this version
+    void store(const std::string& key, uint64_t version, const httplib::Response& res);
+
+    json get_stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        uint64_t version;
+        std::chrono::steady_clock::time_point stored_at;
+        std::shared_ptr<const std::string> body;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;  // most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+    };
+
+    static constexpr size_t kShardCount = 16;
+
+    Shard& shard_for(const std::string& key);
+    void erase(Shard& shard, std::list<Entry>::iterator it);
+
+    size_t max_bytes_per_shard_;
+    std::chrono::seconds max_age_;
+    std::array<Shard, kShardCount> shards_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+    std::atomic<uint64_t> stale_{0};
+    std::atomic<uint64_t> evictions_{0};
+};
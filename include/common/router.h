@@ -0,0 +1,37 @@
+#pragma once
+
+#include <httplib.h>
+#include <regex>
+#include <string>
+#include <vector>
+
+// Route table owned by a service. Routes are declared once and can then be
+// mounted on any number of httplib servers, or dispatched in-process.
+class Router {
+public:
+    using Handler = httplib::Server::Handler;
+
+    Router& Get(const std::string& pattern, Handler handler);
+    Router& Post(const std::string& pattern, Handler handler);
+    Router& Put(const std::string& pattern, Handler handler);
+    Router& Delete(const std::string& pattern, Handler handler);
+
+    void mount(httplib::Server& server) const;
+
+    // Runs the first matching handler directly; returns false if no route matches
+    bool dispatch(httplib::Request& req, httplib::Response& res) const;
+
+    size_t size() const { return routes_.size(); }
+
+private:
+    struct Route {
+        std::string method;
+        std::string pattern;
+        std::regex regex;
+        Handler handler;
+    };
+
+    Router& add_route(const std::string& method, const std::string& pattern, Handler handler);
+
+    std::vector<Route> routes_;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Minimal SHA-256 (FIPS 180-4), HMAC-SHA256 (RFC 2104) and PBKDF2 for tokens and passwords
+class Sha256 {
+public:
+    static constexpr size_t kDigestSize = 32;
+    static constexpr size_t kBlockSize = 64;
+    using Digest = std::array<uint8_t, kDigestSize>;
+
+    Sha256();
+
+    void update(const void* data, size_t length);
+    void update(std::string_view data) { update(data.data(), data.size()); }
+    Digest finish();
+
+    static Digest hash(std::string_view data);
+    static Digest hmac(std::string_view key, std::string_view message);
+    // PBKDF2-HMAC-SHA256 (RFC 8018)
+    static std::string pbkdf2(std::string_view password, std::string_view salt, uint32_t iterations, size_t length);
+
+private:
+    void process_block(const uint8_t* block);
+
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, kBlockSize> buffer_;
+    size_t buffered_;
+    uint64_t total_length_;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// 64-bit k-sortable ids: 41 bits of milliseconds since kEpochMs, 10 bits of
+// node (the worker index) and 12 bits of sequence. Generation is a single CAS
+// on the last id handed out, so ids are unique and strictly increasing per
+// node even if the clock steps back; a node issuing more than 4096 ids in one
+// millisecond borrows from the next one.
+//
+// Ids are kept as integers internally and rendered as 13 characters of
+// Crockford base32, fixed width so strings sort the same way the ids do.
+class SnowflakeId {
+public:
+    static constexpr int kNodeBits = 10;
+    static constexpr int kSequenceBits = 12;
+    static constexpr int64_t kEpochMs = 1704067200000;  // 2024-01-01T00:00:00Z
+    static constexpr size_t kFormattedLength = 13;
+
+    // Before any id is generated
+    static void set_node(uint32_t node);
+
+    static uint64_t next();
+
+    static uint32_t node_of(uint64_t id);
+    static int64_t timestamp_ms_of(uint64_t id);
+    // The smallest id that could be generated at `ms`, for turning times into cursors
+    static uint64_t first_at(int64_t ms);
+
+    static std::string format(uint64_t id);
+    // nullopt unless the text is exactly what format() produces (either case)
+    static std::optional<uint64_t> parse(std::string_view text);
+
+private:
+    static std::atomic<uint64_t> last_;
+    static std::atomic<uint32_t> node_;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+// One-pass content check for user-supplied text: validates UTF-8, counts code
+// points, flags control characters and tells whether the text is blank.
+// Picks an AVX2 or SSSE3 kernel at runtime (Keiser-Lemire lookup validation),
+// falling back to the scalar reference on other CPUs.
+class TextScanner {
+public:
+    struct Result {
+        bool valid_utf8;
+        // C0 controls other than tab/LF/CR, DEL, and C1 controls (U+0080-U+009F)
+        bool has_control;
+        // Only Unicode White_Space, zero-width space or BOM (true for empty text)
+        bool all_whitespace;
+        // Meaningful only when valid_utf8 is set
+        size_t code_points;
+    };
+
+    static Result scan(std::string_view text);
+    static Result scan_scalar(std::string_view text);
+
+    // "avx2", "ssse3" or "scalar"
+    static const char* implementation();
+    // Runs a specific kernel, for tests and benchmarks; nullopt if this CPU or build lacks it
+    static std::optional<Result> scan_using(std::string_view implementation, std::string_view text);
+};
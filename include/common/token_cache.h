@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common/token_signer.h"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+// Sharded LRU of tokens that already passed verification, so a client reusing
+// its bearer token skips the MAC. Entries are keyed by a hash of the token and
+// keep the full token to rule out collisions; they lapse with the token's expiry.
+class VerifiedTokenCache {
+public:
+    explicit VerifiedTokenCache(size_t capacity_per_shard = 1024);
+
+    std::optional<TokenSigner::Claims> find(const std::string& token, int64_t now);
+    void insert(const std::string& token, const TokenSigner::Claims& claims);
+
+    json get_stats() const;
+
+private:
+    struct Entry {
+        std::string token;
+        TokenSigner::Claims claims;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru;  // most recently used first
+        std::unordered_map<size_t, std::list<Entry>::iterator> index;
+    };
+
+    static constexpr size_t kShardCount = 16;
+
+    size_t capacity_per_shard_;
+    std::array<Shard, kShardCount> shards_;
+
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
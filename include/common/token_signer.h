@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// HS256 JWTs: base64url(header).base64url(claims).base64url(HMAC-SHA256).
+// The header carries a key id so keys can be rotated: the first configured key
+// signs, and every configured key still verifies. Keys are loaded once at
+// startup (before workers fork) and are read-only afterwards.
+class TokenSigner {
+public:
+    struct Claims {
+        std::string username;
+        std::string session_id;
+        std::string key_id;
+        int64_t issued_at = 0;
+        int64_t expires_at = 0;
+    };
+
+    static TokenSigner& instance();
+
+    // MESSENGER_TOKEN_KEYS="kid=secret,kid2=secret2" (first one signs), or MESSENGER_TOKEN_SECRET
+    // for a single key. Without either, a random per-launch key is generated.
+    void load_keys_from_environment();
+    void add_key(const std::string& key_id, const std::string& secret);
+
+    std::string sign(const std::string& username, const std::string& session_id, int64_t ttl_seconds) const;
+    // Full check: structure, key id, MAC (constant time) and expiry
+    std::optional<Claims> verify(const std::string& token) const;
+
+private:
+    TokenSigner() = default;
+
+    std::unordered_map<std::string, std::string> keys_;
+    std::string signing_key_id_;
+};
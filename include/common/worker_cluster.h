@@ -0,0 +1,46 @@
+#pragma once
+
+#include <httplib.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Describes the group of worker processes this process belongs to when the
+// launcher runs several workers per service on one port. State is
+// partitioned by a stable hash of a key (conversation id, user id), and
+// requests that land on the wrong worker are forwarded to the owner over
+// its internal Unix socket.
+class WorkerCluster {
+public:
+    struct WorkerResponse {
+        int worker;
+        bool ok;
+        httplib::Response response;
+    };
+
+    static void configure(int worker_index, int worker_count, const std::string& socket_dir);
+
+    static bool is_enabled();
+    static int worker_index();
+    static int worker_count();
+
+    // Partitioning
+    static int owner_of(const std::string& key);
+    static bool owns(const std::string& key);
+    static std::string socket_path(const std::string& service_name, int worker);
+
+    // Internal transport
+    static bool forward(const std::string& service_name, int worker,
+                        const httplib::Request& req, httplib::Response& res);
+    static std::vector<WorkerResponse> gather(const std::string& service_name, const httplib::Request& req);
+    // Sends to every worker but this one; returns how many answered with a 2xx
+    static size_t notify_peers(const std::string& service_name, const httplib::Request& req);
+
+private:
+    static httplib::Client& client_for(const std::string& socket_path);
+    static httplib::Request make_internal_request(const httplib::Request& req);
+
+    static int worker_index_;
+    static int worker_count_;
+    static std::string socket_dir_;
+};
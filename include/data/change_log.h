@@ -0,0 +1,95 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Recent mutations, kept so clients can catch up with a delta instead of
+// re-fetching every list.
+//
+// Changes to a conversation go to the feeds of its participants; changes
+// everyone can see (profiles, presence) go to one shared feed. Groups are too
+// big to copy a change into every member's feed, so each has a feed of its
+// own that members' deltas merge in when they are read. Every feed is
+// a bounded window: once a change is evicted, a client whose cursor is older
+// than it has to start over from a snapshot. Sequence numbers restart with
+// the process, so cursors carry a per-process epoch.
+class ChangeLog {
+public:
+    struct Change {
+        uint64_t sequence;
+        std::time_t timestamp;
+        std::string type;
+        json data;
+    };
+
+    struct Delta {
+        uint64_t cursor;
+        std::vector<std::shared_ptr<const Change>> changes;  // Oldest first
+    };
+
+    struct Entry {
+        std::vector<std::string> recipients;
+        std::string type;
+        json data;
+        std::string group = {};  // When set, the change goes to this group's feed instead
+    };
+
+    static constexpr size_t kDefaultUserCapacity = 256;
+    static constexpr size_t kDefaultSharedCapacity = 4096;
+    static constexpr size_t kDefaultGroupCapacity = 1024;
+
+    explicit ChangeLog(size_t user_capacity = kDefaultUserCapacity, size_t shared_capacity = kDefaultSharedCapacity,
+                       size_t group_capacity = kDefaultGroupCapacity);
+
+    void append(const std::vector<std::string>& recipients, const std::string& type, json data);
+    void append_shared(const std::string& type, json data);
+    void append_group(const std::string& group, const std::string& type, json data);
+    // Several changes under one lock, in order
+    void append_all(std::vector<Entry> entries);
+
+    // Changes visible to the user after `since`, including those of the groups they are in, or
+    // nullopt when some of them have been evicted
+    std::optional<Delta> changes_since(const std::string& username, uint64_t since,
+                                       const std::vector<std::string>& groups = {});
+    uint64_t cursor();
+
+    // "<epoch>-<sequence>"; parse_cursor returns nullopt for cursors from another process
+    std::string format_cursor(uint64_t sequence) const;
+    std::optional<uint64_t> parse_cursor(const std::string& cursor) const;
+
+    json get_stats();
+
+private:
+    struct Feed {
+        std::deque<std::shared_ptr<const Change>> changes;
+        uint64_t evicted_through = 0;  // Highest sequence no longer held
+    };
+
+    std::shared_ptr<const Change> make_change(const std::string& type, json data);
+    void push(Feed& feed, size_t capacity, std::shared_ptr<const Change> change);
+    bool covers(const Feed& feed, uint64_t since) const;
+
+    const size_t user_capacity_;
+    const size_t shared_capacity_;
+    const size_t group_capacity_;
+    const std::string epoch_;
+
+    std::unordered_map<std::string, Feed> user_feeds_;
+    std::unordered_map<std::string, Feed> group_feeds_;
+    Feed shared_feed_;
+    uint64_t sequence_;
+    std::mutex log_mutex_;
+
+    size_t deltas_served_;
+    size_t expired_cursors_;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include "data/user_bitmap.h"
+#include "data/user_id_interner.h"
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+struct ChannelInfo {
+    std::string name;
+    std::string description;
+    std::string created_by;
+    std::time_t created_at;
+    size_t subscribers;
+    bool subscribed;  // By the user the list was made for
+};
+
+// Topic channels (teams, announcements) that users subscribe to. Each
+// channel's subscribers are a UserBitmap over interned ids, so a publish can
+// find who is online with one bitmap AND against the connection manager's
+// online set. Publishers take a snapshot of the bitmap; a subscribe that
+// lands while one is in use copies it rather than waiting.
+class ChannelManager {
+public:
+    explicit ChannelManager(std::shared_ptr<UserIdInterner> user_ids);
+
+    // false if the name is taken
+    bool create_channel(const std::string& name, const std::string& description, const std::string& created_by);
+    // false if there is no such channel
+    bool subscribe(const std::string& name, const std::string& username);
+    bool unsubscribe(const std::string& name, const std::string& username);
+
+    std::vector<ChannelInfo> list_channels(const std::string& username);
+    // nullptr if there is no such channel
+    std::shared_ptr<const UserBitmap> subscribers(const std::string& name);
+    // Only the creator and subscribers may publish; false for unknown channels too
+    bool can_publish(const std::string& name, const std::string& username);
+
+    void record_publish(size_t delivered);
+    json get_stats();
+
+private:
+    struct Channel {
+        std::string description;
+        std::string created_by;
+        std::time_t created_at;
+        std::shared_ptr<UserBitmap> subscribers;
+    };
+
+    // Copies the bitmap first if a publisher still holds it
+    static UserBitmap& writable_subscribers(Channel& channel);
+
+    std::shared_ptr<UserIdInterner> user_ids_;
+    std::unordered_map<std::string, Channel> channels_;
+    std::shared_mutex channels_mutex_;
+
+    std::atomic<uint64_t> publishes_{0};
+    std::atomic<uint64_t> deliveries_{0};
+};
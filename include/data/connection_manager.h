@@ -1,6 +1,13 @@
 #pragma once
 
 #include <nlohmann/json.hpp>
+#include "data/user_bitmap.h"
+#include "data/user_id_interner.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
@@ -11,7 +18,7 @@ using json = nlohmann::json;
 
 struct WebSocketConnection {
     std::string user_id;
-    std::string connection_id;
+    uint64_t connection_id;  // SnowflakeId
     std::time_t connected_at;
     std::time_t last_activity;
     bool is_active;
@@ -19,28 +26,46 @@ struct WebSocketConnection {
 
 class ConnectionManager {
 public:
-    ConnectionManager();
+    // Invoked when a user gains their first or loses their last connection. Runs under the
+    // manager's lock, so it must not call back into ConnectionManager.
+    using PresenceListener = std::function<void(const std::string& user_id, bool is_connected)>;
+
+    // With an interner, online users are also kept as a bitmap for intersect_online
+    explicit ConnectionManager(std::shared_ptr<UserIdInterner> user_ids = nullptr);
+
+    void set_presence_listener(PresenceListener listener);
 
     // Connection operations
-    std::string add_connection(const std::string& user_id);
-    bool remove_connection(const std::string& connection_id);
+    uint64_t add_connection(const std::string& user_id);
+    bool remove_connection(uint64_t connection_id);
     bool remove_user_connections(const std::string& user_id);
     void cleanup_inactive_connections();
 
     // Queries
     std::vector<std::string> get_online_users();
+    std::vector<std::string> filter_online_users(std::vector<std::string> candidates);
+    // The users in the set who are online here; a bitmap AND, however many there are
+    UserBitmap intersect_online(const UserBitmap& users);
     size_t get_total_connections();
     size_t get_active_users_count();
     bool is_user_online(const std::string& user_id);
+    std::optional<std::time_t> get_last_seen(const std::string& user_id);
+    // Bumped on every connection change; keys cached responses that show presence
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
 
     // Utility
     json get_stats();
 
 private:
-    std::string generate_connection_id();
+    void detach_connection(const std::string& user_id, uint64_t connection_id);
+    void notify_presence(const std::string& user_id, bool is_connected);
 
-    std::unordered_map<std::string, WebSocketConnection> connections_;
-    std::unordered_map<std::string, std::unordered_set<std::string>> user_connections_;
+    std::shared_ptr<UserIdInterner> user_ids_;
+    PresenceListener presence_listener_;
+    std::unordered_map<uint64_t, WebSocketConnection> connections_;
+    std::unordered_map<std::string, std::unordered_set<uint64_t>> user_connections_;
+    std::unordered_map<std::string, std::time_t> last_seen_;
+    UserBitmap online_;  // Interned ids of the users in user_connections_
     std::mutex connections_mutex_;
-    size_t connection_counter_;
+    std::atomic<uint64_t> version_{0};
 };
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "data/user_id_interner.h"
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Directed roster graph: an edge from a user to a contact means the user added
+// them or wrote to them. Presence only flows between mutual contacts, so no one
+// learns a user's presence by adding them. Each user's contacts are kept as a
+// sorted vector of interned ids, so lookups and intersections stay cache friendly.
+class ContactGraph {
+public:
+    explicit ContactGraph(std::shared_ptr<UserIdInterner> user_ids);
+
+    // Graph updates
+    bool add_contact(const std::string& username, const std::string& contact);
+    // Links the user to everyone else in a conversation they started or added people to
+    void add_conversation(const std::string& username, const std::vector<std::string>& participants);
+
+    // Queries
+    std::vector<std::string> get_contacts(const std::string& username) const;
+    // Contacts who have also added the user back; the audience for their presence
+    std::vector<std::string> get_mutual_contacts(const std::string& username) const;
+    std::vector<UserIdInterner::Id> get_contact_ids(UserIdInterner::Id user_id) const;
+    bool are_contacts(const std::string& username, const std::string& contact) const;
+
+    // Multi-worker mode: every worker keeps the whole graph. Once tracking is on, edges added
+    // here queue up until take_new_links hands them over; peers record them with apply_links.
+    using Link = std::pair<std::string, std::string>;
+    void track_new_links();
+    std::vector<Link> take_new_links();
+    void apply_links(const std::vector<Link>& links);
+
+private:
+    // Conversations larger than this are not folded into the roster; their
+    // members are reached through conversation membership instead.
+    static constexpr size_t kMaxRosterConversationSize = 32;
+
+    // Called with the lock held exclusively; queues the edge when tracking
+    bool link(UserIdInterner::Id from, UserIdInterner::Id to, bool track = true);
+
+    std::shared_ptr<UserIdInterner> user_ids_;
+    std::vector<std::vector<UserIdInterner::Id>> adjacency_;
+    bool track_new_links_ = false;
+    std::vector<std::pair<UserIdInterner::Id, UserIdInterner::Id>> new_links_;
+    mutable std::shared_mutex graph_mutex_;
+};
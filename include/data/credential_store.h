@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common/password_hasher.h"
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Password hashes by username. Only encoded hashes are stored; hashing and
+// verification run on the PasswordHasher pool.
+class CredentialStore {
+public:
+    explicit CredentialStore(std::shared_ptr<PasswordHasher> hasher);
+
+    bool add(const std::string& username, const std::string& encoded_hash);
+    bool exists(const std::string& username);
+    std::optional<std::string> get_hash(const std::string& username);
+    void update_hash(const std::string& username, const std::string& encoded_hash);
+
+    // Verified against when the username is unknown, so both cases cost the same
+    const std::string& get_dummy_hash() const { return dummy_hash_; }
+
+    size_t size();
+
+private:
+    std::unordered_map<std::string, std::string> hashes_;
+    std::mutex credentials_mutex_;
+    std::string dummy_hash_;
+
+    void create_sample_credentials(PasswordHasher& hasher);
+};
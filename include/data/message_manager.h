@@ -1,8 +1,14 @@
 #pragma once
 
 #include <nlohmann/json.hpp>
+#include "common/request_arena.h"
+#include "data/change_log.h"
+#include "data/contact_graph.h"
+#include "data/search_index.h"
+#include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <mutex>
 #include <optional>
@@ -10,46 +16,173 @@
 using json = nlohmann::json;
 
 struct Message {
-    std::string id;
+    uint64_t id;  // SnowflakeId; increasing within a conversation
     std::string from_user;
     std::string to_user;
     std::string content;
     std::time_t timestamp;
-    bool is_read;
+    uint64_t sequence;  // Position in the conversation, from 1; never reused
+};
+
+// Read receipts are a watermark: every message up to read_up_to counts as read. Sending a message
+// moves the sender's watermark past it, so whatever lies above a watermark came from someone else.
+struct ReadState {
+    uint64_t read_up_to = 0;
+    size_t unread = 0;  // Messages above the watermark, kept current so counts cost nothing to read
+};
+
+// A user's unread messages across the conversations this process holds; only conversations with
+// something unread are listed
+struct UnreadCounts {
+    size_t total = 0;
+    std::unordered_map<std::string, size_t> conversations;
+};
+
+// Messages strictly between two ids, oldest first. With a limit, the page nearest `after` is returned,
+// or the one nearest `before` when only that is given, so clients can page either way.
+struct MessageRange {
+    std::optional<uint64_t> after;
+    std::optional<uint64_t> before;
+    size_t limit = 0;  // 0 for no limit
 };
 
 struct Conversation {
     std::string id;
-    std::vector<std::string> participants;
-    std::vector<Message> messages;
+    std::vector<std::string> participants;  // Direct conversations only; groups use members
+    std::vector<Message> messages;  // In sequence order, stored once however many members there are
     std::time_t last_activity;
+    uint64_t version = 0;  // Stamp of the last change, drawn from the same counter as user versions
+    uint64_t last_sequence = 0;
+    std::unordered_map<std::string, ReadState> read_states;
+
+    // A send to a group touches only the group's and the sender's state: members' unread counts,
+    // versions and change feeds are resolved from the group's when they are read
+    bool is_group = false;
+    std::string name;
+    std::unordered_set<std::string> members;
+};
+
+enum class GroupUpdate {
+    Updated,
+    NotFound,  // No such group here, or the user isn't in it
+    Full       // Would pass MessageManager::kMaxGroupMembers
 };
 
 class MessageManager {
 public:
-    MessageManager();
+    explicit MessageManager(std::shared_ptr<ContactGraph> contact_graph = nullptr,
+                            std::shared_ptr<ChangeLog> change_log = nullptr,
+                            std::shared_ptr<SearchIndex> search_index = nullptr);
 
     // Message operations
-    std::string send_message(const std::string& from_user, const std::string& to_user, const std::string& content);
-    bool mark_message_as_read(const std::string& message_id, const std::string& username);
-    bool delete_message(const std::string& message_id, const std::string& username);
+    uint64_t send_message(const std::string& from_user, const std::string& to_user, const std::string& content);
+    // Appends all of them under one lock and records them in one change log commit
+    std::vector<Message> send_messages(const std::string& from_user, const std::string& to_user,
+                                       const std::vector<std::string>& contents);
+    // Moves the watermark up to the message (never back)
+    bool mark_message_as_read(uint64_t message_id, const std::string& username);
+    // Moves the watermark forward, to the latest message when no sequence is given; nullopt if the
+    // conversation doesn't exist or the user isn't in it
+    std::optional<ReadState> mark_read_up_to(const std::string& conversation_id, const std::string& username,
+                                             std::optional<uint64_t> sequence);
+    bool delete_message(uint64_t message_id, const std::string& username);
+
+    // Group operations. The creator is a member; members may add others and leave. member_count, if
+    // given, receives the group's size afterwards.
+    static constexpr size_t kMaxGroupMembers = 10000;
+    std::string create_group(const std::string& creator, const std::string& name,
+                             const std::vector<std::string>& members, size_t* member_count = nullptr);
+    GroupUpdate add_group_members(const std::string& group_id, const std::string& username,
+                                  const std::vector<std::string>& members, size_t* member_count = nullptr);
+    bool leave_group(const std::string& group_id, const std::string& username);
+    // nullopt if the user isn't in the group; sorted
+    std::optional<std::vector<std::string>> group_members(const std::string& group_id, const std::string& username);
+    std::optional<Message> send_group_message(const std::string& group_id, const std::string& from_user,
+                                              const std::string& content);
+    // Groups held here that the user is in; their change feeds are part of the user's
+    std::vector<std::string> user_groups(const std::string& username);
 
     // Conversation operations
     std::vector<Conversation> get_user_conversations(const std::string& username);
     std::optional<Conversation> get_conversation(const std::string& conversation_id, const std::string& username);
     std::vector<Message> get_conversation_messages(const std::string& conversation_id, const std::string& username);
 
-    // Utility
-    json message_to_json(const Message& message);
-    json conversation_to_json(const Conversation& conversation, bool include_messages = false);
+    // Ranked full-text search over the conversations the user is in, best match first; `total` counts
+    // every match, not just this page. Empty without an index.
+    ArenaJson search_messages_json(const std::string& username, std::string_view query, size_t offset, size_t limit,
+                                   size_t& total);
+
+    // Maintained on every send, read and delete, so reading them never walks history
+    UnreadCounts unread_counts(const std::string& username);
+
+    // Bumped whenever a conversation the user is in changes; keys cached responses
+    uint64_t user_version(const std::string& username);
+    // nullopt when the conversation doesn't exist here or the user isn't a participant
+    std::optional<uint64_t> conversation_version(const std::string& conversation_id, const std::string& username);
+
+    // Serialized under the lock instead of copying conversations out (most recent first)
+    ArenaJson user_conversations_json(const std::string& username);
+    // nullopt if the conversation doesn't exist or the user isn't in it
+    // has_more, if given, tells whether the limit cut the range short
+    std::optional<ArenaJson> conversation_messages_json(const std::string& conversation_id, const std::string& username,
+                                                        const MessageRange& range = {}, bool* has_more = nullptr);
+
+    // Utility; the documents live in the current request arena
+    ArenaJson message_to_json(const Conversation& conversation, const Message& message);
+    // Read state is the viewer's
+    ArenaJson conversation_to_json(const Conversation& conversation, const std::string& username,
+                                   bool include_messages = false);
+
+    static std::string get_conversation_id(const std::string& user1, const std::string& user2);
+    static bool is_group_id(const std::string& conversation_id);
+    // Direct conversations are partitioned by hash; a group stays on the worker that created it,
+    // which its id names
+    static int owner_of(const std::string& conversation_id);
 
 private:
-    std::string generate_message_id();
-    std::string get_conversation_id(const std::string& user1, const std::string& user2);
+    struct MessageLocation {
+        std::string conversation_id;
+        uint64_t sequence;
+        SearchIndex::DocId search_doc;
+    };
+
     bool is_user_participant(const Conversation& conversation, const std::string& username);
+    // Under the caller's conversations_mutex_; unordered
+    std::vector<const Conversation*> conversations_of(const std::string& username) const;
+    // Appends under the caller's conversations_mutex_; to_user is the group id for groups
+    std::vector<Message> append_messages(Conversation& conversation, const std::string& from_user,
+                                         const std::string& to_user, const std::vector<std::string>& contents);
+    size_t unread_in(const Conversation& conversation, const std::string& username) const;
     void create_sample_messages();
+    void touch_participants(Conversation& conversation);
+    void record_change(const Conversation& conversation, const std::string& type, json data);
+    Message* find_message(uint64_t message_id, Conversation*& conversation);
+    Message* find_by_sequence(Conversation& conversation, uint64_t sequence);
+    void index_message(const Message& message, const std::string& conversation_id);
+    bool advance_watermark(Conversation& conversation, const std::string& username, uint64_t sequence);
+    json read_event(const Conversation& conversation, const std::string& username);
+    void set_unread(Conversation& conversation, const std::string& username, size_t unread);
+    void update_group_unread(const Conversation& group, const std::vector<std::string>& readers);
 
+    std::shared_ptr<ContactGraph> contact_graph_;
+    std::shared_ptr<ChangeLog> change_log_;
+    std::shared_ptr<SearchIndex> search_index_;
     std::unordered_map<std::string, Conversation> conversations_;
+    // So lookups by id don't scan every conversation
+    std::unordered_map<uint64_t, MessageLocation> message_index_;
+    // Conversations and groups each user is in, so per-user reads don't scan every conversation
+    std::unordered_map<std::string, std::unordered_set<std::string>> user_conversations_;
     std::mutex conversations_mutex_;
-    int message_counter_;
+
+    std::unordered_map<std::string, uint64_t> user_versions_;
+    std::unordered_map<std::string, uint64_t> group_versions_;
+    uint64_t version_counter_ = 0;
+    std::mutex versions_mutex_;
+
+    std::unordered_map<std::string, UnreadCounts> unread_counts_;
+    // Groups each user is in, with how many of each group's messages they have read; reads of
+    // unread counts, versions and memberships never need conversations_mutex_
+    std::unordered_map<std::string, std::unordered_map<std::string, size_t>> group_reads_;
+    std::unordered_map<std::string, size_t> group_sizes_;  // Messages each group holds
+    std::mutex unread_mutex_;
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using json = nlohmann::json;
+
+struct PresenceChange {
+    std::string user_id;
+    bool is_online;
+    std::time_t timestamp;
+};
+
+// Debounces raw connection transitions into presence changes. A user who
+// drops their last connection stays "online" for a grace period, so a quick
+// reconnect produces no event at all. Changes are coalesced per user and
+// handed out in periodic digests.
+class PresenceTracker {
+public:
+    static constexpr std::chrono::milliseconds kDefaultGracePeriod{5000};
+
+    explicit PresenceTracker(std::chrono::milliseconds grace_period = kDefaultGracePeriod);
+
+    // Fed by ConnectionManager whenever a user gains their first or loses their last connection
+    void on_connection_state(const std::string& user_id, bool is_connected);
+
+    // Returns the net changes since the previous digest
+    std::vector<PresenceChange> collect_digest();
+    void record_delivery(size_t events_sent);
+
+    std::chrono::milliseconds get_grace_period() const;
+    json get_stats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        bool connected;
+        bool published_online;
+        Clock::time_point disconnected_at;
+    };
+
+    const std::chrono::milliseconds grace_period_;
+
+    std::unordered_map<std::string, Entry> users_;
+    std::unordered_set<std::string> dirty_users_;
+    std::mutex presence_mutex_;
+
+    // Counters for comparing raw transition volume with what actually goes out
+    size_t raw_transitions_;
+    size_t suppressed_flaps_;
+    size_t published_changes_;
+    size_t digests_;
+    size_t digest_events_;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Bloom filter over revoked session ids and users. Readers probe it without
+// locking; writers (and rebuilds) are serialised by the owner. A rebuild only
+// ever stores words that still contain every live key's bits, so a reader
+// racing with it never gets a false "not revoked".
+class RevocationFilter {
+public:
+    enum class Domain : uint8_t { Session = 's', User = 'u' };
+
+    static constexpr size_t kBits = 1 << 17;
+    static constexpr int kHashes = 4;
+
+    RevocationFilter();
+
+    bool may_contain(Domain domain, std::string_view key) const;
+
+    // Owner-serialised
+    void add(Domain domain, std::string_view key);
+    void rebuild(const std::vector<std::pair<Domain, std::string_view>>& keys);
+
+private:
+    static uint64_t hash(Domain domain, std::string_view key);
+
+    std::array<std::atomic<uint64_t>, kBits / 64> words_;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Inverted index over message content, updated as messages are sent and
+// deleted. Each term maps to a posting list of (document, term frequency)
+// pairs, delta + varint encoded in blocks of kBlockSize with a skip entry per
+// block, so intersections can jump over blocks without decoding them.
+// Documents are numbered in insertion order and only tombstoned on delete.
+// Each conversation also has a list of its documents, so a query scoped to a
+// few small conversations walks those instead of the whole term lists.
+//
+// Tokens are runs of letters and digits, case-folded for Latin, Greek and
+// Cyrillic; Han and kana characters, which aren't separated by spaces, are
+// indexed one character per token. Queries match messages containing every
+// term and rank them with BM25.
+class SearchIndex {
+public:
+    using DocId = uint32_t;
+
+    struct Hit {
+        std::string conversation_id;
+        uint64_t sequence;
+        double score;
+    };
+
+    struct Result {
+        std::vector<Hit> hits;  // Best first
+        size_t total;           // Every match in scope, not just this page
+    };
+
+    static constexpr size_t kBlockSize = 128;
+    static constexpr size_t kMaxQueryTerms = 8;
+
+    DocId add(const std::string& conversation_id, uint64_t sequence, std::string_view content);
+    void remove(DocId doc);
+
+    // Only messages in the given conversations are matched
+    Result search(const std::vector<std::string>& conversation_ids, std::string_view query,
+                  size_t offset, size_t limit) const;
+
+    static std::vector<std::string> tokenize(std::string_view text);
+
+    json get_stats() const;
+
+private:
+    struct Document {
+        uint32_t conversation;  // Slot in conversation_ids_
+        uint16_t length;        // Tokens, saturating
+        bool live;
+        uint64_t sequence;
+    };
+
+    struct Skip {
+        DocId base;       // Document before the block; the block's deltas start from it
+        uint32_t offset;  // Byte offset of the block
+    };
+
+    struct PostingList {
+        std::vector<uint8_t> bytes;
+        std::vector<Skip> skips;
+        DocId last_doc = 0;
+        uint32_t count = 0;
+    };
+
+    class Cursor;
+
+    // Returns the bytes added
+    static size_t append(PostingList& list, DocId doc, uint32_t frequency);
+
+    std::vector<Document> documents_;
+    std::unordered_map<std::string, PostingList> postings_;
+    std::unordered_map<std::string, uint32_t> conversation_slots_;
+    std::vector<std::string> conversation_ids_;
+    std::vector<PostingList> conversation_postings_;  // By slot
+    uint64_t total_length_ = 0;
+    size_t live_documents_ = 0;
+    size_t posting_bytes_ = 0;
+    mutable std::atomic<size_t> searches_{0};
+    mutable std::shared_mutex index_mutex_;
+};
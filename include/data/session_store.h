@@ -0,0 +1,114 @@
+#pragma once
+
+#include "data/revocation_filter.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Login sessions and their revocation state.
+//
+// A session is identified by "w<worker>-<created_ms>-<random>", so any worker
+// can tell which worker holds it and when it was created. Refresh tokens are
+// "<session id>.<secret>" and rotate on every use; presenting an already
+// rotated secret is treated as theft and ends the session.
+//
+// Access tokens carry the session id. Revoked sessions, and per-user
+// "everything created before T" cutoffs for log-out-everywhere, are kept in a
+// Bloom filter so the per-request check is a few lock-free bit probes; the
+// locked confirmation only runs when the filter says maybe. Sessions and
+// revocations expire through a one-second timing wheel.
+class SessionStore {
+public:
+    struct Session {
+        std::string id;
+        std::string username;
+        int64_t created_at_ms;
+        int64_t last_used_at;
+        int64_t expires_at;
+        std::string refresh_hash;
+        std::string previous_refresh_hash;
+    };
+
+    struct IssuedSession {
+        std::string session_id;
+        std::string refresh_token;
+    };
+
+    enum class RefreshStatus { Ok, Invalid, Expired, Reused };
+
+    struct RefreshResult {
+        RefreshStatus status;
+        std::string username;
+        std::string session_id;
+        std::string refresh_token;
+    };
+
+    static constexpr int64_t kSessionTtlSeconds = 30 * 24 * 3600;
+
+    // revocation_ttl_seconds: how long a revoked session's access tokens could still be presented
+    explicit SessionStore(int worker_index = 0, int64_t revocation_ttl_seconds = 3600);
+
+    IssuedSession create_session(const std::string& username);
+    RefreshResult rotate(const std::string& refresh_token);
+
+    // Both apply on every worker: the revocation is recorded, and the session dropped if held here
+    bool revoke_session(const std::string& session_id);
+    size_t revoke_all(const std::string& username);
+
+    std::vector<Session> get_sessions(const std::string& username);
+
+    // Hot path, called for every authenticated request
+    bool is_revoked(const std::string& session_id, const std::string& username) const;
+
+    // Worker that created the session, or -1 if the id is malformed
+    static int worker_of(const std::string& session_id);
+
+    json get_stats();
+
+private:
+    enum class EntryKind : uint8_t { Session, RevokedSession, UserCutoff };
+
+    struct WheelEntry {
+        EntryKind kind;
+        std::string key;
+        int64_t expires_at;
+    };
+
+    static constexpr size_t kWheelSlots = 4096;
+
+    std::string generate_session_id(int64_t now_ms);
+    void schedule(EntryKind kind, const std::string& key, int64_t expires_at);
+    void advance_wheel(int64_t now);
+    void remove_session(const std::string& session_id);
+    void rebuild_filter();
+
+    static int64_t created_at_of(const std::string& session_id);
+    static std::string hash_secret(const std::string& secret);
+
+    const int worker_index_;
+    const int64_t revocation_ttl_seconds_;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Session> sessions_;
+    std::unordered_map<std::string, std::vector<std::string>> user_sessions_;
+    std::unordered_map<std::string, int64_t> revoked_sessions_;  // session id -> entry expiry
+    std::unordered_map<std::string, int64_t> user_cutoffs_;      // username -> sessions created up to this ms are revoked
+
+    std::vector<std::vector<WheelEntry>> wheel_;
+    int64_t wheel_time_;
+
+    RevocationFilter filter_;
+
+    mutable std::atomic<uint64_t> revocation_checks_{0};
+    mutable std::atomic<uint64_t> filter_maybes_{0};
+    mutable std::atomic<uint64_t> confirmed_revocations_{0};
+    size_t reuse_detections_;
+};
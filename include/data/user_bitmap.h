@@ -0,0 +1,67 @@
+#pragma once
+
+#include "data/user_id_interner.h"
+#include <cstdint>
+#include <vector>
+
+// Compressed set of interned user ids, split into chunks of 65536 ids by the
+// high 16 bits. A chunk holding few ids keeps their low bits in a sorted
+// array; past kArrayLimit it switches to a plain 8 KiB bitmap, which is
+// smaller from there on. Sparse sets cost two bytes per id, dense ones one
+// bit, and intersecting two dense chunks is a word-wise AND.
+class UserBitmap {
+public:
+    using Id = UserIdInterner::Id;
+
+    // Returns false if the id was already there (add) or wasn't (remove)
+    bool add(Id id);
+    bool remove(Id id);
+    bool contains(Id id) const;
+
+    size_t cardinality() const { return cardinality_; }
+    bool empty() const { return cardinality_ == 0; }
+    size_t memory_bytes() const;
+
+    static UserBitmap intersect(const UserBitmap& a, const UserBitmap& b);
+
+    // Ascending order
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const auto& chunk : chunks_) {
+            const Id base = static_cast<Id>(chunk.key) << 16;
+            if (chunk.dense()) {
+                for (size_t word = 0; word < kChunkWords; ++word) {
+                    for (uint64_t bits = chunk.words[word]; bits != 0; bits &= bits - 1) {
+                        f(base | static_cast<Id>(word * 64 + __builtin_ctzll(bits)));
+                    }
+                }
+            } else {
+                for (uint16_t low : chunk.array) {
+                    f(base | low);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kArrayLimit = 4096;
+    static constexpr size_t kChunkWords = 65536 / 64;
+
+    struct Chunk {
+        uint16_t key;                 // High 16 bits of every id in the chunk
+        uint32_t cardinality;
+        std::vector<uint16_t> array;  // Sorted low bits while the chunk is sparse
+        std::vector<uint64_t> words;  // kChunkWords words once it is dense; array is then empty
+
+        bool dense() const { return !words.empty(); }
+    };
+
+    std::vector<Chunk>::iterator find_chunk(uint16_t key);
+    std::vector<Chunk>::const_iterator find_chunk(uint16_t key) const;
+    static void to_dense(Chunk& chunk);
+    static void to_sparse(Chunk& chunk);
+    static bool intersect_chunks(const Chunk& a, const Chunk& b, Chunk& out);
+
+    std::vector<Chunk> chunks_;  // By key
+    size_t cardinality_ = 0;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Maps usernames to dense 32-bit ids so per-user structures (rosters,
+// membership sets) can be stored as compact integer arrays.
+class UserIdInterner {
+public:
+    using Id = std::uint32_t;
+
+    Id intern(const std::string& username);
+    std::optional<Id> find(const std::string& username) const;
+
+    std::string name(Id id) const;
+    std::vector<std::string> names(const std::vector<Id>& ids) const;
+
+    size_t size() const;
+
+private:
+    std::unordered_map<std::string, Id> ids_;
+    std::deque<std::string> names_;
+    mutable std::shared_mutex interner_mutex_;
+};
@@ -1,6 +1,12 @@
 #pragma once
 
 #include <nlohmann/json.hpp>
+#include "common/request_arena.h"
+#include "data/change_log.h"
+#include "data/connection_manager.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <mutex>
@@ -13,14 +19,14 @@ struct User {
     std::string username;
     std::string email;
     std::string full_name;
-    bool is_online;
     std::time_t last_seen;
     std::time_t created_at;
 };
 
 class UserManager {
 public:
-    UserManager();
+    explicit UserManager(std::shared_ptr<ConnectionManager> connection_manager,
+                         std::shared_ptr<ChangeLog> change_log = nullptr);
 
     // User operations
     bool user_exists(const std::string& username);
@@ -29,16 +35,28 @@ public:
     bool set_online_status(const std::string& username, bool is_online);
 
     // Queries
+    // Online state is derived from live connections, never stored per user
+    bool is_online(const std::string& username);
+    std::time_t get_last_seen(const User& user);
     std::optional<User> get_user(const std::string& username);
+    std::vector<std::optional<User>> get_users(const std::vector<std::string>& usernames);
     std::vector<User> get_all_users(const std::string& exclude_username = "");
     std::vector<User> search_users(const std::string& query, const std::string& exclude_username = "");
+    // Bumped when a user is added or edited; presence changes are versioned by ConnectionManager
+    uint64_t version() const { return version_.load(std::memory_order_acquire); }
 
     // Utility
-    json user_to_json(const User& user);
+    ArenaJson user_to_json(const User& user);
 
 private:
     void create_sample_users();
 
+    std::shared_ptr<ConnectionManager> connection_manager_;
+    std::shared_ptr<ChangeLog> change_log_;
     std::unordered_map<std::string, User> users_;
     std::mutex users_mutex_;
+    // Connection held for each user who set themselves online by hand
+    std::unordered_map<std::string, uint64_t> status_connections_;
+    std::mutex status_mutex_;
+    std::atomic<uint64_t> version_{0};
 };
\ No newline at end of file
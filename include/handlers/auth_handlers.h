@@ -3,20 +3,42 @@
 #include <httplib.h>
 #include <nlohmann/json.hpp>
 #include "common/http_service.h"
+#include "common/password_hasher.h"
+#include "data/credential_store.h"
+#include "data/session_store.h"
+#include "data/user_manager.h"
+#include <chrono>
+#include <memory>
 
 using json = nlohmann::json;
 
 class AuthHandlers {
 public:
-    static void handle_login(const httplib::Request& req, httplib::Response& res);
-    static void handle_register(const httplib::Request& req, httplib::Response& res);
-    static void handle_verify_token(const httplib::Request& req, httplib::Response& res);
-    static void handle_refresh_token(const httplib::Request& req, httplib::Response& res);
-    static void handle_logout(const httplib::Request& req, httplib::Response& res);
+    AuthHandlers(std::shared_ptr<SessionStore> session_store,
+                 std::shared_ptr<CredentialStore> credential_store,
+                 std::shared_ptr<PasswordHasher> password_hasher,
+                 std::shared_ptr<UserManager> user_manager);
+
+    void handle_login(const httplib::Request& req, httplib::Response& res);
+    void handle_register(const httplib::Request& req, httplib::Response& res);
+    void handle_verify_token(const httplib::Request& req, httplib::Response& res);
+    void handle_refresh_token(const httplib::Request& req, httplib::Response& res);
+    void handle_logout(const httplib::Request& req, httplib::Response& res);
+    void handle_logout_all(const httplib::Request& req, httplib::Response& res);
+    void handle_get_sessions(const httplib::Request& req, httplib::Response& res);
 
 private:
-    static bool validate_credentials(const std::string& username, const std::string& password);
-    static json create_user_response(const std::string& username, const std::string& token);
+    // Upper bound on waiting for the hashing pool before giving up with 503. The wait blocks the
+    // HTTP worker thread; AuthService's route limits bound how many threads can be waiting.
+    static constexpr std::chrono::seconds kPasswordHashTimeout{5};
+
+    std::shared_ptr<SessionStore> session_store_;
+    std::shared_ptr<CredentialStore> credential_store_;
+    std::shared_ptr<PasswordHasher> password_hasher_;
+    std::shared_ptr<UserManager> user_manager_;
+
+    static void send_hasher_busy(httplib::Response& res);
+    json create_session_response(const std::string& username);
     static void send_json_response(httplib::Response& res, int status, const json& data);
     static void send_error_response(httplib::Response& res, int status, const std::string& message);
-};
\ No newline at end of file
+};
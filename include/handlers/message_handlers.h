@@ -2,25 +2,53 @@
 
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include "common/content_filter.h"
+#include "common/request_arena.h"
+#include "common/response_cache.h"
 #include "data/message_manager.h"
+#include "data/user_manager.h"
 #include <memory>
+#include <optional>
 
 using json = nlohmann::json;
 
 class MessageHandlers {
 public:
-    explicit MessageHandlers(std::shared_ptr<MessageManager> message_manager);
+    MessageHandlers(std::shared_ptr<MessageManager> message_manager, std::shared_ptr<UserManager> user_manager,
+                    std::shared_ptr<ContentFilter> content_filter, std::shared_ptr<ResponseCache> response_cache);
 
     void handle_send_message(const httplib::Request& req, httplib::Response& res);
+    void handle_send_batch(const httplib::Request& req, httplib::Response& res);
     void handle_get_conversations(const httplib::Request& req, httplib::Response& res);
     void handle_get_messages(const httplib::Request& req, httplib::Response& res);
+    void handle_get_unread(const httplib::Request& req, httplib::Response& res);
+    void handle_search_messages(const httplib::Request& req, httplib::Response& res);
+
+    // Search pages end within the first kMaxSearchWindow results
+    static constexpr size_t kDefaultSearchLimit = 20;
+    static constexpr size_t kMaxSearchWindow = 1000;
+    // offset and limit query parameters; false if they are malformed or reach past the window
+    static bool parse_search_page(const httplib::Request& req, size_t& offset, size_t& limit);
     void handle_mark_as_read(const httplib::Request& req, httplib::Response& res);
+    void handle_read_up_to(const httplib::Request& req, httplib::Response& res);
     void handle_delete_message(const httplib::Request& req, httplib::Response& res);
 
+    // Groups
+    void handle_create_group(const httplib::Request& req, httplib::Response& res);
+    void handle_get_group_members(const httplib::Request& req, httplib::Response& res);
+    void handle_add_group_members(const httplib::Request& req, httplib::Response& res);
+    void handle_leave_group(const httplib::Request& req, httplib::Response& res);
+    void handle_send_group_message(const httplib::Request& req, httplib::Response& res);
+
 private:
     std::shared_ptr<MessageManager> message_manager_;
+    std::shared_ptr<UserManager> user_manager_;
+    std::shared_ptr<ContentFilter> content_filter_;
+    std::shared_ptr<ResponseCache> response_cache_;
 
-    bool validate_message_content(const std::string& content, std::string& error_message);
-    void send_json_response(httplib::Response& res, int status, const json& data);
+    bool validate_usernames(const std::vector<std::string>& usernames, std::string& error_message);
+    // First of the usernames with no account, if any
+    std::optional<std::string> find_unknown_user(const std::vector<std::string>& usernames);
+    void send_json_response(httplib::Response& res, int status, const ArenaJson& data);
     void send_error_response(httplib::Response& res, int status, const std::string& message);
 };
\ No newline at end of file
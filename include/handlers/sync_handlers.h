@@ -0,0 +1,39 @@
+#pragma once
+
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+#include "common/request_arena.h"
+#include "data/change_log.h"
+#include "data/connection_manager.h"
+#include "data/message_manager.h"
+#include "data/user_manager.h"
+#include <memory>
+#include <optional>
+
+using json = nlohmann::json;
+
+class SyncHandlers {
+public:
+    SyncHandlers(std::shared_ptr<ChangeLog> change_log,
+                 std::shared_ptr<MessageManager> message_manager,
+                 std::shared_ptr<UserManager> user_manager,
+                 std::shared_ptr<ConnectionManager> connection_manager);
+
+    // GET /api/sync?since=<cursor>: the changes after the cursor, or a full snapshot when the
+    // cursor is missing, malformed or older than the change log still covers
+    void handle_sync(const httplib::Request& req, httplib::Response& res);
+
+    // A cursor holds one "<epoch>-<sequence>" part per worker, joined by '~'
+    static constexpr char kCursorSeparator = '~';
+
+private:
+    std::shared_ptr<ChangeLog> change_log_;
+    std::shared_ptr<MessageManager> message_manager_;
+    std::shared_ptr<UserManager> user_manager_;
+    std::shared_ptr<ConnectionManager> connection_manager_;
+
+    std::optional<uint64_t> parse_since(const std::string& cursor) const;
+    ArenaJson build_snapshot(const std::string& username);
+    void send_json_response(httplib::Response& res, int status, const ArenaJson& data);
+    void send_error_response(httplib::Response& res, int status, const std::string& message);
+};
@@ -2,24 +2,42 @@
 
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include "common/request_arena.h"
+#include "common/response_cache.h"
 #include "data/user_manager.h"
+#include "data/connection_manager.h"
+#include "data/contact_graph.h"
 #include <memory>
+#include <unordered_set>
 
 using json = nlohmann::json;
 
 class UserHandlers {
 public:
-    explicit UserHandlers(std::shared_ptr<UserManager> user_manager);
+    UserHandlers(std::shared_ptr<UserManager> user_manager,
+                 std::shared_ptr<ConnectionManager> connection_manager,
+                 std::shared_ptr<ContactGraph> contact_graph,
+                 std::shared_ptr<ResponseCache> response_cache);
 
     void handle_get_user(const httplib::Request& req, httplib::Response& res);
     void handle_update_user(const httplib::Request& req, httplib::Response& res);
     void handle_get_users(const httplib::Request& req, httplib::Response& res);
     void handle_search_users(const httplib::Request& req, httplib::Response& res);
     void handle_set_online_status(const httplib::Request& req, httplib::Response& res);
+    void handle_get_contacts(const httplib::Request& req, httplib::Response& res);
+    void handle_add_contact(const httplib::Request& req, httplib::Response& res);
+    void handle_get_presence(const httplib::Request& req, httplib::Response& res);
+
+    // Most users a single presence request may ask about
+    static constexpr size_t kMaxPresenceBatch = 500;
 
 private:
     std::shared_ptr<UserManager> user_manager_;
+    std::shared_ptr<ConnectionManager> connection_manager_;
+    std::shared_ptr<ContactGraph> contact_graph_;
+    std::shared_ptr<ResponseCache> response_cache_;
 
-    void send_json_response(httplib::Response& res, int status, const json& data);
+    std::unordered_set<std::string> get_online_set(const std::vector<User>& users);
+    void send_json_response(httplib::Response& res, int status, const ArenaJson& data);
     void send_error_response(httplib::Response& res, int status, const std::string& message);
 };
\ No newline at end of file
@@ -2,14 +2,25 @@
 
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include "common/content_filter.h"
+#include "common/response_cache.h"
+#include "data/channel_manager.h"
 #include "data/connection_manager.h"
+#include "data/contact_graph.h"
+#include "data/presence_tracker.h"
 #include <memory>
 
 using json = nlohmann::json;
 
 class WebSocketHandlers {
 public:
-    explicit WebSocketHandlers(std::shared_ptr<ConnectionManager> connection_manager);
+    WebSocketHandlers(std::shared_ptr<ConnectionManager> connection_manager,
+                      std::shared_ptr<ContactGraph> contact_graph,
+                      std::shared_ptr<PresenceTracker> presence_tracker,
+                      std::shared_ptr<ContentFilter> content_filter,
+                      std::shared_ptr<ResponseCache> response_cache,
+                      std::shared_ptr<ChannelManager> channel_manager,
+                      std::shared_ptr<UserIdInterner> user_ids);
 
     void handle_get_stats(const httplib::Request& req, httplib::Response& res);
     void handle_get_online_users(const httplib::Request& req, httplib::Response& res);
@@ -18,12 +29,30 @@ public:
     void handle_broadcast_message(const httplib::Request& req, httplib::Response& res);
     void handle_disconnect_user(const httplib::Request& req, httplib::Response& res);
 
+    // Channels
+    void handle_create_channel(const httplib::Request& req, httplib::Response& res);
+    void handle_list_channels(const httplib::Request& req, httplib::Response& res);
+    void handle_subscribe(const httplib::Request& req, httplib::Response& res);
+    void handle_unsubscribe(const httplib::Request& req, httplib::Response& res);
+    void handle_publish(const httplib::Request& req, httplib::Response& res);
+
+    void publish_presence_digest(const std::vector<PresenceChange>& changes);
+
 private:
     std::shared_ptr<ConnectionManager> connection_manager_;
+    std::shared_ptr<ContactGraph> contact_graph_;
+    std::shared_ptr<PresenceTracker> presence_tracker_;
+    std::shared_ptr<ContentFilter> content_filter_;
+    std::shared_ptr<ResponseCache> response_cache_;
+    std::shared_ptr<ChannelManager> channel_manager_;
+    std::shared_ptr<UserIdInterner> user_ids_;
+
+    // Names are resolved a batch at a time, so the interner's lock isn't taken per recipient
+    static constexpr size_t kDeliveryBatch = 1024;
 
     void send_message_to_user(const std::string& target_user, const json& message);
     void broadcast_message_to_all(const json& message);
-    void notify_user_status_change(const std::string& user_id, bool is_online);
+    size_t deliver_to_users(const UserBitmap& users, const json& message);
 
     void send_json_response(httplib::Response& res, int status, const json& data);
     void send_error_response(httplib::Response& res, int status, const std::string& message);
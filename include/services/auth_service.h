@@ -1,12 +1,29 @@
 #pragma once
 
 #include "common/http_service.h"
+#include "handlers/auth_handlers.h"
+#include "common/password_hasher.h"
+#include "data/credential_store.h"
+#include "data/session_store.h"
+#include "services/service_context.h"
+#include <memory>
 
 class AuthService : public HttpService {
 public:
-    explicit AuthService(int port);
+    AuthService(int port, std::shared_ptr<ServiceContext> context,
+                PasswordHasher::Options hashing_options = PasswordHasher::Options());
     ~AuthService() override = default;
 
+    std::vector<std::string> route_prefixes() const override;
+    json collect_metrics() override;
+
 private:
-    void setup_routes() override;
-};
\ No newline at end of file
+    void setup_routes(Router& router) override;
+    bool route_to_worker(const httplib::Request& req, httplib::Response& res) override;
+    std::optional<std::string> partition_key(const httplib::Request& req) override;
+
+    std::shared_ptr<SessionStore> session_store_;
+    std::shared_ptr<PasswordHasher> password_hasher_;
+    std::shared_ptr<CredentialStore> credential_store_;
+    std::unique_ptr<AuthHandlers> handlers_;
+};
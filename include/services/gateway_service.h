@@ -0,0 +1,25 @@
+#pragma once
+
+#include "common/http_service.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+// Single edge listener for all services. Requests are matched by path
+// prefix and run the owning service's handlers directly on one shared
+// worker pool, with no internal HTTP hop.
+class GatewayService : public HttpService {
+public:
+    GatewayService(int port, std::vector<HttpService*> services, size_t worker_threads);
+    ~GatewayService() override = default;
+
+    json collect_metrics() override;
+
+private:
+    void setup_routes(Router& router) override;
+    bool handle_before_routing(const httplib::Request& req, httplib::Response& res) override;
+
+    std::vector<HttpService*> services_;
+    // Path prefix -> owning service name, longest prefixes first
+    std::vector<std::pair<std::string, std::string>> prefixes_;
+};
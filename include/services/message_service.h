@@ -1,18 +1,37 @@
 #pragma once
 
 #include "common/http_service.h"
+#include "common/idempotency_cache.h"
 #include "handlers/message_handlers.h"
+#include "handlers/sync_handlers.h"
 #include "data/message_manager.h"
+#include "services/service_context.h"
+#include <functional>
 #include <memory>
 
 class MessageService : public HttpService {
 public:
-    explicit MessageService(int port = 8003);
+    MessageService(int port, std::shared_ptr<ServiceContext> context);
     ~MessageService() override = default;
 
+    std::vector<std::string> route_prefixes() const override;
+    json collect_metrics() override;
+
 private:
-    void setup_routes() override;
+    void setup_routes(Router& router) override;
+    bool route_to_worker(const httplib::Request& req, httplib::Response& res) override;
+    bool gather_search(const httplib::Request& req, httplib::Response& res);
+    void gather_sync(const httplib::Request& req, httplib::Response& res);
+    // Runs a send at most once per Idempotency-Key; retries get the first answer back
+    void run_idempotent(const httplib::Request& req, httplib::Response& res,
+                        const std::function<void(const httplib::Request&, httplib::Response&)>& handler);
 
     std::shared_ptr<MessageManager> message_manager_;
+    std::shared_ptr<ContentFilter> content_filter_;
+    std::shared_ptr<ResponseCache> response_cache_;
+    std::shared_ptr<ChangeLog> change_log_;
+    std::shared_ptr<SearchIndex> search_index_;
+    std::shared_ptr<IdempotencyCache> idempotency_cache_;
     std::unique_ptr<MessageHandlers> handlers_;
+    std::unique_ptr<SyncHandlers> sync_handlers_;
 };
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "common/content_filter.h"
+#include "data/change_log.h"
+#include "data/connection_manager.h"
+#include "data/contact_graph.h"
+#include "data/presence_tracker.h"
+#include "data/session_store.h"
+#include "data/user_id_interner.h"
+#include "data/user_manager.h"
+#include <chrono>
+#include <memory>
+
+// State shared by the services running inside one process.
+struct ServiceContext {
+    explicit ServiceContext(std::chrono::milliseconds presence_grace_period = PresenceTracker::kDefaultGracePeriod);
+
+    std::shared_ptr<UserIdInterner> user_ids;
+    std::shared_ptr<ContactGraph> contact_graph;
+    std::shared_ptr<ConnectionManager> connection_manager;
+    std::shared_ptr<PresenceTracker> presence_tracker;
+    std::shared_ptr<SessionStore> sessions;
+    std::shared_ptr<ContentFilter> content_filter;
+    std::shared_ptr<ChangeLog> change_log;
+    // Profiles are read by the sync endpoint as well as the user service
+    std::shared_ptr<UserManager> user_manager;
+};
@@ -3,16 +3,24 @@
 #include "common/http_service.h"
 #include "handlers/user_handlers.h"
 #include "data/user_manager.h"
+#include "services/service_context.h"
 #include <memory>
 
 class UserService : public HttpService {
 public:
-    explicit UserService(int port);
+    UserService(int port, std::shared_ptr<ServiceContext> context);
     ~UserService() override = default;
 
+    std::vector<std::string> route_prefixes() const override;
+    json collect_metrics() override;
+
 private:
-    void setup_routes() override;
+    void setup_routes(Router& router) override;
+    void setup_internal_routes(Router& router) override;
+    bool route_to_worker(const httplib::Request& req, httplib::Response& res) override;
+    std::optional<std::string> partition_key(const httplib::Request& req) override;
 
     std::shared_ptr<UserManager> user_manager_;
+    std::shared_ptr<ResponseCache> response_cache_;
     std::unique_ptr<UserHandlers> handlers_;
 };
\ No newline at end of file
@@ -3,23 +3,42 @@
 #include "common/http_service.h"
 #include "handlers/websocket_handlers.h"
 #include "data/connection_manager.h"
+#include "services/service_context.h"
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <thread>
 
 class WebSocketService : public HttpService {
 public:
-    explicit WebSocketService(int port);
+    WebSocketService(int port, std::shared_ptr<ServiceContext> context);
     ~WebSocketService() override;
 
+    std::vector<std::string> route_prefixes() const override;
+    json collect_metrics() override;
+
 private:
-    void setup_routes() override;
+    void setup_routes(Router& router) override;
+    void setup_internal_routes(Router& router) override;
+    bool route_to_worker(const httplib::Request& req, httplib::Response& res) override;
+    bool replicate_to_workers(const httplib::Request& req, httplib::Response& res);
     void on_start() override;
     void on_stop() override;
 
     void cleanup_worker();
+    // Multi-worker mode: new roster edges, then this digest, go to every other worker
+    void share_with_workers(const std::vector<PresenceChange>& changes);
+
+    static constexpr std::chrono::milliseconds kPresenceDigestInterval{1000};
+    static constexpr std::chrono::seconds kCleanupInterval{30};
 
     std::shared_ptr<ConnectionManager> connection_manager_;
+    std::shared_ptr<ContactGraph> contact_graph_;
+    std::shared_ptr<PresenceTracker> presence_tracker_;
+    std::shared_ptr<ChangeLog> change_log_;
+    std::shared_ptr<ResponseCache> response_cache_;
+    std::shared_ptr<ChannelManager> channel_manager_;
     std::unique_ptr<WebSocketHandlers> handlers_;
     std::thread cleanup_thread_;
-    bool should_cleanup_;
+    std::atomic<bool> should_cleanup_;
 };
\ No newline at end of file
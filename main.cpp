@@ -1,25 +1,158 @@
 #include <iostream>
 #include <memory>
+#include <algorithm>
 #include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <thread>
 #include <vector>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "common/logger.h"
+#include "common/http_service.h"
+#include "common/worker_cluster.h"
+#include "common/token_signer.h"
+#include "common/password_hasher.h"
 #include "services/auth_service.h"
 #include "services/user_service.h"
 #include "services/message_service.h"
 #include "services/websocket_service.h"
+#include "services/gateway_service.h"
+#include "services/service_context.h"
 
-int main() {
-    LOG_INFO("=== Messenger Gateway ===");
-    LOG_INFO("Starting messenger backend services...");
+namespace {
+
+// Upper bound on how long a draining process waits for in-flight requests
+constexpr std::chrono::seconds kDrainTimeout{30};
+
+volatile std::sig_atomic_t shutdown_requested = 0;
+volatile std::sig_atomic_t reload_requested = 0;
+
+struct LaunchOptions {
+    bool hot_restart = false;
+    int workers = 1;
+    int gateway_port = 0;
+    size_t gateway_threads = 0;
+    PasswordHasher::Options hashing;
+    std::string blocklist_path;
+};
+
+void handle_shutdown_signal(int) {
+    shutdown_requested = 1;
+}
+
+void handle_reload_signal(int) {
+    reload_requested = 1;
+}
+
+void install_signal_handlers() {
+    struct sigaction action{};
+    action.sa_handler = handle_shutdown_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+
+    struct sigaction reload_action{};
+    reload_action.sa_handler = handle_reload_signal;
+    sigemptyset(&reload_action.sa_mask);
+    sigaction(SIGHUP, &reload_action, nullptr);
+}
+
+bool has_flag(int argc, char* argv[], const char* flag) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], flag) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int get_int_option(int argc, char* argv[], const char* option, int default_value) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], option) == 0) {
+            return std::atoi(argv[i + 1]);
+        }
+    }
+    return default_value;
+}
+
+std::string get_string_option(int argc, char* argv[], const char* option, const std::string& default_value) {
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], option) == 0) {
+            return argv[i + 1];
+        }
+    }
+    return default_value;
+}
+
+void print_usage() {
+    std::cout << "Usage: messenger [--hot-restart] [--workers N] [--gateway PORT [--gateway-threads N]]\n"
+              << "                 [--hash-threads N] [--hash-iterations N] [--blocklist FILE] [--debug]\n"
+              << "  --hot-restart        bind with SO_REUSEPORT so a new process can take over the ports;\n"
+              << "                       send SIGTERM to the old process once the new one is healthy\n"
+              << "  --workers N          fork N worker processes that share each service port\n"
+              << "  --gateway PORT       serve every service from one port instead of 8001-8004\n"
+              << "  --gateway-threads N  requests the gateway runs concurrently (default: CPU count)\n"
+              << "  --hash-threads N     threads reserved for password hashing (default: 2)\n"
+              << "  --hash-iterations N  PBKDF2 iterations for new hashes; older hashes are upgraded\n"
+              << "                       on the next successful login (default: 60000)\n"
+              << "  --blocklist FILE     reject messages containing any listed term, one per line\n"
+              << "                       (default: $MESSENGER_BLOCKLIST); SIGHUP reloads it\n"
+              << "  --debug              enable DEBUG logging\n";
+}
+
+void pin_to_cpu(int worker_index) {
+#ifdef __linux__
+    const long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count <= 0) {
+        return;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(static_cast<int>(worker_index % cpu_count), &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        LOG_WARNING("Could not pin worker " + std::to_string(worker_index) + " to a CPU");
+    }
+#endif
+}
+
+int run_services(const LaunchOptions& options) {
+    LOG_INFO("Starting messenger backend services (pid " + std::to_string(getpid()) + ")...");
 
     try {
+        // State shared between services (rosters, live connections)
+        auto context = std::make_shared<ServiceContext>();
+        if (!options.blocklist_path.empty()) {
+            context->content_filter->load_file(options.blocklist_path);
+        }
+
         // Create all services
-        auto auth_service = std::make_unique<AuthService>(8001);
-        auto user_service = std::make_unique<UserService>(8002);
-        auto message_service = std::make_unique<MessageService>(8003);
-        auto websocket_service = std::make_unique<WebSocketService>(8004);
+        auto auth_service = std::make_unique<AuthService>(8001, context, options.hashing);
+        auto user_service = std::make_unique<UserService>(8002, context);
+        auto message_service = std::make_unique<MessageService>(8003, context);
+        auto websocket_service = std::make_unique<WebSocketService>(8004, context);
+
+        // In gateway mode the services keep their handlers and background work, but only the
+        // gateway listens
+        std::unique_ptr<GatewayService> gateway_service;
+        if (options.gateway_port > 0) {
+            auth_service->set_listener_enabled(false);
+            user_service->set_listener_enabled(false);
+            message_service->set_listener_enabled(false);
+            websocket_service->set_listener_enabled(false);
+
+            gateway_service = std::make_unique<GatewayService>(
+                options.gateway_port,
+                std::vector<HttpService*>{auth_service.get(), user_service.get(),
+                                          message_service.get(), websocket_service.get()},
+                options.gateway_threads);
+        }
 
         // Start all services
         LOG_INFO("Starting Auth Service...");
@@ -34,11 +167,22 @@ int main() {
         LOG_INFO("Starting WebSocket Service...");
         websocket_service->start();
 
+        if (gateway_service) {
+            LOG_INFO("Starting Gateway...");
+            gateway_service->start();
+        }
+
         LOG_INFO("=== All Services Started ===");
-        LOG_INFO("Auth Service:      http://localhost:8001");
-        LOG_INFO("User Service:      http://localhost:8002");
-        LOG_INFO("Message Service:   http://localhost:8003");
-        LOG_INFO("WebSocket Service: http://localhost:8004");
+        if (gateway_service) {
+            const std::string gateway_url = "http://localhost:" + std::to_string(options.gateway_port);
+            LOG_INFO("Gateway:           " + gateway_url + " (" + std::to_string(options.gateway_threads) +
+                     " concurrent requests)");
+        } else {
+            LOG_INFO("Auth Service:      http://localhost:8001");
+            LOG_INFO("User Service:      http://localhost:8002");
+            LOG_INFO("Message Service:   http://localhost:8003");
+            LOG_INFO("WebSocket Service: http://localhost:8004");
+        }
         LOG_INFO("");
         LOG_INFO("WebSocket endpoints:");
         LOG_INFO("  GET  /api/websocket/stats");
@@ -46,17 +190,57 @@ int main() {
         LOG_INFO("  POST /api/websocket/connect?user_id=<id>");
         LOG_INFO("  POST /api/websocket/send?target_user=<user>&message=<msg>");
         LOG_INFO("  POST /api/websocket/broadcast?message=<msg>");
+        LOG_INFO("");
+        LOG_INFO("Channel endpoints:");
+        LOG_INFO("  GET  /api/channels");
+        LOG_INFO("  POST /api/channels");
+        LOG_INFO("  POST /api/channels/<name>/subscribe");
+        LOG_INFO("  POST /api/channels/<name>/unsubscribe");
+        LOG_INFO("  POST /api/channels/<name>/publish");
+        LOG_INFO("");
+        LOG_INFO("Session endpoints:");
+        LOG_INFO("  POST /api/auth/refresh");
+        LOG_INFO("  POST /api/auth/logout");
+        LOG_INFO("  POST /api/auth/logout_all");
+        LOG_INFO("  GET  /api/auth/sessions");
+        LOG_INFO("");
+        LOG_INFO("Presence endpoints:");
+        LOG_INFO("  GET  /api/users/contacts");
+        LOG_INFO("  POST /api/users/contacts");
+        LOG_INFO("  POST /api/users/presence");
+
+        if (options.hot_restart) {
+            LOG_INFO("");
+            LOG_INFO("Hot restart mode: start the replacement with --hot-restart, wait for /health,");
+            LOG_INFO("then send SIGTERM to pid " + std::to_string(getpid()) + " to drain and exit");
+        }
 
         // Keep running
-        while (auth_service->is_running() &&
+        while (!shutdown_requested &&
+               auth_service->is_running() &&
                user_service->is_running() &&
                message_service->is_running() &&
-               websocket_service->is_running()) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+               websocket_service->is_running() &&
+               (!gateway_service || gateway_service->is_running())) {
+            if (reload_requested) {
+                reload_requested = 0;
+                context->content_filter->reload();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
         }
 
-        // Stop all services
+        // Don't let a stuck request hold the ports hostage during a deploy
+        std::thread([] {
+            std::this_thread::sleep_for(kDrainTimeout);
+            LOG_ERROR("Drain timeout exceeded, forcing exit");
+            std::_Exit(1);
+        }).detach();
+
+        // Stop all services (each stops accepting, then drains in-flight requests)
         LOG_INFO("Shutting down services...");
+        if (gateway_service) {
+            gateway_service->stop();
+        }
         auth_service->stop();
         user_service->stop();
         message_service->stop();
@@ -70,4 +254,124 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+pid_t spawn_worker(int worker_index, int worker_count, const std::string& socket_dir, const LaunchOptions& options) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        WorkerCluster::configure(worker_index, worker_count, socket_dir);
+        pin_to_cpu(worker_index);
+        LOG_INFO("Worker " + std::to_string(worker_index) + " started (pid " + std::to_string(getpid()) + ")");
+        std::exit(run_services(options));
+    }
+
+    if (pid < 0) {
+        LOG_ERROR("Failed to fork worker " + std::to_string(worker_index));
+    }
+    return pid;
+}
+
+// Launcher: forks the workers, restarts any that die, and forwards shutdown to them
+int run_launcher(const LaunchOptions& options) {
+    const int worker_count = options.workers;
+    const std::string socket_dir = "/tmp/messenger-" + std::to_string(getpid());
+    mkdir(socket_dir.c_str(), 0700);
+
+    LOG_INFO("Launching " + std::to_string(worker_count) + " workers (internal sockets in " + socket_dir + ")");
+
+    // Workers share every public port
+    HttpService::set_reuse_port(true);
+
+    std::vector<pid_t> workers(worker_count, -1);
+    for (int i = 0; i < worker_count; ++i) {
+        workers[i] = spawn_worker(i, worker_count, socket_dir, options);
+    }
+
+    while (!shutdown_requested) {
+        if (reload_requested) {
+            reload_requested = 0;
+            for (pid_t pid : workers) {
+                if (pid > 0) {
+                    kill(pid, SIGHUP);
+                }
+            }
+        }
+
+        int status = 0;
+        pid_t exited = waitpid(-1, &status, WNOHANG);
+        if (exited > 0 && !shutdown_requested) {
+            for (int i = 0; i < worker_count; ++i) {
+                if (workers[i] == exited) {
+                    LOG_WARNING("Worker " + std::to_string(i) + " exited, restarting");
+                    workers[i] = spawn_worker(i, worker_count, socket_dir, options);
+                }
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    LOG_INFO("Stopping workers...");
+    for (pid_t pid : workers) {
+        if (pid > 0) {
+            kill(pid, SIGTERM);
+        }
+    }
+    for (pid_t pid : workers) {
+        if (pid > 0) {
+            waitpid(pid, nullptr, 0);
+        }
+    }
+
+    rmdir(socket_dir.c_str());
+    LOG_INFO("All workers stopped");
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (has_flag(argc, argv, "--help")) {
+        print_usage();
+        return 0;
+    }
+
+    Logger::set_debug_enabled(has_flag(argc, argv, "--debug"));
+
+    LaunchOptions options;
+    const char* hot_restart_env = std::getenv("MESSENGER_HOT_RESTART");
+    options.hot_restart = has_flag(argc, argv, "--hot-restart") ||
+                          (hot_restart_env != nullptr && std::strcmp(hot_restart_env, "1") == 0);
+    options.workers = get_int_option(argc, argv, "--workers", 1);
+    options.gateway_port = get_int_option(argc, argv, "--gateway", 0);
+    options.gateway_threads = static_cast<size_t>(std::max(1, get_int_option(
+        argc, argv, "--gateway-threads", static_cast<int>(std::thread::hardware_concurrency()))));
+
+    options.hashing.threads = static_cast<size_t>(std::max(1, get_int_option(
+        argc, argv, "--hash-threads", static_cast<int>(options.hashing.threads))));
+    options.hashing.iterations = static_cast<uint32_t>(std::max(1000, get_int_option(
+        argc, argv, "--hash-iterations", static_cast<int>(options.hashing.iterations))));
+
+    const char* blocklist_env = std::getenv("MESSENGER_BLOCKLIST");
+    options.blocklist_path = get_string_option(argc, argv, "--blocklist",
+                                               blocklist_env != nullptr ? blocklist_env : "");
+
+    if (options.workers > 1 && options.gateway_port > 0) {
+        std::cerr << "--gateway cannot be combined with --workers\n";
+        return 1;
+    }
+
+    HttpService::set_reuse_port(options.hot_restart);
+
+    install_signal_handlers();
+
+    LOG_INFO("=== Messenger Gateway ===");
+
+    // Before forking, so every worker signs and verifies with the same keys
+    TokenSigner::instance().load_keys_from_environment();
+
+    if (options.workers > 1) {
+        return run_launcher(options);
+    }
+
+    return run_services(options);
+}
@@ -0,0 +1,205 @@
+#include "common/admission_controller.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kDecreaseFactor = 0.9;
+
+} // namespace
+
+AdmissionController::Limits AdmissionController::default_limits() {
+    return {
+        16,                                 // max_concurrency
+        2,                                  // min_concurrency
+        16,                                 // max_queue
+        std::chrono::milliseconds(2000),    // deadline
+        std::chrono::milliseconds(250)      // target_latency
+    };
+}
+
+std::unique_ptr<AdmissionController::Gate> AdmissionController::make_gate(const std::string& prefix,
+                                                                          const Limits& limits) {
+    auto gate = std::make_unique<Gate>();
+    gate->prefix = prefix;
+    gate->limits = limits;
+    gate->limit = static_cast<double>(limits.max_concurrency);
+    gate->in_flight = 0;
+    gate->waiting = 0;
+    gate->admitted = 0;
+    gate->shed = 0;
+    gate->timed_out = 0;
+    gate->deadline_exceeded = 0;
+    return gate;
+}
+
+AdmissionController::AdmissionController(Limits service_limits) {
+    gates_.push_back(make_gate("", service_limits));
+}
+
+void AdmissionController::set_route_limits(const std::string& path_prefix, Limits limits) {
+    for (auto& gate : gates_) {
+        if (!gate->prefix.empty() && gate->prefix == path_prefix) {
+            gate->limits = limits;
+            gate->limit = static_cast<double>(limits.max_concurrency);
+            return;
+        }
+    }
+    gates_.push_back(make_gate(path_prefix, limits));
+}
+
+size_t AdmissionController::route_gate_for(const std::string& path) const {
+    for (size_t i = 1; i < gates_.size(); ++i) {
+        if (path.compare(0, gates_[i]->prefix.size(), gates_[i]->prefix) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+void AdmissionController::start_ticket(size_t gate, std::chrono::milliseconds requested_deadline,
+                                       Ticket& ticket) const {
+    ticket.gates.clear();
+    ticket.started_at = Clock::now();
+
+    auto deadline_budget = gates_[gate]->limits.deadline;
+    if (requested_deadline.count() > 0) {
+        deadline_budget = std::min(deadline_budget, requested_deadline);
+    }
+    ticket.deadline = ticket.started_at + deadline_budget;
+}
+
+bool AdmissionController::admit(const std::string& path, std::chrono::milliseconds requested_deadline,
+                                Ticket& ticket) {
+    // Route gate first (most specific), then the service-wide gate
+    const size_t route_gate = route_gate_for(path);
+    start_ticket(route_gate, requested_deadline, ticket);
+
+    if (route_gate != 0) {
+        if (!acquire(*gates_[route_gate], ticket.deadline)) {
+            return false;
+        }
+        ticket.gates.push_back(route_gate);
+    }
+
+    if (!acquire(*gates_[0], ticket.deadline)) {
+        if (route_gate != 0) {
+            release(*gates_[route_gate], std::chrono::nanoseconds(0));
+        }
+        ticket.gates.clear();
+        return false;
+    }
+    ticket.gates.push_back(0);
+
+    return true;
+}
+
+bool AdmissionController::admit_route(const std::string& path, std::chrono::milliseconds requested_deadline,
+                                      Ticket& ticket) {
+    const size_t route_gate = route_gate_for(path);
+    start_ticket(route_gate, requested_deadline, ticket);
+
+    if (route_gate == 0) {
+        return true;
+    }
+    if (!acquire(*gates_[route_gate], ticket.deadline)) {
+        return false;
+    }
+    ticket.gates.push_back(route_gate);
+    return true;
+}
+
+void AdmissionController::complete(const Ticket& ticket) {
+    const auto now = Clock::now();
+    const auto latency = now - ticket.started_at;
+
+    // A route with its own limit is judged against its own target only. Its latency (a password
+    // hash is slow by design) says nothing about the rest of the service, so the service-wide
+    // gate gets a neutral sample.
+    const bool route_gated = std::any_of(ticket.gates.begin(), ticket.gates.end(),
+                                         [](size_t gate_index) { return gate_index != 0; });
+
+    for (size_t gate_index : ticket.gates) {
+        Gate& gate = *gates_[gate_index];
+        if (now > ticket.deadline) {
+            std::lock_guard<std::mutex> lock(gate.mutex);
+            ++gate.deadline_exceeded;
+        }
+        release(gate, gate_index == 0 && route_gated ? std::chrono::nanoseconds(0) : latency);
+    }
+}
+
+int AdmissionController::retry_after_seconds() const {
+    // Roughly how long the service-wide queue takes to turn over
+    const auto deadline = gates_[0]->limits.deadline;
+    return static_cast<int>(std::max<long long>(1, std::chrono::ceil<std::chrono::seconds>(deadline).count()));
+}
+
+json AdmissionController::get_stats() {
+    json gates = json::array();
+
+    for (auto& gate : gates_) {
+        std::lock_guard<std::mutex> lock(gate->mutex);
+        gates.push_back({
+            {"route", gate->prefix.empty() ? "*" : gate->prefix},
+            {"limit", static_cast<size_t>(gate->limit)},
+            {"max_concurrency", gate->limits.max_concurrency},
+            {"in_flight", gate->in_flight},
+            {"waiting", gate->waiting},
+            {"admitted", gate->admitted},
+            {"shed", gate->shed},
+            {"timed_out", gate->timed_out},
+            {"deadline_exceeded", gate->deadline_exceeded}
+        });
+    }
+
+    return {{"gates", gates}};
+}
+
+bool AdmissionController::acquire(Gate& gate, Clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(gate.mutex);
+
+    auto has_slot = [&gate] {
+        return gate.in_flight < static_cast<size_t>(gate.limit);
+    };
+
+    if (!has_slot()) {
+        if (gate.waiting >= gate.limits.max_queue) {
+            ++gate.shed;
+            return false;
+        }
+
+        ++gate.waiting;
+        const bool admitted = gate.slot_freed.wait_until(lock, deadline, has_slot);
+        --gate.waiting;
+
+        if (!admitted) {
+            ++gate.timed_out;
+            return false;
+        }
+    }
+
+    ++gate.in_flight;
+    ++gate.admitted;
+    return true;
+}
+
+void AdmissionController::release(Gate& gate, std::chrono::nanoseconds latency) {
+    {
+        std::lock_guard<std::mutex> lock(gate.mutex);
+        --gate.in_flight;
+
+        const auto now = Clock::now();
+        if (latency > gate.limits.target_latency) {
+            // Multiplicative decrease, at most once per target-latency window
+            if (now - gate.last_decrease > gate.limits.target_latency) {
+                gate.limit = std::max(static_cast<double>(gate.limits.min_concurrency), gate.limit * kDecreaseFactor);
+                gate.last_decrease = now;
+            }
+        } else if (latency.count() > 0) {
+            // Additive increase: about +1 per `limit` fast completions
+            gate.limit = std::min(static_cast<double>(gate.limits.max_concurrency), gate.limit + 1.0 / gate.limit);
+        }
+    }
+    gate.slot_freed.notify_one();
+}
@@ -1,67 +1,102 @@
 #include "common/auth_middleware.h"
 #include "common/logger.h"
-#include <random>
-#include <sstream>
-#include <iomanip>
+#include "common/token_cache.h"
+#include <ctime>
+
+namespace {
+
+VerifiedTokenCache& token_cache() {
+    static VerifiedTokenCache cache;
+    return cache;
+}
+
+thread_local const AuthMiddleware::ValidatedScope* validated_scope = nullptr;
+
+} // namespace
+
+std::shared_ptr<SessionStore> AuthMiddleware::session_store_;
+
+AuthMiddleware::ValidatedScope::ValidatedScope(const std::string& authorization, const AuthResult& result)
+    : authorization_(authorization), result_(result), previous_(validated_scope) {
+    validated_scope = this;
+}
+
+AuthMiddleware::ValidatedScope::~ValidatedScope() {
+    validated_scope = previous_;
+}
 
 AuthMiddleware::AuthResult AuthMiddleware::validate_token(const httplib::Request& req) {
     AuthResult result;
     result.is_valid = false;
 
     std::string auth_header = req.get_header_value("Authorization");
+    if (validated_scope != nullptr && auth_header == validated_scope->authorization_) {
+        // The signature holds for the whole batch, the session may not: an earlier sub-request
+        // can be a logout
+        const AuthResult& validated = validated_scope->result_;
+        if (validated.is_valid && session_store_ &&
+            session_store_->is_revoked(validated.session_id, validated.username)) {
+            result.error_message = "Invalid, expired or revoked token";
+            return result;
+        }
+        return validated;
+    }
 
     if (auth_header.empty() || auth_header.substr(0, 7) != "Bearer ") {
         result.error_message = "Missing or invalid Authorization header";
         return result;
     }
 
-    std::string token = auth_header.substr(7);
-
-    if (!verify_jwt_token(token)) {
-        result.error_message = "Invalid or expired token";
-        return result;
-    }
-
-    result.username = extract_username_from_token(token);
-    if (result.username.empty()) {
-        result.error_message = "Could not extract username from token";
+    const auto claims = verify_token(auth_header.substr(7));
+    if (!claims) {
+        result.error_message = "Invalid, expired or revoked token";
         return result;
     }
 
+    result.username = claims->username;
+    result.session_id = claims->session_id;
     result.is_valid = true;
     return result;
 }
 
-std::string AuthMiddleware::generate_jwt_token(const std::string& username) {
-    // Simple token generation for demo (in real app, use proper JWT library)
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dis(0, 15);
-
-    std::stringstream token;
-    token << "jwt_" << username << "_";
-
-    for (int i = 0; i < 32; ++i) {
-        token << std::hex << dis(gen);
-    }
-
-    return token.str();
+std::string AuthMiddleware::generate_jwt_token(const std::string& username, const std::string& session_id) {
+    return TokenSigner::instance().sign(username, session_id, kAccessTokenTtlSeconds);
 }
 
 bool AuthMiddleware::verify_jwt_token(const std::string& token) {
-    // Simple validation for demo (in real app, verify JWT signature)
-    return !token.empty() && token.substr(0, 4) == "jwt_";
+    return verify_token(token).has_value();
 }
 
 std::string AuthMiddleware::extract_username_from_token(const std::string& token) {
-    if (token.substr(0, 4) == "jwt_") {
-        size_t start = 4;
-        size_t end = token.find('_', start);
-        if (end != std::string::npos) {
-            return token.substr(start, end - start);
+    const auto claims = verify_token(token);
+    return claims ? claims->username : "";
+}
+
+std::optional<TokenSigner::Claims> AuthMiddleware::verify_token(const std::string& token) {
+    auto claims = token_cache().find(token, std::time(nullptr));
+    if (!claims) {
+        claims = TokenSigner::instance().verify(token);
+        if (!claims) {
+            return std::nullopt;
         }
+        token_cache().insert(token, *claims);
     }
-    return "";
+
+    // Not cached with the signature: a logout has to take effect on the very next request
+    if (session_store_ && (claims->session_id.empty() ||
+                           session_store_->is_revoked(claims->session_id, claims->username))) {
+        return std::nullopt;
+    }
+
+    return claims;
+}
+
+void AuthMiddleware::set_session_store(std::shared_ptr<SessionStore> session_store) {
+    session_store_ = std::move(session_store);
+}
+
+json AuthMiddleware::get_token_cache_stats() {
+    return token_cache().get_stats();
 }
 
 bool AuthMiddleware::validate_credentials(const std::string& username, const std::string& password) {
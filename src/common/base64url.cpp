@@ -0,0 +1,73 @@
+#include "common/base64url.h"
+#include <array>
+#include <cstdint>
+
+namespace {
+
+constexpr char kBase64UrlAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+} // namespace
+
+std::string Base64Url::encode(std::string_view data) {
+    std::string out;
+    out.reserve((data.size() * 4 + 2) / 3);
+
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        const uint32_t chunk = (static_cast<uint8_t>(data[i]) << 16) |
+                               (static_cast<uint8_t>(data[i + 1]) << 8) | static_cast<uint8_t>(data[i + 2]);
+        out += kBase64UrlAlphabet[(chunk >> 18) & 0x3f];
+        out += kBase64UrlAlphabet[(chunk >> 12) & 0x3f];
+        out += kBase64UrlAlphabet[(chunk >> 6) & 0x3f];
+        out += kBase64UrlAlphabet[chunk & 0x3f];
+    }
+
+    if (i < data.size()) {
+        uint32_t chunk = static_cast<uint8_t>(data[i]) << 16;
+        if (i + 1 < data.size()) {
+            chunk |= static_cast<uint8_t>(data[i + 1]) << 8;
+        }
+        out += kBase64UrlAlphabet[(chunk >> 18) & 0x3f];
+        out += kBase64UrlAlphabet[(chunk >> 12) & 0x3f];
+        if (i + 1 < data.size()) {
+            out += kBase64UrlAlphabet[(chunk >> 6) & 0x3f];
+        }
+    }
+
+    return out;
+}
+
+std::optional<std::string> Base64Url::decode(std::string_view data) {
+    static const auto decode_table = [] {
+        std::array<int8_t, 256> table;
+        table.fill(-1);
+        for (int i = 0; i < 64; ++i) {
+            table[static_cast<uint8_t>(kBase64UrlAlphabet[i])] = static_cast<int8_t>(i);
+        }
+        return table;
+    }();
+
+    if (data.size() % 4 == 1) {
+        return std::nullopt;
+    }
+
+    std::string out;
+    out.reserve(data.size() * 3 / 4);
+
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : data) {
+        const int8_t value = decode_table[static_cast<uint8_t>(c)];
+        if (value < 0) {
+            return std::nullopt;
+        }
+        buffer = (buffer << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += static_cast<char>((buffer >> bits) & 0xff);
+        }
+    }
+
+    return out;
+}
@@ -0,0 +1,204 @@
+#include "common/content_filter.h"
+#include "common/logger.h"
+#include <chrono>
+#include <deque>
+#include <fstream>
+
+namespace {
+
+uint8_t fold(uint8_t byte) {
+    return (byte >= 'A' && byte <= 'Z') ? static_cast<uint8_t>(byte - 'A' + 'a') : byte;
+}
+
+} // namespace
+
+ContentFilter::ContentFilter() : automaton_(build({})) {
+}
+
+std::shared_ptr<const ContentFilter::Automaton> ContentFilter::build(const std::vector<std::string>& patterns) {
+    auto automaton = std::make_shared<Automaton>();
+
+    // Bytes that appear in no pattern share class 0, which keeps rows short
+    for (const auto& pattern : patterns) {
+        for (char c : pattern) {
+            const uint8_t folded = fold(static_cast<uint8_t>(c));
+            if (automaton->byte_class[folded] == 0) {
+                automaton->byte_class[folded] = static_cast<uint8_t>(automaton->class_count++);
+            }
+        }
+    }
+    for (int upper = 'A'; upper <= 'Z'; ++upper) {
+        automaton->byte_class[upper] = automaton->byte_class[upper - 'A' + 'a'];
+    }
+
+    const uint32_t classes = automaton->class_count;
+    auto& table = automaton->transitions;
+    std::vector<uint32_t> pattern_at;  // per state, pattern index + 1 (0: none)
+    table.assign(classes, 0);
+    pattern_at.assign(1, 0);
+
+    // Trie; during construction 0 means "no edge" (nothing points back at the root yet)
+    for (uint32_t index = 0; index < patterns.size(); ++index) {
+        const std::string& pattern = patterns[index];
+        if (pattern.empty()) {
+            continue;
+        }
+        automaton->patterns.push_back(pattern);
+
+        uint32_t state = 0;
+        for (char c : pattern) {
+            const uint32_t cls = automaton->byte_class[fold(static_cast<uint8_t>(c))];
+            uint32_t& next = table[state * classes + cls];
+            if (next == 0) {
+                next = static_cast<uint32_t>(pattern_at.size());
+                pattern_at.push_back(0);
+                table.resize(table.size() + classes, 0);
+            }
+            state = table[state * classes + cls];
+        }
+        if (pattern_at[state] == 0) {
+            pattern_at[state] = static_cast<uint32_t>(automaton->patterns.size());
+        }
+    }
+
+    const size_t state_count = pattern_at.size();
+    if (state_count >= (kAcceptBit / classes)) {
+        LOG_ERROR("Content filter blocklist is too large (" + std::to_string(state_count) + " states), ignoring it");
+        return build({});
+    }
+
+    // Breadth-first: fail links, inherited matches, and the missing edges filled in from the fail state
+    std::vector<uint32_t> fail(state_count, 0);
+    std::deque<uint32_t> queue;
+    for (uint32_t cls = 0; cls < classes; ++cls) {
+        if (table[cls] != 0) {
+            queue.push_back(table[cls]);
+        }
+    }
+    while (!queue.empty()) {
+        const uint32_t state = queue.front();
+        queue.pop_front();
+        if (pattern_at[state] == 0) {
+            pattern_at[state] = pattern_at[fail[state]];
+        }
+
+        for (uint32_t cls = 0; cls < classes; ++cls) {
+            uint32_t& next = table[state * classes + cls];
+            const uint32_t fallback = table[fail[state] * classes + cls];
+            if (next != 0) {
+                fail[next] = fallback;
+                queue.push_back(next);
+            } else {
+                next = fallback;
+            }
+        }
+    }
+
+    // Store row offsets with the accept bit so the scan loop never multiplies or touches a second array
+    for (auto& next : table) {
+        next = next * classes | (pattern_at[next] != 0 ? kAcceptBit : 0);
+    }
+    automaton->match = std::move(pattern_at);
+    automaton->state_count = state_count;
+
+    return automaton;
+}
+
+size_t ContentFilter::load_patterns(const std::vector<std::string>& patterns) {
+    auto automaton = build(patterns);
+    const size_t count = automaton->patterns.size();
+    automaton_.store(std::move(automaton));
+    reloads_.fetch_add(1, std::memory_order_relaxed);
+    return count;
+}
+
+bool ContentFilter::load_file(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        LOG_ERROR("Could not open content filter blocklist: " + path);
+        return false;
+    }
+
+    std::vector<std::string> patterns;
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') {
+            continue;
+        }
+        const size_t end = line.find_last_not_of(" \t\r");
+        patterns.push_back(line.substr(begin, end - begin + 1));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(path_mutex_);
+        path_ = path;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    const size_t count = load_patterns(patterns);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    LOG_INFO("Content filter loaded " + std::to_string(count) + " patterns from " + path + " in " +
+             std::to_string(elapsed.count()) + "ms");
+    return true;
+}
+
+bool ContentFilter::reload() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(path_mutex_);
+        path = path_;
+    }
+    return !path.empty() && load_file(path);
+}
+
+std::optional<std::string> ContentFilter::find_blocked_term(std::string_view text) {
+    const auto started = std::chrono::steady_clock::now();
+    const std::shared_ptr<const Automaton> automaton = automaton_.load();
+
+    std::optional<std::string> found;
+    if (!automaton->patterns.empty()) {
+        const uint32_t* table = automaton->transitions.data();
+        const uint8_t* byte_class = automaton->byte_class.data();
+
+        uint32_t row = 0;
+        for (char c : text) {
+            row = table[row + byte_class[static_cast<uint8_t>(c)]];
+            if (row & kAcceptBit) {
+                const uint32_t state = (row & ~kAcceptBit) / automaton->class_count;
+                found = automaton->patterns[automaton->match[state] - 1];
+                break;
+            }
+        }
+    }
+
+    const auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - started).count());
+    scanned_.fetch_add(1, std::memory_order_relaxed);
+    scan_nanoseconds_.fetch_add(elapsed, std::memory_order_relaxed);
+    uint64_t max = max_scan_nanoseconds_.load(std::memory_order_relaxed);
+    while (elapsed > max && !max_scan_nanoseconds_.compare_exchange_weak(max, elapsed, std::memory_order_relaxed)) {
+    }
+    if (found) {
+        blocked_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return found;
+}
+
+json ContentFilter::get_stats() const {
+    const std::shared_ptr<const Automaton> automaton = automaton_.load();
+    const uint64_t scanned = scanned_.load(std::memory_order_relaxed);
+    const uint64_t total_ns = scan_nanoseconds_.load(std::memory_order_relaxed);
+
+    return {
+        {"patterns", automaton->patterns.size()},
+        {"states", automaton->state_count},
+        {"byte_classes", automaton->class_count},
+        {"table_bytes", automaton->transitions.size() * sizeof(uint32_t)},
+        {"reloads", reloads_.load(std::memory_order_relaxed)},
+        {"scanned", scanned},
+        {"blocked", blocked_.load(std::memory_order_relaxed)},
+        {"average_scan_ns", scanned > 0 ? total_ns / scanned : 0},
+        {"max_scan_ns", max_scan_nanoseconds_.load(std::memory_order_relaxed)}
+    };
+}
@@ -1,26 +1,205 @@
 #include "common/http_service.h"
 #include "common/logger.h"
+#include "common/auth_middleware.h"
+#include "common/request_arena.h"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <sstream>
+#include <cstdlib>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::atomic<bool> HttpService::reuse_port_{false};
+
+namespace {
+
+// Admission held by the request this thread is serving. httplib runs pre-routing, the
+// handler and the logger for a request on the same worker thread.
+struct ActiveAdmission {
+    AdmissionController* controller = nullptr;
+    AdmissionController::Ticket ticket;
+};
+
+thread_local ActiveAdmission active_admission;
+
+// ETag computed for the request this thread is serving, attached once the handler succeeds
+thread_local std::string pending_entity_tag;
+
+bool bypasses_admission(const httplib::Request& req) {
+    return req.method == "OPTIONS" || req.path == "/health" || req.path == "/metrics";
+}
+
+std::chrono::milliseconds requested_deadline(const httplib::Request& req) {
+    if (!req.has_header("X-Request-Timeout-Ms")) {
+        return std::chrono::milliseconds(0);
+    }
+    return std::chrono::milliseconds(std::atol(req.get_header_value("X-Request-Timeout-Ms").c_str()));
+}
+
+// Route slot held by a batch sub-request; released however the sub-request ends
+class RouteAdmission {
+public:
+    RouteAdmission(AdmissionController& controller, AdmissionController::Ticket ticket)
+        : controller_(controller), ticket_(std::move(ticket)) {}
+    ~RouteAdmission() { controller_.complete(ticket_); }
+
+    RouteAdmission(const RouteAdmission&) = delete;
+    RouteAdmission& operator=(const RouteAdmission&) = delete;
+
+private:
+    AdmissionController& controller_;
+    AdmissionController::Ticket ticket_;
+};
+
+const std::string kBatchPath = "/api/batch";
+
+// Tasks are claimed by index, so the calling thread finishes the group on its own if no pool
+// thread is free; helpers that start late find nothing left and return. A task that throws still
+// counts as done, so the caller always waits for every task before `tasks` goes away.
+struct ParallelGroup {
+    explicit ParallelGroup(const std::vector<std::function<void()>>& tasks) : tasks(tasks), count(tasks.size()) {}
+
+    // `tasks` belongs to the caller and is only touched while an index is left to claim
+    void run() {
+        size_t index;
+        while ((index = next.fetch_add(1)) < count) {
+            std::exception_ptr failure;
+            try {
+                tasks[index]();
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (failure && !error) {
+                error = failure;
+            }
+            if (++done == count) {
+                finished.notify_all();
+            }
+        }
+    }
+
+    const std::vector<std::function<void()>>& tasks;
+    const size_t count;
+    std::atomic<size_t> next{0};
+    size_t done = 0;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+// Version counters restart with the process, so tags carry a per-process id; a tag handed out
+// before a restart (or by another worker) never matches
+const std::string& process_tag_prefix() {
+    static const std::string prefix = [] {
+        std::random_device random;
+        char buffer[9];
+        std::snprintf(buffer, sizeof(buffer), "%08x", random());
+        return std::string(buffer);
+    }();
+    return prefix;
+}
+
+// If-None-Match uses weak comparison: W/ prefixes are ignored, "*" matches any current tag
+bool if_none_match(const std::string& header, const std::string& tag) {
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) {
+            end = header.size();
+        }
+
+        std::string candidate = header.substr(pos, end - pos);
+        const size_t first = candidate.find_first_not_of(" \t");
+        const size_t last = candidate.find_last_not_of(" \t");
+        candidate = first == std::string::npos ? "" : candidate.substr(first, last - first + 1);
+        if (candidate.compare(0, 2, "W/") == 0) {
+            candidate.erase(0, 2);
+        }
+        if (candidate == "*" || candidate == tag) {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+} // namespace
 
 HttpService::HttpService(const std::string& service_name, int port)
-    : ServiceBase(service_name, port), server_(std::make_unique<httplib::Server>()){
+    : ServiceBase(service_name, port), server_(std::make_unique<httplib::Server>()),
+      listener_enabled_(true), worker_threads_(0),
+      admission_limits_(AdmissionController::default_limits()) {
 }
 
 void HttpService::on_start() {
+    if (!listener_enabled_) {
+        LOG_INFO(get_name() + " runs without its own listener (served through the gateway)");
+        return;
+    }
+
     LOG_INFO("Setting up HTTP server for " + get_name());
+    admission_ = std::make_unique<AdmissionController>(admission_limits_);
+    for (const auto& [prefix, limits] : route_limits_) {
+        admission_->set_route_limits(prefix, limits);
+    }
+
+    rate_limiter_ = std::make_unique<RateLimiter>();
+    for (const auto& [prefix, policy] : rate_policies_) {
+        rate_limiter_->add_policy(prefix, policy);
+    }
+
+    configure_listener();
     setup_middleware();
-    setup_routes();
+    setup_routes(router_);
+    router_.mount(*server_);
+
+    if (WorkerCluster::is_enabled()) {
+        // Forwarded requests skip the public middleware, so they are never re-forwarded
+        internal_server_ = std::make_unique<httplib::Server>();
+        setup_internal_routes(internal_router_);
+        internal_router_.mount(*internal_server_);
+        router_.mount(*internal_server_);
+    }
+
     LOG_INFO("HTTP routes configured for " + get_name());
 }
 
 void HttpService::on_stop() {
-    LOG_INFO("Stopping HTTP server for " + get_name());
+    // httplib stops accepting, then lets queued and in-flight requests finish
+    LOG_INFO("Stopping HTTP server for " + get_name() + " (draining in-flight requests)");
     if (server_) {
         server_->stop();
     }
+
+    if (internal_server_) {
+        internal_server_->stop();
+        if (internal_thread_.joinable()) {
+            internal_thread_.join();
+        }
+        unlink(WorkerCluster::socket_path(get_name(), WorkerCluster::worker_index()).c_str());
+    }
 }
 
 void HttpService::run_service() {
+    if (!listener_enabled_) {
+        return;
+    }
+
+    if (internal_server_) {
+        const std::string socket_path = WorkerCluster::socket_path(get_name(), WorkerCluster::worker_index());
+        unlink(socket_path.c_str());
+
+        internal_thread_ = std::thread([this, socket_path] {
+            if (!internal_server_->set_address_family(AF_UNIX).listen(socket_path, 80)) {
+                LOG_ERROR("Failed to start internal listener on " + socket_path);
+            }
+        });
+    }
+
     LOG_INFO("Starting HTTP server on port " + std::to_string(get_port()));
 
     if (!server_->listen("0.0.0.0", get_port())) {
@@ -31,32 +210,487 @@ void HttpService::run_service() {
     LOG_INFO("HTTP server stopped for " + get_name());
 }
 
-void HttpService::setup_middleware() const {
+void HttpService::set_reuse_port(bool enabled) {
+    reuse_port_ = enabled;
+}
+
+bool HttpService::is_reuse_port_enabled() {
+    return reuse_port_;
+}
+
+void HttpService::set_listener_enabled(bool enabled) {
+    listener_enabled_ = enabled;
+}
+
+void HttpService::register_routes(Router& router) {
+    setup_routes(router);
+}
+
+void HttpService::setup_internal_routes(Router& /*router*/) {
+}
+
+std::vector<std::string> HttpService::route_prefixes() const {
+    return {};
+}
+
+void HttpService::set_worker_threads(size_t worker_threads) {
+    worker_threads_ = worker_threads;
+}
+
+void HttpService::set_admission_limits(const AdmissionController::Limits& limits) {
+    admission_limits_ = limits;
+}
+
+const std::vector<std::pair<std::string, AdmissionController::Limits>>& HttpService::route_limits() const {
+    return route_limits_;
+}
+
+void HttpService::limit_route(const std::string& path_prefix, const AdmissionController::Limits& limits) {
+    route_limits_.emplace_back(path_prefix, limits);
+}
+
+const std::vector<std::pair<std::string, RateLimiter::Policy>>& HttpService::rate_policies() const {
+    return rate_policies_;
+}
+
+void HttpService::limit_rate(const std::string& path_prefix, const RateLimiter::Policy& policy) {
+    rate_policies_.emplace_back(path_prefix, policy);
+}
+
+const std::vector<HttpService::EntityTagRoute>& HttpService::entity_tag_routes() const {
+    return entity_tag_routes_;
+}
+
+void HttpService::tag_route(const std::string& pattern, EntityTagFunction tag) {
+    entity_tag_routes_.push_back({pattern, std::regex(pattern), std::move(tag)});
+}
+
+void HttpService::configure_listener() {
+    const bool reuse_port = reuse_port_;
+
+    // Queued requests wait on a pool thread, so by default leave room for the whole queue
+    const size_t worker_threads = worker_threads_ > 0
+        ? worker_threads_
+        : admission_limits_.max_concurrency + admission_limits_.max_queue;
+    server_->new_task_queue = [this, worker_threads] {
+        auto* pool = new httplib::ThreadPool(worker_threads);
+        task_queue_ = pool;
+        return pool;
+    };
+
+    server_->set_socket_options([reuse_port](socket_t sock) {
+        int yes = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+#ifdef SO_REUSEPORT
+        // Only opt in explicitly, otherwise a second instance could silently share our port
+        if (reuse_port) {
+            setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+        }
+#endif
+    });
+
+    if (reuse_port) {
+        LOG_INFO(get_name() + " listener uses SO_REUSEPORT (hot restart mode)");
+    }
+}
+
+void HttpService::setup_middleware() {
     // CORS middleware
-    server_->set_pre_routing_handler([](const httplib::Request& req, httplib::Response& res) {
+    server_->set_pre_routing_handler([this](const httplib::Request& req, httplib::Response& res) {
         res.set_header("Access-Control-Allow-Origin", "*");
-       res.set_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-       res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
-       return httplib::Server::HandlerResponse::Unhandled;
+        res.set_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
+        res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization, If-None-Match, Idempotency-Key");
+        res.set_header("Access-Control-Expose-Headers", "ETag, Idempotent-Replayed");
+
+        if (!bypasses_admission(req)) {
+            // Cheapest rejection first: throttled clients never take an admission slot, and an
+            // unchanged resource is answered from its version counter without one
+            if (!check_rate_limit(req, res) || answer_not_modified(req, res) || !admit_request(req, res)) {
+                return httplib::Server::HandlerResponse::Handled;
+            }
+
+            // A batch is served here; its sub-requests are routed one by one
+            if (req.path == kBatchPath) {
+                return httplib::Server::HandlerResponse::Unhandled;
+            }
+
+            if (handle_before_routing(req, res)) {
+                return httplib::Server::HandlerResponse::Handled;
+            }
+
+            // Partitioned state: hand the request to the worker that owns it
+            if (WorkerCluster::is_enabled() && route_to_worker(req, res)) {
+                return httplib::Server::HandlerResponse::Handled;
+            }
+        }
+
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+
+    // A tag computed before the handler ran is only as new as the data it served, never newer
+    server_->set_post_routing_handler([this](const httplib::Request&, httplib::Response& res) {
+        if (!pending_entity_tag.empty() && res.status == 200) {
+            res.set_header("ETag", pending_entity_tag);
+            res.set_header("Vary", "Authorization");
+            tagged_responses_.fetch_add(1, std::memory_order_relaxed);
+        }
+        pending_entity_tag.clear();
     });
 
     // Logging middleware
     server_->set_logger([this](const httplib::Request& req, const httplib::Response& res) {
+        complete_request();
         log_request(req, res);
     });
 
     // Health check endpoint (common for all services)
-    server_->Get("/health", [this](const httplib::Request& req, httplib::Response& res) {
-        const json health_data = {
+    server_->Get("/health", [this](const httplib::Request&, httplib::Response& res) {
+        json health_data = {
             {"service", get_name()},
             {"status", "healthy"},
             {"port", get_port()},
             {"timestamp", std::time(nullptr)}
         };
+
+        if (WorkerCluster::is_enabled()) {
+            health_data["worker"] = WorkerCluster::worker_index();
+            health_data["workers"] = WorkerCluster::worker_count();
+        }
+
         send_json_response(res, 200, health_data);
     });
+
+    server_->Post(kBatchPath, [this](const httplib::Request& req, httplib::Response& res) {
+        handle_batch(req, res);
+    });
+
+    // Metrics endpoint (never shed, so it stays readable under overload)
+    server_->Get("/metrics", [this](const httplib::Request&, httplib::Response& res) {
+        send_json_response(res, 200, collect_metrics());
+    });
+}
+
+bool HttpService::check_rate_limit(const httplib::Request& req, httplib::Response& res) {
+    if (!rate_limiter_->has_policies()) {
+        return true;
+    }
+
+    // Only a verified token identifies a user; otherwise the client address alone counts
+    std::string username;
+    if (req.has_header("Authorization")) {
+        auto auth_result = AuthMiddleware::validate_token(req);
+        if (auth_result.is_valid) {
+            username = auth_result.username;
+        }
+    }
+
+    const auto decision = rate_limiter_->check(req.path, username, req.remote_addr);
+    if (decision.allowed) {
+        return true;
+    }
+
+    const auto retry_after = std::chrono::ceil<std::chrono::seconds>(decision.retry_after);
+    LOG_DEBUG("[" + get_name() + "] Rate limited " + req.method + " " + req.path +
+              (username.empty() ? "" : " for " + username) + " from " + req.remote_addr);
+    res.set_header("Retry-After", std::to_string(std::max<long long>(1, retry_after.count())));
+    send_error_response(res, 429, "Too many requests, retry later");
+    return false;
+}
+
+bool HttpService::admit_request(const httplib::Request& req, httplib::Response& res) {
+    // A request whose response was never logged (client went away) still holds its slot
+    complete_request();
+
+    AdmissionController::Ticket ticket;
+    if (!admission_->admit(req.path, requested_deadline(req), ticket)) {
+        LOG_WARNING("[" + get_name() + "] Shedding " + req.method + " " + req.path + " (overloaded)");
+        res.set_header("Retry-After", std::to_string(admission_->retry_after_seconds()));
+        send_error_response(res, 503, "Service overloaded, retry later");
+        return false;
+    }
+
+    active_admission.controller = admission_.get();
+    active_admission.ticket = std::move(ticket);
+    return true;
+}
+
+bool HttpService::answer_not_modified(const httplib::Request& req, httplib::Response& res) {
+    pending_entity_tag.clear();
+    if (req.method != "GET" || entity_tag_routes_.empty()) {
+        return false;
+    }
+
+    for (const auto& route : entity_tag_routes_) {
+        std::smatch match;
+        if (!std::regex_match(req.path, match, route.regex)) {
+            continue;
+        }
+
+        auto tag = route.tag(req, match);
+        if (!tag) {
+            return false;
+        }
+
+        pending_entity_tag = "\"" + process_tag_prefix() + "-" + *tag + "\"";
+        if (req.has_header("If-None-Match") && if_none_match(req.get_header_value("If-None-Match"), pending_entity_tag)) {
+            res.status = 304;
+            res.set_header("ETag", pending_entity_tag);
+            res.set_header("Vary", "Authorization");
+            pending_entity_tag.clear();
+            not_modified_responses_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    return false;
+}
+
+void HttpService::handle_batch(const httplib::Request& req, httplib::Response& res) {
+    auto body = json::parse(req.body, nullptr, false);
+    if (!body.is_object() || !body.contains("requests") || !body["requests"].is_array()) {
+        send_error_response(res, 400, "Field 'requests' must be an array");
+        return;
+    }
+
+    const auto& items = body["requests"];
+    if (items.empty() || items.size() > kMaxBatchSize) {
+        send_error_response(res, 400, "A batch holds 1 to " + std::to_string(kMaxBatchSize) + " requests");
+        return;
+    }
+
+    // The token is checked once; sub-requests carrying it reuse the result. Without a valid token
+    // the batch still runs, and sub-requests that need one fail on their own.
+    const std::string authorization = req.get_header_value("Authorization");
+    const AuthMiddleware::AuthResult auth_result = AuthMiddleware::validate_token(req);
+
+    std::vector<httplib::Request> requests(items.size());
+    std::vector<httplib::Response> responses(items.size());
+    std::vector<bool> runnable(items.size(), false);
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        const auto& item = items[i];
+        const std::string method = item.is_object() ? item.value("method", "GET") : "";
+        const std::string target = item.is_object() ? item.value("path", "") : "";
+        if (method != "GET" && method != "POST" && method != "PUT" && method != "DELETE") {
+            send_error_response(responses[i], 400, "Sub-request method must be GET, POST, PUT or DELETE");
+            continue;
+        }
+        if (target.compare(0, 5, "/api/") != 0 || target.compare(0, kBatchPath.size(), kBatchPath) == 0) {
+            send_error_response(responses[i], 400, "Sub-request path must be an API route other than " + kBatchPath);
+            continue;
+        }
+
+        auto& sub = requests[i];
+        sub.method = method;
+        sub.remote_addr = req.remote_addr;
+        sub.headers = req.headers;
+        sub.headers.erase("Content-Length");
+        // The key names the batch as a whole; passed down, every send in it would claim the same key
+        sub.headers.erase("Idempotency-Key");
+
+        const size_t query = target.find('?');
+        sub.path = target.substr(0, query);
+        if (query != std::string::npos) {
+            httplib::detail::parse_query_text(target.substr(query + 1), sub.params);
+        }
+        if (item.contains("body")) {
+            sub.body = item["body"].is_string() ? item["body"].get<std::string>() : item["body"].dump();
+        }
+        runnable[i] = true;
+    }
+
+    // A sub-request that throws fails on its own; the rest of the batch still runs
+    auto run = [&](size_t i) {
+        try {
+            AuthMiddleware::ValidatedScope scope(authorization, auth_result);
+            execute_subrequest(requests[i], responses[i]);
+        } catch (const std::exception& e) {
+            LOG_ERROR("[" + get_name() + "] Batch sub-request " + requests[i].method + " " +
+                      requests[i].path + " failed: " + e.what());
+            responses[i] = httplib::Response();
+            send_error_response(responses[i], 500, "Internal server error");
+        } catch (...) {
+            LOG_ERROR("[" + get_name() + "] Batch sub-request " + requests[i].method + " " +
+                      requests[i].path + " failed");
+            responses[i] = httplib::Response();
+            send_error_response(responses[i], 500, "Internal server error");
+        }
+    };
+
+    // Runs of reads go out in parallel; anything else waits for what came before it and runs alone,
+    // so a client can rely on list order for writes
+    size_t i = 0;
+    while (i < items.size()) {
+        if (!runnable[i]) {
+            ++i;
+            continue;
+        }
+        if (requests[i].method != "GET") {
+            run(i++);
+            continue;
+        }
+
+        std::vector<std::function<void()>> reads;
+        for (; i < items.size() && (!runnable[i] || requests[i].method == "GET"); ++i) {
+            if (runnable[i]) {
+                reads.push_back([&run, i] { run(i); });
+            }
+        }
+        run_in_parallel(reads);
+    }
+
+    json results = json::array();
+    for (size_t i = 0; i < items.size(); ++i) {
+        const auto& sub = responses[i];
+        json result = {
+            {"status", sub.status}
+        };
+        if (items[i].is_object() && items[i].contains("id")) {
+            result["id"] = items[i]["id"];
+        }
+        auto sub_body = json::parse(sub.body, nullptr, false);
+        result["body"] = sub_body.is_discarded() ? json(sub.body) : std::move(sub_body);
+        results.push_back(std::move(result));
+    }
+
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    batch_subrequests_.fetch_add(items.size(), std::memory_order_relaxed);
+
+    send_json_response(res, 200, {{"responses", results}});
+    LOG_INFO("[" + get_name() + "] Batch of " + std::to_string(items.size()) + " requests" +
+             (auth_result.is_valid ? " for " + auth_result.username : ""));
 }
 
+void HttpService::execute_subrequest(httplib::Request& req, httplib::Response& res) {
+    // The public pipeline, except that the batch already holds the service-wide slot: each
+    // sub-request is charged against its own rate policy and route limit only
+    if (!check_rate_limit(req, res)) {
+        return;
+    }
+
+    AdmissionController::Ticket ticket;
+    if (!admission_->admit_route(req.path, requested_deadline(req), ticket)) {
+        LOG_WARNING("[" + get_name() + "] Shedding batched " + req.method + " " + req.path + " (overloaded)");
+        res.set_header("Retry-After", std::to_string(admission_->retry_after_seconds()));
+        send_error_response(res, 503, "Service overloaded, retry later");
+        return;
+    }
+    RouteAdmission admission(*admission_, std::move(ticket));
+
+    if (handle_before_routing(req, res)) {
+        return;
+    }
+    if (WorkerCluster::is_enabled() && route_to_worker(req, res)) {
+        return;
+    }
+    if (!router_.dispatch(req, res)) {
+        send_error_response(res, 404, "No route for " + req.method + " " + req.path);
+    }
+    if (res.status == -1) {
+        res.status = 200;
+    }
+}
+
+void HttpService::run_in_parallel(const std::vector<std::function<void()>>& tasks) {
+    auto group = std::make_shared<ParallelGroup>(tasks);
+
+    httplib::TaskQueue* pool = task_queue_.load();
+    if (pool != nullptr) {
+        for (size_t helper = 1; helper < tasks.size(); ++helper) {
+            pool->enqueue([group] { group->run(); });
+        }
+    }
+
+    group->run();
+    std::unique_lock<std::mutex> lock(group->mutex);
+    group->finished.wait(lock, [&] { return group->done == tasks.size(); });
+    if (group->error) {
+        std::rethrow_exception(group->error);
+    }
+}
+
+void HttpService::complete_request() {
+    if (active_admission.controller != nullptr) {
+        active_admission.controller->complete(active_admission.ticket);
+        active_admission.controller = nullptr;
+    }
+}
+
+json HttpService::collect_metrics() {
+    json metrics = {
+        {"service", get_name()},
+        {"timestamp", std::time(nullptr)}
+    };
+
+    if (admission_) {
+        metrics["admission"] = admission_->get_stats();
+    }
+    if (rate_limiter_) {
+        metrics["rate_limiter"] = rate_limiter_->get_stats();
+    }
+    if (!entity_tag_routes_.empty()) {
+        metrics["conditional_get"] = {
+            {"tagged", tagged_responses_.load(std::memory_order_relaxed)},
+            {"not_modified", not_modified_responses_.load(std::memory_order_relaxed)}
+        };
+    }
+    if (batches_.load(std::memory_order_relaxed) > 0) {
+        metrics["batch"] = {
+            {"batches", batches_.load(std::memory_order_relaxed)},
+            {"subrequests", batch_subrequests_.load(std::memory_order_relaxed)}
+        };
+    }
+    // Process-wide: every service's handlers run in the same per-thread arenas
+    metrics["request_arena"] = RequestArena::get_stats();
+
+    if (WorkerCluster::is_enabled()) {
+        metrics["worker"] = WorkerCluster::worker_index();
+    }
+
+    return metrics;
+}
+
+
+bool HttpService::handle_before_routing(const httplib::Request& /*req*/, httplib::Response& /*res*/) {
+    return false;
+}
+
+bool HttpService::route_to_worker(const httplib::Request& req, httplib::Response& res) {
+    auto key = partition_key(req);
+    return key.has_value() && forward_to_owner(key.value(), req, res);
+}
+
+std::optional<std::string> HttpService::partition_key(const httplib::Request& /*req*/) {
+    return std::nullopt;
+}
+
+bool HttpService::forward_to_owner(const std::string& key, const httplib::Request& req, httplib::Response& res) {
+    return forward_to_worker(WorkerCluster::owner_of(key), req, res);
+}
+
+bool HttpService::forward_to_worker(int worker, const httplib::Request& req, httplib::Response& res) {
+    if (worker == WorkerCluster::worker_index() || worker < 0 || worker >= WorkerCluster::worker_count()) {
+        return false;
+    }
+
+    if (!WorkerCluster::forward(get_name(), worker, req, res)) {
+        send_error_response(res, 502, "Worker " + std::to_string(worker) + " is unavailable");
+    }
+    return true;
+}
+
+std::vector<json> HttpService::gather_from_workers(const httplib::Request& req) {
+    std::vector<json> bodies(WorkerCluster::worker_count(), json());
+
+    for (auto& response : WorkerCluster::gather(get_name(), req)) {
+        if (response.ok && response.response.status == 200) {
+            bodies[response.worker] = json::parse(response.response.body, nullptr, false);
+        }
+    }
+
+    return bodies;
+}
 
 void HttpService::send_json_response(httplib::Response& res, int status, const json& data) {
     res.status = status;
@@ -0,0 +1,115 @@
+#include "common/idempotency_cache.h"
+#include <functional>
+
+IdempotencyCache::IdempotencyCache(size_t capacity_per_shard, int64_t ttl_seconds)
+    : capacity_per_shard_(capacity_per_shard), ttl_seconds_(ttl_seconds) {
+}
+
+IdempotencyCache::Claim IdempotencyCache::claim(const std::string& username, const std::string& key,
+                                                uint64_t fingerprint, int64_t now) {
+    const std::string scoped = scoped_key(username, key);
+    Shard& shard = shard_for(scoped);
+    const auto deadline = std::chrono::steady_clock::now() + kInFlightWait;
+    bool waited = false;
+
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    for (;;) {
+        evict(shard, now);
+
+        auto it = shard.index.find(scoped);
+        if (it == shard.index.end()) {
+            shard.entries.push_back({scoped, fingerprint, now + ttl_seconds_, false, {}});
+            shard.index[scoped] = std::prev(shard.entries.end());
+            return {Claim::Kind::Owner, {}};
+        }
+
+        const Entry& entry = *it->second;
+        if (entry.fingerprint != fingerprint) {
+            mismatches_.fetch_add(1, std::memory_order_relaxed);
+            return {Claim::Kind::Mismatch, {}};
+        }
+        if (entry.done) {
+            replays_.fetch_add(1, std::memory_order_relaxed);
+            return {Claim::Kind::Replay, entry.response};
+        }
+
+        // Same request still running: wait for its answer rather than writing twice
+        if (!waited) {
+            waits_.fetch_add(1, std::memory_order_relaxed);
+            waited = true;
+        }
+        if (shard.settled.wait_until(lock, deadline) == std::cv_status::timeout) {
+            return {Claim::Kind::Busy, {}};
+        }
+    }
+}
+
+void IdempotencyCache::complete(const std::string& username, const std::string& key, StoredResponse response) {
+    const std::string scoped = scoped_key(username, key);
+    Shard& shard = shard_for(scoped);
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(scoped);
+        if (it == shard.index.end() || it->second->done) {
+            return; // Evicted while running
+        }
+        it->second->done = true;
+        it->second->response = std::move(response);
+    }
+    stored_.fetch_add(1, std::memory_order_relaxed);
+    shard.settled.notify_all();
+}
+
+void IdempotencyCache::abandon(const std::string& username, const std::string& key) {
+    const std::string scoped = scoped_key(username, key);
+    Shard& shard = shard_for(scoped);
+
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(scoped);
+        if (it == shard.index.end() || it->second->done) {
+            return;
+        }
+        shard.entries.erase(it->second);
+        shard.index.erase(it);
+    }
+    // One of the waiters becomes the new owner
+    shard.settled.notify_all();
+}
+
+json IdempotencyCache::get_stats() const {
+    size_t entries = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        entries += shard.entries.size();
+    }
+
+    return {
+        {"entries", entries},
+        {"capacity", capacity_per_shard_ * kShardCount},
+        {"stored", stored_.load(std::memory_order_relaxed)},
+        {"replays", replays_.load(std::memory_order_relaxed)},
+        {"waits", waits_.load(std::memory_order_relaxed)},
+        {"mismatches", mismatches_.load(std::memory_order_relaxed)}
+    };
+}
+
+std::string IdempotencyCache::scoped_key(const std::string& username, const std::string& key) {
+    // Usernames can't contain a newline, so the pair can't be forged from another user's key
+    return username + '\n' + key;
+}
+
+IdempotencyCache::Shard& IdempotencyCache::shard_for(const std::string& scoped) {
+    return shards_[std::hash<std::string>{}(scoped) % kShardCount];
+}
+
+void IdempotencyCache::evict(Shard& shard, int64_t now) {
+    // Caller holds the shard lock. Entries still running can be pushed out by capacity; their
+    // owners' complete() then finds nothing, and a later retry runs again.
+    while (!shard.entries.empty() &&
+           (shard.entries.front().expires_at <= now || shard.entries.size() >= capacity_per_shard_)) {
+        shard.index.erase(shard.entries.front().key);
+        shard.entries.pop_front();
+    }
+}
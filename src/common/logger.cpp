@@ -2,6 +2,8 @@
 
 #include <string>
 
+std::atomic<bool> Logger::debug_enabled_{false};
+
 void Logger::log(Level level, const std::string& message) {
     std::cout << "[" << get_current_time() << "] "
            << "[" << level_to_string(level) << "] "
@@ -22,7 +24,17 @@ void Logger::error(const std::string& message) {
 }
 
 void Logger::debug(const std::string& message) {
-    log(Level::DEBUG, message);
+    if (is_debug_enabled()) {
+        log(Level::DEBUG, message);
+    }
+}
+
+void Logger::set_debug_enabled(bool enabled) {
+    debug_enabled_ = enabled;
+}
+
+bool Logger::is_debug_enabled() {
+    return debug_enabled_.load(std::memory_order_relaxed);
 }
 
 std::string Logger::get_current_time() {
@@ -42,6 +54,8 @@ std::string Logger::level_to_string(Level level) {
             return "WARNING";
         case Level::ERROR:
             return "ERROR";
+        case Level::DEBUG:
+            return "DEBUG";
         default: return "UNKNOWN";
     }
 }
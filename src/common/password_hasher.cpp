@@ -0,0 +1,204 @@
+#include "common/password_hasher.h"
+#include "common/base64url.h"
+#include "common/sha256.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <sstream>
+
+namespace {
+
+constexpr char kScheme[] = "pbkdf2-sha256";
+constexpr size_t kDerivedKeyBytes = 32;
+
+struct ParsedHash {
+    uint32_t iterations;
+    std::string salt;
+    std::string hash;
+};
+
+std::optional<ParsedHash> parse_hash(const std::string& encoded) {
+    std::vector<std::string> parts;
+    std::stringstream stream(encoded);
+    std::string part;
+    while (std::getline(stream, part, '$')) {
+        parts.push_back(part);
+    }
+
+    if (parts.size() != 4 || parts[0] != kScheme) {
+        return std::nullopt;
+    }
+
+    ParsedHash parsed;
+    try {
+        const unsigned long iterations = std::stoul(parts[1]);
+        if (iterations == 0 || iterations > 10000000) {
+            return std::nullopt;
+        }
+        parsed.iterations = static_cast<uint32_t>(iterations);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+
+    auto salt = Base64Url::decode(parts[2]);
+    auto hash = Base64Url::decode(parts[3]);
+    if (!salt || !hash || hash->empty()) {
+        return std::nullopt;
+    }
+    parsed.salt = std::move(*salt);
+    parsed.hash = std::move(*hash);
+    return parsed;
+}
+
+bool constant_time_equals(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+} // namespace
+
+PasswordHasher::PasswordHasher(Options options) : options_(options), stopping_(false) {
+    const size_t threads = std::max<size_t>(1, options_.threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&PasswordHasher::worker_loop, this);
+    }
+
+    LOG_INFO("Password hasher: pbkdf2-sha256, " + std::to_string(options_.iterations) + " iterations, " +
+             std::to_string(threads) + " threads, queue " + std::to_string(options_.max_queue));
+}
+
+PasswordHasher::~PasswordHasher() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        stopping_ = true;
+    }
+    queue_cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+std::optional<std::future<std::string>> PasswordHasher::hash_async(std::string password) {
+    auto task = std::make_shared<std::packaged_task<std::string()>>(
+        [this, password = std::move(password)] { return hash(password); });
+    auto future = task->get_future();
+
+    if (!submit([task] { (*task)(); })) {
+        return std::nullopt;
+    }
+    return future;
+}
+
+std::optional<std::future<PasswordHasher::VerifyResult>> PasswordHasher::verify_async(std::string password,
+                                                                                     std::string encoded_hash) {
+    auto task = std::make_shared<std::packaged_task<VerifyResult()>>(
+        [this, password = std::move(password), encoded_hash = std::move(encoded_hash)] {
+            return verify(password, encoded_hash);
+        });
+    auto future = task->get_future();
+
+    if (!submit([task] { (*task)(); })) {
+        return std::nullopt;
+    }
+    return future;
+}
+
+std::string PasswordHasher::hash(const std::string& password) const {
+    std::random_device rd;
+    std::string salt(options_.salt_bytes, '\0');
+    for (auto& byte : salt) {
+        byte = static_cast<char>(rd() & 0xff);
+    }
+
+    const std::string derived = Sha256::pbkdf2(password, salt, options_.iterations, kDerivedKeyBytes);
+    return std::string(kScheme) + "$" + std::to_string(options_.iterations) + "$" +
+           Base64Url::encode(salt) + "$" + Base64Url::encode(derived);
+}
+
+PasswordHasher::VerifyResult PasswordHasher::verify(const std::string& password,
+                                                    const std::string& encoded_hash) const {
+    VerifyResult result{false, std::nullopt};
+
+    const auto parsed = parse_hash(encoded_hash);
+    if (!parsed) {
+        return result;
+    }
+
+    const std::string derived = Sha256::pbkdf2(password, parsed->salt, parsed->iterations, parsed->hash.size());
+    result.matches = constant_time_equals(derived, parsed->hash);
+
+    // Parameters changed since this hash was stored: upgrade it while we have the plaintext
+    if (result.matches && (parsed->iterations != options_.iterations ||
+                           parsed->salt.size() != options_.salt_bytes ||
+                           parsed->hash.size() != kDerivedKeyBytes)) {
+        result.rehashed = hash(password);
+    }
+
+    return result;
+}
+
+json PasswordHasher::get_stats() {
+    size_t queued = 0;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queued = queue_.size();
+    }
+
+    const uint64_t completed = completed_.load();
+    return {
+        {"iterations", options_.iterations},
+        {"threads", workers_.size()},
+        {"max_queue", options_.max_queue},
+        {"queued", queued},
+        {"running", running_.load()},
+        {"completed", completed},
+        {"rejected", rejected_.load()},
+        {"avg_job_ms", completed == 0 ? 0.0 : busy_microseconds_.load() / 1000.0 / completed}
+    };
+}
+
+bool PasswordHasher::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (stopping_ || queue_.size() >= options_.max_queue) {
+            ++rejected_;
+            return false;
+        }
+        queue_.push_back(std::move(job));
+    }
+    queue_cv_.notify_one();
+    return true;
+}
+
+void PasswordHasher::worker_loop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return; // stopping and drained
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+
+        ++running_;
+        const auto started = std::chrono::steady_clock::now();
+        job();
+        busy_microseconds_ += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - started).count();
+        --running_;
+        ++completed_;
+    }
+}
@@ -0,0 +1,136 @@
+#include "common/rate_limiter.h"
+#include <algorithm>
+#include <mutex>
+
+void RateLimiter::add_policy(const std::string& path_prefix, const Policy& policy) {
+    CompiledPolicy compiled;
+    compiled.prefix = path_prefix;
+    compiled.policy = policy;
+    compiled.emission_interval_ns = static_cast<int64_t>(1e9 / policy.requests_per_second);
+    compiled.tolerance_ns = static_cast<int64_t>(compiled.emission_interval_ns * std::max(1.0, policy.burst));
+    policies_.push_back(std::move(compiled));
+}
+
+RateLimiter::Decision RateLimiter::check(const std::string& path, const std::string& username,
+                                         const std::string& address) {
+    int64_t now = 0;
+
+    for (size_t i = 0; i < policies_.size(); ++i) {
+        const auto& policy = policies_[i];
+        if (path.compare(0, policy.prefix.size(), policy.prefix) != 0) {
+            continue;
+        }
+
+        if (now == 0) {
+            now = now_ns();
+            checks_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        int64_t retry_after_ns = 0;
+        const bool allowed =
+            (!policy.policy.per_user || username.empty() ||
+             take(policy, bucket_key(i, 'u', username), now, retry_after_ns)) &&
+            (!policy.policy.per_address || address.empty() ||
+             take(policy, bucket_key(i, 'a', address), now, retry_after_ns));
+
+        if (!allowed) {
+            limited_.fetch_add(1, std::memory_order_relaxed);
+            return {false, std::chrono::ceil<std::chrono::milliseconds>(std::chrono::nanoseconds(retry_after_ns))};
+        }
+    }
+
+    return {true, std::chrono::milliseconds(0)};
+}
+
+json RateLimiter::get_stats() const {
+    size_t buckets = 0;
+    for (const auto& shard : shards_) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        buckets += shard.buckets.size();
+    }
+
+    return {
+        {"policies", policies_.size()},
+        {"buckets", buckets},
+        {"checks", checks_.load(std::memory_order_relaxed)},
+        {"limited", limited_.load(std::memory_order_relaxed)},
+        {"evicted", evicted_.load(std::memory_order_relaxed)}
+    };
+}
+
+bool RateLimiter::take(const CompiledPolicy& policy, uint64_t key, int64_t now_ns, int64_t& retry_after_ns) {
+    Shard& shard = shards_[key % kShardCount];
+
+    // The CAS runs under the shard lock (shared) so a sweep can't free the bucket mid-update
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.buckets.find(key);
+        if (it != shard.buckets.end()) {
+            return spend(policy, *it->second, now_ns, retry_after_ns);
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (++shard.inserts_since_sweep >= kSweepEvery) {
+        sweep(shard, now_ns);
+    }
+
+    auto& bucket = shard.buckets[key];
+    if (!bucket) {
+        bucket = std::make_unique<Bucket>();
+    }
+    return spend(policy, *bucket, now_ns, retry_after_ns);
+}
+
+bool RateLimiter::spend(const CompiledPolicy& policy, Bucket& bucket, int64_t now_ns, int64_t& retry_after_ns) {
+    int64_t full_at = bucket.full_at_ns.load(std::memory_order_relaxed);
+    while (true) {
+        // Spending a token pushes the "full again" time one interval further out
+        const int64_t next_full_at = std::max(full_at, now_ns) + policy.emission_interval_ns;
+        if (next_full_at - now_ns > policy.tolerance_ns) {
+            retry_after_ns = next_full_at - now_ns - policy.tolerance_ns;
+            return false;
+        }
+
+        if (bucket.full_at_ns.compare_exchange_weak(full_at, next_full_at, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+void RateLimiter::sweep(Shard& shard, int64_t now_ns) {
+    // Caller holds the shard's unique lock. A bucket whose full time has passed is
+    // indistinguishable from a fresh one, so dropping it loses nothing.
+    size_t evicted = 0;
+    for (auto it = shard.buckets.begin(); it != shard.buckets.end();) {
+        if (it->second->full_at_ns.load(std::memory_order_relaxed) <= now_ns) {
+            it = shard.buckets.erase(it);
+            ++evicted;
+        } else {
+            ++it;
+        }
+    }
+
+    shard.inserts_since_sweep = 0;
+    evicted_.fetch_add(evicted, std::memory_order_relaxed);
+}
+
+int64_t RateLimiter::now_ns() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch_).count();
+}
+
+uint64_t RateLimiter::bucket_key(size_t policy_index, char scope, const std::string& id) {
+    // FNV-1a over (policy, scope, id)
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    };
+
+    mix(static_cast<unsigned char>(policy_index));
+    mix(static_cast<unsigned char>(scope));
+    for (unsigned char c : id) {
+        mix(c);
+    }
+    return hash;
+}
@@ -0,0 +1,88 @@
+#include "common/request_arena.h"
+#include <atomic>
+
+namespace {
+
+// Covers a typical request without touching the heap; bigger ones spill into upstream chunks
+constexpr size_t kInitialBlockBytes = 64 * 1024;
+
+std::atomic<uint64_t> requests{0};
+std::atomic<uint64_t> spilled_requests{0};
+std::atomic<uint64_t> spilled_bytes{0};
+
+// Counts what the arena has to take from the heap once the initial block is used up
+class UpstreamResource : public std::pmr::memory_resource {
+public:
+    size_t take_spilled() {
+        const size_t bytes = spilled_;
+        spilled_ = 0;
+        return bytes;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        spilled_ += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+    size_t spilled_ = 0;
+};
+
+struct ThreadArena {
+    ThreadArena() : buffer(new std::byte[kInitialBlockBytes]), resource(buffer.get(), kInitialBlockBytes, &upstream) {
+    }
+
+    std::unique_ptr<std::byte[]> buffer;
+    UpstreamResource upstream;
+    std::pmr::monotonic_buffer_resource resource;
+};
+
+thread_local int scope_depth = 0;
+
+// Created on the first scope a thread opens, so threads that never serve requests don't pay for it
+ThreadArena& thread_arena() {
+    thread_local ThreadArena arena;
+    return arena;
+}
+
+} // namespace
+
+RequestArena::Scope::Scope() {
+    if (scope_depth++ == 0) {
+        requests.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+RequestArena::Scope::~Scope() {
+    // Nested scopes (in-process dispatch through the gateway) share the outer request's arena
+    if (--scope_depth == 0) {
+        ThreadArena& arena = thread_arena();
+        arena.resource.release();
+        if (const size_t bytes = arena.upstream.take_spilled()) {
+            spilled_requests.fetch_add(1, std::memory_order_relaxed);
+            spilled_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::pmr::memory_resource* RequestArena::current() {
+    return scope_depth > 0 ? static_cast<std::pmr::memory_resource*>(&thread_arena().resource)
+                           : std::pmr::new_delete_resource();
+}
+
+json RequestArena::get_stats() {
+    return {
+        {"initial_block_bytes", kInitialBlockBytes},
+        {"requests", requests.load(std::memory_order_relaxed)},
+        {"spilled_requests", spilled_requests.load(std::memory_order_relaxed)},
+        {"spilled_bytes", spilled_bytes.load(std::memory_order_relaxed)}
+    };
+}
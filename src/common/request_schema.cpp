@@ -0,0 +1,51 @@
+#include "common/request_schema.h"
+
+CharClass::CharClass(std::string_view ranges) {
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (i + 2 < ranges.size() && ranges[i + 1] == '-') {
+            for (int c = static_cast<unsigned char>(ranges[i]); c <= static_cast<unsigned char>(ranges[i + 2]); ++c) {
+                table_[c] = true;
+            }
+            i += 2;
+        } else {
+            table_[static_cast<unsigned char>(ranges[i])] = true;
+        }
+    }
+}
+
+bool CharClass::all_of(std::string_view text) const {
+    for (unsigned char c : text) {
+        if (!table_[c]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const CharClass& CharClass::username() {
+    static const CharClass chars("a-zA-Z0-9_");
+    return chars;
+}
+
+bool is_valid_email_address(std::string_view email) {
+    static const CharClass local_chars("a-zA-Z0-9._%+-");
+    static const CharClass domain_chars("a-zA-Z0-9.-");
+    static const CharClass letters("a-zA-Z");
+
+    // local@domain.tld: the tld is whatever follows the last dot and must be 2+ letters
+    const size_t at = email.find('@');
+    if (at == 0 || at == std::string_view::npos) {
+        return false;
+    }
+
+    const std::string_view local = email.substr(0, at);
+    const std::string_view domain = email.substr(at + 1);
+    const size_t last_dot = domain.rfind('.');
+    if (last_dot == 0 || last_dot == std::string_view::npos) {
+        return false;
+    }
+
+    const std::string_view tld = domain.substr(last_dot + 1);
+    return local_chars.all_of(local) && domain_chars.all_of(domain.substr(0, last_dot)) &&
+           tld.size() >= 2 && letters.all_of(tld);
+}
@@ -1,10 +1,8 @@
 #include "common/request_validator.h"
+#include "common/request_schema.h"
+#include "common/text_scanner.h"
 #include "common/logger.h"
 
-const std::regex RequestValidator::email_regex_(
-    R"(^[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}$)"
-);
-
 RequestValidator::ValidationResult RequestValidator::validate_json_body(
     const httplib::Request& req,
     const std::vector<std::string>& required_fields) {
@@ -57,10 +55,45 @@ RequestValidator::ValidationResult RequestValidator::validate_query_params(
 }
 
 bool RequestValidator::is_valid_email(const std::string& email) {
-    return std::regex_match(email, email_regex_);
+    return is_valid_email_address(email);
 }
 
 bool RequestValidator::is_valid_username(const std::string& username) {
-    return username.length() >= 3 && username.length() <= 50 &&
-           std::regex_match(username, std::regex(R"(^[a-zA-Z0-9_]+$)"));
-}
\ No newline at end of file
+    return username.length() >= 3 && username.length() <= 50 && CharClass::username().all_of(username);
+}
+
+bool RequestValidator::is_valid_message_content(const std::string& content, std::string& error_message) {
+    if (content.empty()) {
+        error_message = "Message content cannot be empty";
+        return false;
+    }
+
+    // No code point is longer than 4 bytes, so anything bigger can't fit without scanning it
+    if (content.size() > kMaxMessageCharacters * 4) {
+        error_message = "Message content must be 1000 characters or less";
+        return false;
+    }
+
+    const TextScanner::Result scan = TextScanner::scan(content);
+    if (!scan.valid_utf8) {
+        error_message = "Message content must be valid UTF-8";
+        return false;
+    }
+
+    if (scan.code_points > kMaxMessageCharacters) {
+        error_message = "Message content must be 1000 characters or less";
+        return false;
+    }
+
+    if (scan.has_control) {
+        error_message = "Message content cannot contain control characters";
+        return false;
+    }
+
+    if (scan.all_whitespace) {
+        error_message = "Message content cannot be only whitespace";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,118 @@
+#include "common/response_cache.h"
+#include <functional>
+
+ResponseCache::ResponseCache(size_t max_bytes, std::chrono::seconds max_age)
+    : max_bytes_per_shard_(max_bytes / kShardCount), max_age_(max_age) {
+}
+
+std::string ResponseCache::make_key(const httplib::Request& req, const std::string& username) {
+    // Params is an ordered multimap, so equal queries produce equal keys
+    std::string key = req.method + ' ' + req.path;
+    char separator = '?';
+    for (const auto& [name, value] : req.params) {
+        key += separator;
+        key += name;
+        key += '=';
+        key += value;
+        separator = '&';
+    }
+    key += '\n';
+    key += username;
+    return key;
+}
+
+ResponseCache::Shard& ResponseCache::shard_for(const std::string& key) {
+    return shards_[std::hash<std::string>{}(key) % kShardCount];
+}
+
+void ResponseCache::erase(Shard& shard, std::list<Entry>::iterator it) {
+    shard.bytes -= it->key.size() + it->body->size();
+    shard.index.erase(it->key);
+    shard.lru.erase(it);
+}
+
+bool ResponseCache::serve(const std::string& key, uint64_t version, httplib::Response& res) {
+    Shard& shard = shard_for(key);
+    std::shared_ptr<const std::string> body;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const Entry& entry = *it->second;
+        if (entry.version != version || std::chrono::steady_clock::now() - entry.stored_at > max_age_) {
+            erase(shard, it->second);
+            stale_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        body = entry.body;
+    }
+
+    // Copy outside the lock; the entry may be evicted meanwhile, the body stays alive
+    res.status = 200;
+    res.set_content(*body, "application/json");
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ResponseCache::store(const std::string& key, uint64_t version, const httplib::Response& res) {
+    if (res.status != 200) {
+        return;
+    }
+
+    const size_t size = key.size() + res.body.size();
+    if (size > max_bytes_per_shard_) {
+        return;
+    }
+
+    auto body = std::make_shared<const std::string>(res.body);
+    Shard& shard = shard_for(key);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto existing = shard.index.find(key);
+    if (existing != shard.index.end()) {
+        // A concurrent request may already have stored a newer build
+        if (existing->second->version > version) {
+            return;
+        }
+        erase(shard, existing->second);
+    }
+
+    shard.lru.push_front({key, version, std::chrono::steady_clock::now(), std::move(body)});
+    shard.index.emplace(key, shard.lru.begin());
+    shard.bytes += size;
+
+    while (shard.bytes > max_bytes_per_shard_) {
+        erase(shard, std::prev(shard.lru.end()));
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+json ResponseCache::get_stats() const {
+    size_t entries = 0;
+    size_t bytes = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        entries += shard.lru.size();
+        bytes += shard.bytes;
+    }
+
+    const uint64_t hits = hits_.load(std::memory_order_relaxed);
+    const uint64_t lookups = hits + misses_.load(std::memory_order_relaxed) + stale_.load(std::memory_order_relaxed);
+
+    return {
+        {"entries", entries},
+        {"bytes", bytes},
+        {"max_bytes", max_bytes_per_shard_ * kShardCount},
+        {"hits", hits},
+        {"misses", misses_.load(std::memory_order_relaxed)},
+        {"stale", stale_.load(std::memory_order_relaxed)},
+        {"evictions", evictions_.load(std::memory_order_relaxed)},
+        {"hit_rate", lookups > 0 ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0}
+    };
+}
@@ -0,0 +1,52 @@
+#include "common/router.h"
+#include "common/request_arena.h"
+
+Router& Router::Get(const std::string& pattern, Handler handler) {
+    return add_route("GET", pattern, std::move(handler));
+}
+
+Router& Router::Post(const std::string& pattern, Handler handler) {
+    return add_route("POST", pattern, std::move(handler));
+}
+
+Router& Router::Put(const std::string& pattern, Handler handler) {
+    return add_route("PUT", pattern, std::move(handler));
+}
+
+Router& Router::Delete(const std::string& pattern, Handler handler) {
+    return add_route("DELETE", pattern, std::move(handler));
+}
+
+void Router::mount(httplib::Server& server) const {
+    for (const auto& route : routes_) {
+        if (route.method == "GET") {
+            server.Get(route.pattern, route.handler);
+        } else if (route.method == "POST") {
+            server.Post(route.pattern, route.handler);
+        } else if (route.method == "PUT") {
+            server.Put(route.pattern, route.handler);
+        } else if (route.method == "DELETE") {
+            server.Delete(route.pattern, route.handler);
+        }
+    }
+}
+
+bool Router::dispatch(httplib::Request& req, httplib::Response& res) const {
+    for (const auto& route : routes_) {
+        if (route.method == req.method && std::regex_match(req.path, req.matches, route.regex)) {
+            route.handler(req, res);
+            return true;
+        }
+    }
+    return false;
+}
+
+Router& Router::add_route(const std::string& method, const std::string& pattern, Handler handler) {
+    // Everything the handler allocates through ArenaAllocator is released in one go when it returns
+    Handler scoped = [handler = std::move(handler)](const httplib::Request& req, httplib::Response& res) {
+        RequestArena::Scope scope;
+        handler(req, res);
+    };
+    routes_.push_back({method, pattern, std::regex(pattern), std::move(scoped)});
+    return *this;
+}
@@ -0,0 +1,211 @@
+#include "common/sha256.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr std::array<uint32_t, 64> kRoundConstants = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotr(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+} // namespace
+
+Sha256::Sha256()
+    : state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19},
+      buffer_{}, buffered_(0), total_length_(0) {
+}
+
+void Sha256::update(const void* data, size_t length) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    total_length_ += length;
+
+    if (buffered_ > 0) {
+        const size_t take = std::min(length, kBlockSize - buffered_);
+        std::memcpy(buffer_.data() + buffered_, bytes, take);
+        buffered_ += take;
+        bytes += take;
+        length -= take;
+
+        if (buffered_ < kBlockSize) {
+            return;
+        }
+        process_block(buffer_.data());
+        buffered_ = 0;
+    }
+
+    while (length >= kBlockSize) {
+        process_block(bytes);
+        bytes += kBlockSize;
+        length -= kBlockSize;
+    }
+
+    std::memcpy(buffer_.data(), bytes, length);
+    buffered_ = length;
+}
+
+Sha256::Digest Sha256::finish() {
+    const uint64_t bit_length = total_length_ * 8;
+
+    // Padding: 0x80, zeros, then the 64-bit big-endian message length
+    const uint8_t marker = 0x80;
+    update(&marker, 1);
+    const uint8_t zero = 0;
+    while (buffered_ != kBlockSize - 8) {
+        update(&zero, 1);
+    }
+
+    uint8_t length_bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        length_bytes[i] = static_cast<uint8_t>(bit_length >> (56 - 8 * i));
+    }
+    update(length_bytes, 8);
+
+    Digest digest;
+    for (size_t i = 0; i < state_.size(); ++i) {
+        digest[4 * i] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[4 * i + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[4 * i + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[4 * i + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    return digest;
+}
+
+Sha256::Digest Sha256::hash(std::string_view data) {
+    Sha256 sha;
+    sha.update(data);
+    return sha.finish();
+}
+
+Sha256::Digest Sha256::hmac(std::string_view key, std::string_view message) {
+    std::array<uint8_t, kBlockSize> key_block{};
+    if (key.size() > kBlockSize) {
+        const auto key_digest = hash(key);
+        std::memcpy(key_block.data(), key_digest.data(), key_digest.size());
+    } else {
+        std::memcpy(key_block.data(), key.data(), key.size());
+    }
+
+    std::array<uint8_t, kBlockSize> inner_pad;
+    std::array<uint8_t, kBlockSize> outer_pad;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        inner_pad[i] = key_block[i] ^ 0x36;
+        outer_pad[i] = key_block[i] ^ 0x5c;
+    }
+
+    Sha256 inner;
+    inner.update(inner_pad.data(), inner_pad.size());
+    inner.update(message);
+    const auto inner_digest = inner.finish();
+
+    Sha256 outer;
+    outer.update(outer_pad.data(), outer_pad.size());
+    outer.update(inner_digest.data(), inner_digest.size());
+    return outer.finish();
+}
+
+std::string Sha256::pbkdf2(std::string_view password, std::string_view salt, uint32_t iterations, size_t length) {
+    std::array<uint8_t, kBlockSize> key_block{};
+    if (password.size() > kBlockSize) {
+        const auto key_digest = hash(password);
+        std::memcpy(key_block.data(), key_digest.data(), key_digest.size());
+    } else {
+        std::memcpy(key_block.data(), password.data(), password.size());
+    }
+
+    // The padded key blocks never change, so hash them once and copy the states per iteration
+    std::array<uint8_t, kBlockSize> pad;
+    Sha256 inner_base;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        pad[i] = key_block[i] ^ 0x36;
+    }
+    inner_base.update(pad.data(), pad.size());
+
+    Sha256 outer_base;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        pad[i] = key_block[i] ^ 0x5c;
+    }
+    outer_base.update(pad.data(), pad.size());
+
+    auto prf = [&inner_base, &outer_base](const uint8_t* data, size_t size) {
+        Sha256 inner = inner_base;
+        inner.update(data, size);
+        const auto inner_digest = inner.finish();
+
+        Sha256 outer = outer_base;
+        outer.update(inner_digest.data(), inner_digest.size());
+        return outer.finish();
+    };
+
+    std::string derived;
+    derived.reserve(length);
+
+    for (uint32_t block_index = 1; derived.size() < length; ++block_index) {
+        std::string first_input(salt);
+        first_input += static_cast<char>(block_index >> 24);
+        first_input += static_cast<char>(block_index >> 16);
+        first_input += static_cast<char>(block_index >> 8);
+        first_input += static_cast<char>(block_index);
+
+        auto u = prf(reinterpret_cast<const uint8_t*>(first_input.data()), first_input.size());
+        auto block = u;
+        for (uint32_t i = 1; i < iterations; ++i) {
+            u = prf(u.data(), u.size());
+            for (size_t j = 0; j < kDigestSize; ++j) {
+                block[j] ^= u[j];
+            }
+        }
+
+        const size_t take = std::min(kDigestSize, length - derived.size());
+        derived.append(reinterpret_cast<const char*>(block.data()), take);
+    }
+
+    return derived;
+}
+
+void Sha256::process_block(const uint8_t* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<uint32_t>(block[4 * i]) << 24) | (static_cast<uint32_t>(block[4 * i + 1]) << 16) |
+               (static_cast<uint32_t>(block[4 * i + 2]) << 8) | static_cast<uint32_t>(block[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+        const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+
+    for (int i = 0; i < 64; ++i) {
+        const uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+        const uint32_t choose = (e & f) ^ (~e & g);
+        const uint32_t temp1 = h + s1 + choose + kRoundConstants[i] + w[i];
+        const uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+        const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        const uint32_t temp2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+    state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+}
@@ -0,0 +1,91 @@
+#include "common/snowflake_id.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+constexpr char kAlphabet[] = "0123456789abcdefghjkmnpqrstvwxyz";
+constexpr uint64_t kSequenceMask = (uint64_t{1} << SnowflakeId::kSequenceBits) - 1;
+constexpr uint64_t kNodeMask = (uint64_t{1} << SnowflakeId::kNodeBits) - 1;
+constexpr int kTimeShift = SnowflakeId::kNodeBits + SnowflakeId::kSequenceBits;
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int digit_value(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        c = static_cast<char>(c - 'A' + 'a');
+    }
+    for (int i = 0; i < 32; ++i) {
+        if (kAlphabet[i] == c) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+std::atomic<uint64_t> SnowflakeId::last_{0};
+std::atomic<uint32_t> SnowflakeId::node_{0};
+
+void SnowflakeId::set_node(uint32_t node) {
+    node_.store(node & kNodeMask, std::memory_order_relaxed);
+}
+
+uint64_t SnowflakeId::next() {
+    const uint64_t node_bits = static_cast<uint64_t>(node_.load(std::memory_order_relaxed)) << kSequenceBits;
+    const uint64_t floor = first_at(now_ms()) | node_bits;
+
+    uint64_t last = last_.load(std::memory_order_relaxed);
+    for (;;) {
+        // Past the last id, and never letting the sequence carry into the node bits
+        uint64_t candidate = (last & kSequenceMask) == kSequenceMask
+            ? (((last >> kTimeShift) + 1) << kTimeShift) | node_bits
+            : last + 1;
+        candidate = std::max(candidate, floor);
+        if (last_.compare_exchange_weak(last, candidate, std::memory_order_relaxed)) {
+            return candidate;
+        }
+    }
+}
+
+uint32_t SnowflakeId::node_of(uint64_t id) {
+    return static_cast<uint32_t>((id >> kSequenceBits) & kNodeMask);
+}
+
+int64_t SnowflakeId::timestamp_ms_of(uint64_t id) {
+    return static_cast<int64_t>(id >> kTimeShift) + kEpochMs;
+}
+
+uint64_t SnowflakeId::first_at(int64_t ms) {
+    return static_cast<uint64_t>(std::max<int64_t>(ms - kEpochMs, 0)) << kTimeShift;
+}
+
+std::string SnowflakeId::format(uint64_t id) {
+    std::string out(kFormattedLength, '0');
+    for (size_t i = kFormattedLength; i-- > 0;) {
+        out[i] = kAlphabet[id & 31];
+        id >>= 5;
+    }
+    return out;
+}
+
+std::optional<uint64_t> SnowflakeId::parse(std::string_view text) {
+    // 13 digits carry 65 bits, so the first may only be 0 or 1
+    if (text.size() != kFormattedLength || digit_value(text[0]) > 1) {
+        return std::nullopt;
+    }
+
+    uint64_t id = 0;
+    for (char c : text) {
+        const int value = digit_value(c);
+        if (value < 0) {
+            return std::nullopt;
+        }
+        id = (id << 5) | static_cast<uint64_t>(value);
+    }
+    return id;
+}
@@ -0,0 +1,409 @@
+#include "common/text_scanner.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MESSENGER_TEXT_SCANNER_X86 1
+#endif
+
+namespace {
+
+bool is_blank_code_point(uint32_t cp) {
+    switch (cp) {
+    case 0x09: case 0x0A: case 0x0B: case 0x0C: case 0x0D: case 0x20:
+    case 0x85: case 0xA0: case 0x1680:
+    case 0x2028: case 0x2029: case 0x202F: case 0x205F: case 0x3000:
+    case 0x200B: case 0xFEFF:
+        return true;
+    default:
+        return cp >= 0x2000 && cp <= 0x200A;
+    }
+}
+
+bool is_control_code_point(uint32_t cp) {
+    return (cp < 0x20 && cp != '\t' && cp != '\n' && cp != '\r') || (cp >= 0x7F && cp <= 0x9F);
+}
+
+// Decodes one code point starting at text[i]; returns its length, or 0 if the sequence is invalid
+size_t decode(std::string_view text, size_t i, uint32_t& cp) {
+    const auto byte = [&text](size_t index) { return static_cast<uint8_t>(text[index]); };
+    const uint8_t lead = byte(i);
+
+    size_t length;
+    uint32_t min_value;
+    if (lead < 0x80) {
+        cp = lead;
+        return 1;
+    } else if ((lead & 0xE0) == 0xC0) {
+        length = 2; cp = lead & 0x1F; min_value = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        length = 3; cp = lead & 0x0F; min_value = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        length = 4; cp = lead & 0x07; min_value = 0x10000;
+    } else {
+        return 0;
+    }
+
+    if (i + length > text.size()) {
+        return 0;
+    }
+    for (size_t k = 1; k < length; ++k) {
+        if ((byte(i + k) & 0xC0) != 0x80) {
+            return 0;
+        }
+        cp = (cp << 6) | (byte(i + k) & 0x3F);
+    }
+
+    if (cp < min_value || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        return 0;
+    }
+    return length;
+}
+
+// Used by the SIMD kernels once they know there is no ASCII non-blank character
+bool only_blank_code_points(std::string_view text) {
+    for (size_t i = 0; i < text.size();) {
+        uint32_t cp = 0;
+        const size_t length = decode(text, i, cp);
+        if (length == 0 || !is_blank_code_point(cp)) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+#ifdef MESSENGER_TEXT_SCANNER_X86
+
+// Error classes for the lookup validation; see Keiser & Lemire, "Validating UTF-8 In Less Than One
+// Instruction Per Byte" (2021). Each table maps a nibble to the errors it can take part in, and a
+// byte pair is invalid when all three lookups agree on some class.
+constexpr uint8_t kTooShort = 1 << 0;
+constexpr uint8_t kTooLong = 1 << 1;
+constexpr uint8_t kOverlong3 = 1 << 2;
+constexpr uint8_t kTooLarge = 1 << 3;
+constexpr uint8_t kSurrogate = 1 << 4;
+constexpr uint8_t kOverlong2 = 1 << 5;
+constexpr uint8_t kTooLarge1000 = 1 << 6;
+constexpr uint8_t kOverlong4 = 1 << 6;
+constexpr uint8_t kTwoConts = 1 << 7;
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+constexpr uint8_t kByte1High[16] = {
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+};
+
+constexpr uint8_t kByte1Low[16] = {
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    kCarry | kOverlong2,
+    kCarry,
+    kCarry,
+    kCarry | kTooLarge,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000
+};
+
+constexpr uint8_t kByte2High[16] = {
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooShort, kTooShort, kTooShort, kTooShort
+};
+
+// The final block is padded with spaces: valid, blank, not control, and subtracted from the count
+constexpr uint8_t kPadding = ' ';
+
+__attribute__((target("avx2,popcnt")))
+TextScanner::Result scan_avx2(std::string_view text) {
+    const __m256i byte1_high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kByte1High)));
+    const __m256i byte1_low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kByte1Low)));
+    const __m256i byte2_high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kByte2High)));
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+
+    __m256i error = _mm256_setzero_si256();
+    __m256i control = _mm256_setzero_si256();
+    __m256i ascii_non_blank = _mm256_setzero_si256();
+    __m256i non_ascii = _mm256_setzero_si256();
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    size_t code_points = 0;
+
+    const size_t size = text.size();
+    alignas(32) uint8_t tail[32];
+
+    for (size_t offset = 0; offset < size; offset += 32) {
+        __m256i input;
+        if (offset + 32 <= size) {
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + offset));
+        } else {
+            std::memset(tail, kPadding, sizeof(tail));
+            std::memcpy(tail, text.data() + offset, size - offset);
+            input = _mm256_load_si256(reinterpret_cast<const __m256i*>(tail));
+        }
+
+        // Code points: every byte that is not a continuation byte (0x80-0xBF, i.e. < -64 signed)
+        const __m256i not_continuation = _mm256_cmpgt_epi8(input, _mm256_set1_epi8(-65));
+        code_points += static_cast<size_t>(__builtin_popcount(static_cast<uint32_t>(_mm256_movemask_epi8(not_continuation))));
+
+        const int high_bits = _mm256_movemask_epi8(input);
+        if (high_bits == 0) {
+            // Pure ASCII block: only a truncated sequence from the previous block can be an error
+            error = _mm256_or_si256(error, prev_incomplete);
+            prev_incomplete = _mm256_setzero_si256();
+        } else {
+            non_ascii = _mm256_or_si256(non_ascii, input);
+
+            const __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+            const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 16 - 1);
+            const __m256i prev2 = _mm256_alignr_epi8(input, shifted, 16 - 2);
+            const __m256i prev3 = _mm256_alignr_epi8(input, shifted, 16 - 3);
+
+            const __m256i special_cases = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble_mask)),
+                    _mm256_shuffle_epi8(byte1_low, _mm256_and_si256(prev1, nibble_mask))),
+                _mm256_shuffle_epi8(byte2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble_mask)));
+
+            // Third and fourth bytes of 3/4-byte sequences must be continuations
+            const __m256i is_third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            const __m256i is_fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            const __m256i must_be_continuation = _mm256_and_si256(_mm256_or_si256(is_third, is_fourth),
+                                                                  _mm256_set1_epi8(static_cast<char>(0x80)));
+            error = _mm256_or_si256(error, _mm256_xor_si256(must_be_continuation, special_cases));
+
+            // C1 controls: C2 followed by 80-9F
+            const __m256i after_c2 = _mm256_cmpeq_epi8(prev1, _mm256_set1_epi8(static_cast<char>(0xC2)));
+            const __m256i upto_9f = _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(static_cast<char>(0x9F))), input);
+            control = _mm256_or_si256(control, _mm256_and_si256(after_c2, upto_9f));
+
+            prev_incomplete = _mm256_subs_epu8(input, incomplete_max);
+        }
+
+        // ASCII controls (except tab, LF, CR) and DEL
+        const __m256i upto_1f = _mm256_cmpeq_epi8(_mm256_min_epu8(input, _mm256_set1_epi8(0x1F)), input);
+        const __m256i allowed = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(input, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\n'))),
+            _mm256_cmpeq_epi8(input, _mm256_set1_epi8('\r')));
+        control = _mm256_or_si256(control, _mm256_andnot_si256(allowed, upto_1f));
+        control = _mm256_or_si256(control, _mm256_cmpeq_epi8(input, _mm256_set1_epi8(0x7F)));
+
+        // ASCII that is not blank: high bit clear, not a space, not 09-0D
+        const __m256i is_space = _mm256_cmpeq_epi8(input, _mm256_set1_epi8(' '));
+        const __m256i in_09_0d = _mm256_cmpeq_epi8(
+            _mm256_min_epu8(_mm256_sub_epi8(input, _mm256_set1_epi8(0x09)), _mm256_set1_epi8(0x04)),
+            _mm256_sub_epi8(input, _mm256_set1_epi8(0x09)));
+        const __m256i blank = _mm256_or_si256(is_space, in_09_0d);
+        const __m256i ascii = _mm256_cmpgt_epi8(input, _mm256_set1_epi8(-1));
+        ascii_non_blank = _mm256_or_si256(ascii_non_blank, _mm256_andnot_si256(blank, ascii));
+
+        prev_input = input;
+    }
+    error = _mm256_or_si256(error, prev_incomplete);
+
+    TextScanner::Result result;
+    result.valid_utf8 = _mm256_testz_si256(error, error);
+    result.has_control = !_mm256_testz_si256(control, control);
+    result.code_points = code_points - (size % 32 == 0 ? 0 : 32 - size % 32);
+
+    // Non-blank ASCII anywhere settles it; otherwise only non-ASCII blanks may remain
+    if (!_mm256_testz_si256(ascii_non_blank, ascii_non_blank)) {
+        result.all_whitespace = false;
+    } else if (_mm256_movemask_epi8(non_ascii) == 0) {
+        result.all_whitespace = true;
+    } else {
+        result.all_whitespace = result.valid_utf8 && only_blank_code_points(text);
+    }
+    return result;
+}
+
+__attribute__((target("ssse3,sse4.1,popcnt")))
+TextScanner::Result scan_ssse3(std::string_view text) {
+    const __m128i byte1_high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kByte1High));
+    const __m128i byte1_low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kByte1Low));
+    const __m128i byte2_high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kByte2High));
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    const __m128i incomplete_max = _mm_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+
+    __m128i error = _mm_setzero_si128();
+    __m128i control = _mm_setzero_si128();
+    __m128i ascii_non_blank = _mm_setzero_si128();
+    __m128i non_ascii = _mm_setzero_si128();
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    size_t code_points = 0;
+
+    const size_t size = text.size();
+    alignas(16) uint8_t tail[16];
+
+    for (size_t offset = 0; offset < size; offset += 16) {
+        __m128i input;
+        if (offset + 16 <= size) {
+            input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + offset));
+        } else {
+            std::memset(tail, kPadding, sizeof(tail));
+            std::memcpy(tail, text.data() + offset, size - offset);
+            input = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+        }
+
+        const __m128i not_continuation = _mm_cmpgt_epi8(input, _mm_set1_epi8(-65));
+        code_points += static_cast<size_t>(__builtin_popcount(static_cast<uint32_t>(_mm_movemask_epi8(not_continuation))));
+
+        if (_mm_movemask_epi8(input) == 0) {
+            error = _mm_or_si128(error, prev_incomplete);
+            prev_incomplete = _mm_setzero_si128();
+        } else {
+            non_ascii = _mm_or_si128(non_ascii, input);
+
+            const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 16 - 1);
+            const __m128i prev2 = _mm_alignr_epi8(input, prev_input, 16 - 2);
+            const __m128i prev3 = _mm_alignr_epi8(input, prev_input, 16 - 3);
+
+            const __m128i special_cases = _mm_and_si128(
+                _mm_and_si128(
+                    _mm_shuffle_epi8(byte1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble_mask)),
+                    _mm_shuffle_epi8(byte1_low, _mm_and_si128(prev1, nibble_mask))),
+                _mm_shuffle_epi8(byte2_high, _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask)));
+
+            const __m128i is_third = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            const __m128i is_fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            const __m128i must_be_continuation = _mm_and_si128(_mm_or_si128(is_third, is_fourth),
+                                                               _mm_set1_epi8(static_cast<char>(0x80)));
+            error = _mm_or_si128(error, _mm_xor_si128(must_be_continuation, special_cases));
+
+            const __m128i after_c2 = _mm_cmpeq_epi8(prev1, _mm_set1_epi8(static_cast<char>(0xC2)));
+            const __m128i upto_9f = _mm_cmpeq_epi8(_mm_min_epu8(input, _mm_set1_epi8(static_cast<char>(0x9F))), input);
+            control = _mm_or_si128(control, _mm_and_si128(after_c2, upto_9f));
+
+            prev_incomplete = _mm_subs_epu8(input, incomplete_max);
+        }
+
+        const __m128i upto_1f = _mm_cmpeq_epi8(_mm_min_epu8(input, _mm_set1_epi8(0x1F)), input);
+        const __m128i allowed = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(input, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(input, _mm_set1_epi8('\n'))),
+            _mm_cmpeq_epi8(input, _mm_set1_epi8('\r')));
+        control = _mm_or_si128(control, _mm_andnot_si128(allowed, upto_1f));
+        control = _mm_or_si128(control, _mm_cmpeq_epi8(input, _mm_set1_epi8(0x7F)));
+
+        const __m128i is_space = _mm_cmpeq_epi8(input, _mm_set1_epi8(' '));
+        const __m128i in_09_0d = _mm_cmpeq_epi8(
+            _mm_min_epu8(_mm_sub_epi8(input, _mm_set1_epi8(0x09)), _mm_set1_epi8(0x04)),
+            _mm_sub_epi8(input, _mm_set1_epi8(0x09)));
+        const __m128i blank = _mm_or_si128(is_space, in_09_0d);
+        const __m128i ascii = _mm_cmpgt_epi8(input, _mm_set1_epi8(-1));
+        ascii_non_blank = _mm_or_si128(ascii_non_blank, _mm_andnot_si128(blank, ascii));
+
+        prev_input = input;
+    }
+    error = _mm_or_si128(error, prev_incomplete);
+
+    TextScanner::Result result;
+    result.valid_utf8 = _mm_testz_si128(error, error);
+    result.has_control = !_mm_testz_si128(control, control);
+    result.code_points = code_points - (size % 16 == 0 ? 0 : 16 - size % 16);
+
+    if (!_mm_testz_si128(ascii_non_blank, ascii_non_blank)) {
+        result.all_whitespace = false;
+    } else if (_mm_movemask_epi8(non_ascii) == 0) {
+        result.all_whitespace = true;
+    } else {
+        result.all_whitespace = result.valid_utf8 && only_blank_code_points(text);
+    }
+    return result;
+}
+
+#endif // MESSENGER_TEXT_SCANNER_X86
+
+using ScanFunction = TextScanner::Result (*)(std::string_view);
+
+struct Kernel {
+    ScanFunction scan;
+    const char* name;
+};
+
+Kernel select_kernel() {
+#ifdef MESSENGER_TEXT_SCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return {scan_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt")) {
+        return {scan_ssse3, "ssse3"};
+    }
+#endif
+    return {TextScanner::scan_scalar, "scalar"};
+}
+
+const Kernel& active_kernel() {
+    static const Kernel kernel = select_kernel();
+    return kernel;
+}
+
+} // namespace
+
+TextScanner::Result TextScanner::scan(std::string_view text) {
+    return active_kernel().scan(text);
+}
+
+TextScanner::Result TextScanner::scan_scalar(std::string_view text) {
+    Result result{true, false, true, 0};
+
+    for (size_t i = 0; i < text.size();) {
+        uint32_t cp = 0;
+        const size_t length = decode(text, i, cp);
+        if (length == 0) {
+            result.valid_utf8 = false;
+            return result;
+        }
+
+        ++result.code_points;
+        result.has_control = result.has_control || is_control_code_point(cp);
+        result.all_whitespace = result.all_whitespace && is_blank_code_point(cp);
+        i += length;
+    }
+
+    return result;
+}
+
+const char* TextScanner::implementation() {
+    return active_kernel().name;
+}
+
+std::optional<TextScanner::Result> TextScanner::scan_using(std::string_view implementation, std::string_view text) {
+    if (implementation == "scalar") {
+        return scan_scalar(text);
+    }
+#ifdef MESSENGER_TEXT_SCANNER_X86
+    __builtin_cpu_init();
+    if (implementation == "avx2" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return scan_avx2(text);
+    }
+    if (implementation == "ssse3" && __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1") &&
+        __builtin_cpu_supports("popcnt")) {
+        return scan_ssse3(text);
+    }
+#endif
+    return std::nullopt;
+}
@@ -0,0 +1,64 @@
+#include "common/token_cache.h"
+#include <functional>
+#include <string_view>
+
+VerifiedTokenCache::VerifiedTokenCache(size_t capacity_per_shard) : capacity_per_shard_(capacity_per_shard) {
+}
+
+std::optional<TokenSigner::Claims> VerifiedTokenCache::find(const std::string& token, int64_t now) {
+    const size_t hash = std::hash<std::string_view>{}(token);
+    Shard& shard = shards_[hash % kShardCount];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(hash);
+    if (it == shard.index.end() || it->second->token != token) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    if (it->second->claims.expires_at <= now) {
+        shard.lru.erase(it->second);
+        shard.index.erase(it);
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return it->second->claims;
+}
+
+void VerifiedTokenCache::insert(const std::string& token, const TokenSigner::Claims& claims) {
+    const size_t hash = std::hash<std::string_view>{}(token);
+    Shard& shard = shards_[hash % kShardCount];
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto existing = shard.index.find(hash);
+    if (existing != shard.index.end()) {
+        shard.lru.erase(existing->second);
+        shard.index.erase(existing);
+    }
+
+    shard.lru.push_front({token, claims});
+    shard.index[hash] = shard.lru.begin();
+
+    if (shard.lru.size() > capacity_per_shard_) {
+        shard.index.erase(std::hash<std::string_view>{}(shard.lru.back().token));
+        shard.lru.pop_back();
+    }
+}
+
+json VerifiedTokenCache::get_stats() const {
+    size_t entries = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        entries += shard.lru.size();
+    }
+
+    return {
+        {"entries", entries},
+        {"capacity", capacity_per_shard_ * kShardCount},
+        {"hits", hits_.load(std::memory_order_relaxed)},
+        {"misses", misses_.load(std::memory_order_relaxed)}
+    };
+}
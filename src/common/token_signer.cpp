@@ -0,0 +1,140 @@
+#include "common/token_signer.h"
+#include "common/sha256.h"
+#include "common/base64url.h"
+#include "common/logger.h"
+#include <nlohmann/json.hpp>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace {
+
+std::string_view digest_view(const Sha256::Digest& digest) {
+    return {reinterpret_cast<const char*>(digest.data()), digest.size()};
+}
+
+bool constant_time_equals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+} // namespace
+
+TokenSigner& TokenSigner::instance() {
+    static TokenSigner signer;
+    return signer;
+}
+
+void TokenSigner::load_keys_from_environment() {
+    if (const char* key_list = std::getenv("MESSENGER_TOKEN_KEYS")) {
+        std::stringstream entries(key_list);
+        std::string entry;
+        while (std::getline(entries, entry, ',')) {
+            const size_t separator = entry.find('=');
+            if (separator == std::string::npos || separator == 0 || separator + 1 == entry.size()) {
+                LOG_WARNING("Ignoring malformed MESSENGER_TOKEN_KEYS entry");
+                continue;
+            }
+            add_key(entry.substr(0, separator), entry.substr(separator + 1));
+        }
+    } else if (const char* secret = std::getenv("MESSENGER_TOKEN_SECRET")) {
+        add_key("default", secret);
+    }
+
+    if (keys_.empty()) {
+        // Tokens will not survive a restart, but every forked worker shares this key
+        std::random_device rd;
+        std::string secret(32, '\0');
+        for (auto& byte : secret) {
+            byte = static_cast<char>(rd() & 0xff);
+        }
+        add_key("ephemeral", secret);
+        LOG_WARNING("No token signing key configured; using a random key for this launch");
+    }
+
+    LOG_INFO("Token signing key: " + signing_key_id_ + " (" + std::to_string(keys_.size()) + " verification keys)");
+}
+
+void TokenSigner::add_key(const std::string& key_id, const std::string& secret) {
+    keys_[key_id] = secret;
+    if (signing_key_id_.empty()) {
+        signing_key_id_ = key_id;
+    }
+}
+
+std::string TokenSigner::sign(const std::string& username, const std::string& session_id, int64_t ttl_seconds) const {
+    const int64_t now = std::time(nullptr);
+
+    const json header = {{"alg", "HS256"}, {"typ", "JWT"}, {"kid", signing_key_id_}};
+    const json claims = {{"sub", username}, {"sid", session_id}, {"iat", now}, {"exp", now + ttl_seconds}};
+
+    std::string token = Base64Url::encode(header.dump()) + "." + Base64Url::encode(claims.dump());
+    const auto mac = Sha256::hmac(keys_.at(signing_key_id_), token);
+    token += "." + Base64Url::encode(digest_view(mac));
+    return token;
+}
+
+std::optional<TokenSigner::Claims> TokenSigner::verify(const std::string& token) const {
+    const size_t first_dot = token.find('.');
+    const size_t second_dot = first_dot == std::string::npos ? first_dot : token.find('.', first_dot + 1);
+    if (second_dot == std::string::npos || token.find('.', second_dot + 1) != std::string::npos) {
+        return std::nullopt;
+    }
+
+    const std::string_view token_view(token);
+    const auto header_bytes = Base64Url::decode(token_view.substr(0, first_dot));
+    const auto claims_bytes = Base64Url::decode(token_view.substr(first_dot + 1, second_dot - first_dot - 1));
+    const auto mac_bytes = Base64Url::decode(token_view.substr(second_dot + 1));
+    if (!header_bytes || !claims_bytes || !mac_bytes) {
+        return std::nullopt;
+    }
+
+    // Every field is type-checked before it is read: json::value() throws on a mistyped member,
+    // and this runs on bytes straight from the client
+    const json header = json::parse(*header_bytes, nullptr, false);
+    if (!header.is_object() || !header.contains("alg") || !header["alg"].is_string() ||
+        header["alg"].get_ref<const std::string&>() != "HS256" || !header.contains("kid") ||
+        !header["kid"].is_string()) {
+        return std::nullopt;
+    }
+
+    const auto key = keys_.find(header["kid"].get<std::string>());
+    if (key == keys_.end()) {
+        return std::nullopt;
+    }
+
+    const auto expected_mac = Sha256::hmac(key->second, token_view.substr(0, second_dot));
+    if (!constant_time_equals(digest_view(expected_mac), *mac_bytes)) {
+        return std::nullopt;
+    }
+
+    const json claims = json::parse(*claims_bytes, nullptr, false);
+    if (!claims.is_object() || !claims.contains("sub") || !claims["sub"].is_string() ||
+        !claims.contains("exp") || !claims["exp"].is_number_integer() ||
+        (claims.contains("sid") && !claims["sid"].is_string()) ||
+        (claims.contains("iat") && !claims["iat"].is_number_integer())) {
+        return std::nullopt;
+    }
+
+    Claims result;
+    result.username = claims["sub"].get<std::string>();
+    result.session_id = claims.value("sid", "");
+    result.key_id = key->first;
+    result.issued_at = claims.value("iat", int64_t{0});
+    result.expires_at = claims["exp"].get<int64_t>();
+
+    if (result.username.empty() || result.expires_at <= std::time(nullptr)) {
+        return std::nullopt;
+    }
+
+    return result;
+}
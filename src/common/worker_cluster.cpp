@@ -0,0 +1,128 @@
+#include "common/worker_cluster.h"
+#include "common/logger.h"
+#include "common/snowflake_id.h"
+#include <sys/socket.h>
+#include <unordered_map>
+
+int WorkerCluster::worker_index_ = 0;
+int WorkerCluster::worker_count_ = 1;
+std::string WorkerCluster::socket_dir_;
+
+void WorkerCluster::configure(int worker_index, int worker_count, const std::string& socket_dir) {
+    worker_index_ = worker_index;
+    worker_count_ = worker_count;
+    socket_dir_ = socket_dir;
+    // Ids carry the worker that issued them, which is also the one holding what they name
+    SnowflakeId::set_node(static_cast<uint32_t>(worker_index));
+}
+
+bool WorkerCluster::is_enabled() {
+    return worker_count_ > 1;
+}
+
+int WorkerCluster::worker_index() {
+    return worker_index_;
+}
+
+int WorkerCluster::worker_count() {
+    return worker_count_;
+}
+
+int WorkerCluster::owner_of(const std::string& key) {
+    if (worker_count_ <= 1) {
+        return 0;
+    }
+
+    // FNV-1a: must be identical in every worker, so std::hash is not an option
+    std::uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<int>(hash % static_cast<std::uint64_t>(worker_count_));
+}
+
+bool WorkerCluster::owns(const std::string& key) {
+    return owner_of(key) == worker_index_;
+}
+
+std::string WorkerCluster::socket_path(const std::string& service_name, int worker) {
+    return socket_dir_ + "/" + service_name + "-" + std::to_string(worker) + ".sock";
+}
+
+bool WorkerCluster::forward(const std::string& service_name, int worker,
+                            const httplib::Request& req, httplib::Response& res) {
+    auto& client = client_for(socket_path(service_name, worker));
+    auto result = client.send(make_internal_request(req));
+    if (!result) {
+        LOG_ERROR("Forwarding " + req.method + " " + req.path + " to worker " + std::to_string(worker) + " failed");
+        return false;
+    }
+
+    res.status = result->status;
+    for (const auto& [key, value] : result->headers) {
+        if (key != "Content-Length" && key != "Content-Type" && key != "Connection" && key != "Keep-Alive") {
+            res.set_header(key, value);
+        }
+    }
+    res.set_content(result->body, result->get_header_value("Content-Type"));
+    return true;
+}
+
+std::vector<WorkerCluster::WorkerResponse> WorkerCluster::gather(const std::string& service_name,
+                                                                 const httplib::Request& req) {
+    std::vector<WorkerResponse> responses;
+    responses.reserve(worker_count_);
+
+    for (int worker = 0; worker < worker_count_; ++worker) {
+        WorkerResponse response{worker, false, {}};
+        response.ok = forward(service_name, worker, req, response.response);
+        responses.push_back(std::move(response));
+    }
+
+    return responses;
+}
+
+size_t WorkerCluster::notify_peers(const std::string& service_name, const httplib::Request& req) {
+    size_t delivered = 0;
+    for (int worker = 0; worker < worker_count_; ++worker) {
+        httplib::Response res;
+        if (worker != worker_index_ && forward(service_name, worker, req, res) && res.status / 100 == 2) {
+            ++delivered;
+        }
+    }
+    return delivered;
+}
+
+httplib::Client& WorkerCluster::client_for(const std::string& socket_path) {
+    // One keep-alive client per peer socket and thread; httplib clients are not thread-safe
+    thread_local std::unordered_map<std::string, std::unique_ptr<httplib::Client>> clients;
+
+    auto& client = clients[socket_path];
+    if (!client) {
+        client = std::make_unique<httplib::Client>(socket_path);
+        client->set_address_family(AF_UNIX);
+        client->set_keep_alive(true);
+        client->set_connection_timeout(1);
+    }
+    return *client;
+}
+
+httplib::Request WorkerCluster::make_internal_request(const httplib::Request& req) {
+    httplib::Request internal;
+    internal.method = req.method;
+    internal.path = req.params.empty() ? req.path : httplib::append_query_params(req.path, req.params);
+    internal.body = req.body;
+
+    for (const auto& [key, value] : req.headers) {
+        if (key != "Host" && key != "Connection" && key != "Keep-Alive" && key != "Content-Length") {
+            internal.headers.emplace(key, value);
+        }
+    }
+    internal.headers.emplace("X-Forwarded-By-Worker", std::to_string(worker_index_));
+    if (!req.has_header("X-Forwarded-For")) {
+        internal.headers.emplace("X-Forwarded-For", req.remote_addr);
+    }
+
+    return internal;
+}
@@ -0,0 +1,175 @@
+#include "data/change_log.h"
+#include <algorithm>
+#include <charconv>
+#include <random>
+
+namespace {
+
+std::string random_epoch() {
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::random_device rd;
+
+    std::string out;
+    for (int i = 0; i < 8; ++i) {
+        out += kHex[rd() & 0x0f];
+    }
+    return out;
+}
+
+} // namespace
+
+ChangeLog::ChangeLog(size_t user_capacity, size_t shared_capacity, size_t group_capacity)
+    : user_capacity_(user_capacity), shared_capacity_(shared_capacity), group_capacity_(group_capacity),
+      epoch_(random_epoch()),
+      sequence_(0), deltas_served_(0), expired_cursors_(0) {
+}
+
+void ChangeLog::append(const std::vector<std::string>& recipients, const std::string& type, json data) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+
+    // One copy of the change, shared by every recipient's feed
+    auto change = make_change(type, std::move(data));
+    for (const auto& recipient : recipients) {
+        push(user_feeds_[recipient], user_capacity_, change);
+    }
+}
+
+void ChangeLog::append_shared(const std::string& type, json data) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    push(shared_feed_, shared_capacity_, make_change(type, std::move(data)));
+}
+
+void ChangeLog::append_group(const std::string& group, const std::string& type, json data) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    push(group_feeds_[group], group_capacity_, make_change(type, std::move(data)));
+}
+
+void ChangeLog::append_all(std::vector<Entry> entries) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+
+    for (auto& entry : entries) {
+        auto change = make_change(entry.type, std::move(entry.data));
+        if (!entry.group.empty()) {
+            push(group_feeds_[entry.group], group_capacity_, std::move(change));
+            continue;
+        }
+        for (const auto& recipient : entry.recipients) {
+            push(user_feeds_[recipient], user_capacity_, change);
+        }
+    }
+}
+
+std::optional<ChangeLog::Delta> ChangeLog::changes_since(const std::string& username, uint64_t since,
+                                                        const std::vector<std::string>& groups) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+
+    std::vector<const Feed*> feeds = {&shared_feed_};
+    auto user_it = user_feeds_.find(username);
+    if (user_it != user_feeds_.end()) {
+        feeds.push_back(&user_it->second);
+    }
+    for (const auto& group : groups) {
+        auto group_it = group_feeds_.find(group);
+        if (group_it != group_feeds_.end()) {
+            feeds.push_back(&group_it->second);
+        }
+    }
+
+    const bool expired = since > sequence_ ||
+        std::any_of(feeds.begin(), feeds.end(), [&](const Feed* feed) { return !covers(*feed, since); });
+    if (expired) {
+        ++expired_cursors_;
+        return std::nullopt;
+    }
+
+    // Every feed is in sequence order; merge their tails
+    using Position = std::deque<std::shared_ptr<const Change>>::const_iterator;
+    std::vector<std::pair<Position, Position>> tails;
+    for (const Feed* feed : feeds) {
+        auto first = std::upper_bound(feed->changes.begin(), feed->changes.end(), since,
+            [](uint64_t value, const std::shared_ptr<const Change>& change) { return value < change->sequence; });
+        if (first != feed->changes.end()) {
+            tails.emplace_back(first, feed->changes.end());
+        }
+    }
+
+    Delta delta{sequence_, {}};
+    while (!tails.empty()) {
+        auto next = std::min_element(tails.begin(), tails.end(), [](const auto& a, const auto& b) {
+            return (*a.first)->sequence < (*b.first)->sequence;
+        });
+        delta.changes.push_back(*next->first);
+        if (++next->first == next->second) {
+            tails.erase(next);
+        }
+    }
+
+    ++deltas_served_;
+    return delta;
+}
+
+uint64_t ChangeLog::cursor() {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    return sequence_;
+}
+
+std::string ChangeLog::format_cursor(uint64_t sequence) const {
+    return epoch_ + "-" + std::to_string(sequence);
+}
+
+std::optional<uint64_t> ChangeLog::parse_cursor(const std::string& cursor) const {
+    if (cursor.size() <= epoch_.size() + 1 || cursor.compare(0, epoch_.size(), epoch_) != 0 ||
+        cursor[epoch_.size()] != '-') {
+        return std::nullopt;
+    }
+
+    uint64_t sequence = 0;
+    const char* begin = cursor.data() + epoch_.size() + 1;
+    const char* end = cursor.data() + cursor.size();
+    auto [ptr, ec] = std::from_chars(begin, end, sequence);
+    if (ec != std::errc() || ptr != end) {
+        return std::nullopt;
+    }
+    return sequence;
+}
+
+json ChangeLog::get_stats() {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+
+    size_t user_entries = 0;
+    for (const auto& [username, feed] : user_feeds_) {
+        user_entries += feed.changes.size();
+    }
+    size_t group_entries = 0;
+    for (const auto& [group, feed] : group_feeds_) {
+        group_entries += feed.changes.size();
+    }
+
+    return {
+        {"sequence", sequence_},
+        {"user_feeds", user_feeds_.size()},
+        {"user_entries", user_entries},
+        {"shared_entries", shared_feed_.changes.size()},
+        {"group_feeds", group_feeds_.size()},
+        {"group_entries", group_entries},
+        {"deltas_served", deltas_served_},
+        {"expired_cursors", expired_cursors_}
+    };
+}
+
+std::shared_ptr<const ChangeLog::Change> ChangeLog::make_change(const std::string& type, json data) {
+    return std::make_shared<const Change>(Change{++sequence_, std::time(nullptr), type, std::move(data)});
+}
+
+void ChangeLog::push(Feed& feed, size_t capacity, std::shared_ptr<const Change> change) {
+    feed.changes.push_back(std::move(change));
+    while (feed.changes.size() > capacity) {
+        feed.evicted_through = feed.changes.front()->sequence;
+        feed.changes.pop_front();
+    }
+}
+
+bool ChangeLog::covers(const Feed& feed, uint64_t since) const {
+    // Everything after `since` is still held unless something newer than it was evicted
+    return since >= feed.evicted_through;
+}
@@ -0,0 +1,125 @@
+#include "data/channel_manager.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <mutex>
+
+ChannelManager::ChannelManager(std::shared_ptr<UserIdInterner> user_ids) : user_ids_(std::move(user_ids)) {
+}
+
+bool ChannelManager::create_channel(const std::string& name, const std::string& description,
+                                    const std::string& created_by) {
+    std::unique_lock<std::shared_mutex> lock(channels_mutex_);
+
+    auto [it, inserted] = channels_.try_emplace(name, Channel{description, created_by, std::time(nullptr),
+                                                              std::make_shared<UserBitmap>()});
+    if (!inserted) {
+        return false;
+    }
+
+    LOG_INFO("Channel created: " + name + " by " + created_by);
+    return true;
+}
+
+bool ChannelManager::subscribe(const std::string& name, const std::string& username) {
+    const UserIdInterner::Id user_id = user_ids_->intern(username);
+
+    std::unique_lock<std::shared_mutex> lock(channels_mutex_);
+    auto it = channels_.find(name);
+    if (it == channels_.end()) {
+        return false;
+    }
+
+    if (!it->second.subscribers->contains(user_id)) {
+        writable_subscribers(it->second).add(user_id);
+        LOG_INFO("User " + username + " subscribed to channel " + name);
+    }
+    return true;
+}
+
+bool ChannelManager::unsubscribe(const std::string& name, const std::string& username) {
+    auto user_id = user_ids_->find(username);
+
+    std::unique_lock<std::shared_mutex> lock(channels_mutex_);
+    auto it = channels_.find(name);
+    if (it == channels_.end()) {
+        return false;
+    }
+
+    if (user_id && it->second.subscribers->contains(*user_id)) {
+        writable_subscribers(it->second).remove(*user_id);
+        LOG_INFO("User " + username + " unsubscribed from channel " + name);
+    }
+    return true;
+}
+
+std::vector<ChannelInfo> ChannelManager::list_channels(const std::string& username) {
+    auto user_id = user_ids_->find(username);
+
+    std::shared_lock<std::shared_mutex> lock(channels_mutex_);
+
+    std::vector<ChannelInfo> channels;
+    channels.reserve(channels_.size());
+    for (const auto& [name, channel] : channels_) {
+        channels.push_back({
+            name,
+            channel.description,
+            channel.created_by,
+            channel.created_at,
+            channel.subscribers->cardinality(),
+            user_id && channel.subscribers->contains(*user_id)
+        });
+    }
+
+    std::sort(channels.begin(), channels.end(),
+        [](const ChannelInfo& a, const ChannelInfo& b) { return a.name < b.name; });
+    return channels;
+}
+
+std::shared_ptr<const UserBitmap> ChannelManager::subscribers(const std::string& name) {
+    std::shared_lock<std::shared_mutex> lock(channels_mutex_);
+    auto it = channels_.find(name);
+    return it == channels_.end() ? nullptr : it->second.subscribers;
+}
+
+bool ChannelManager::can_publish(const std::string& name, const std::string& username) {
+    auto user_id = user_ids_->find(username);
+
+    std::shared_lock<std::shared_mutex> lock(channels_mutex_);
+    auto it = channels_.find(name);
+    if (it == channels_.end()) {
+        return false;
+    }
+    return it->second.created_by == username || (user_id && it->second.subscribers->contains(*user_id));
+}
+
+void ChannelManager::record_publish(size_t delivered) {
+    publishes_.fetch_add(1, std::memory_order_relaxed);
+    deliveries_.fetch_add(delivered, std::memory_order_relaxed);
+}
+
+json ChannelManager::get_stats() {
+    std::shared_lock<std::shared_mutex> lock(channels_mutex_);
+
+    size_t subscriptions = 0;
+    size_t bitmap_bytes = 0;
+    for (const auto& [name, channel] : channels_) {
+        subscriptions += channel.subscribers->cardinality();
+        bitmap_bytes += channel.subscribers->memory_bytes();
+    }
+
+    return {
+        {"channels", channels_.size()},
+        {"subscriptions", subscriptions},
+        {"bitmap_bytes", bitmap_bytes},
+        {"publishes", publishes_.load(std::memory_order_relaxed)},
+        {"deliveries", deliveries_.load(std::memory_order_relaxed)}
+    };
+}
+
+UserBitmap& ChannelManager::writable_subscribers(Channel& channel) {
+    // Called with the lock held exclusively, so no new snapshot can be taken meanwhile
+    if (channel.subscribers.use_count() > 1) {
+        channel.subscribers = std::make_shared<UserBitmap>(*channel.subscribers);
+    }
+    return *channel.subscribers;
+}
@@ -1,14 +1,20 @@
 #include "data/connection_manager.h"
 #include "common/logger.h"
-#include <sstream>
+#include "common/snowflake_id.h"
+#include <algorithm>
 
-ConnectionManager::ConnectionManager() : connection_counter_(0) {
+ConnectionManager::ConnectionManager(std::shared_ptr<UserIdInterner> user_ids) : user_ids_(std::move(user_ids)) {
 }
 
-std::string ConnectionManager::add_connection(const std::string& user_id) {
+void ConnectionManager::set_presence_listener(PresenceListener listener) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    presence_listener_ = std::move(listener);
+}
+
+uint64_t ConnectionManager::add_connection(const std::string& user_id) {
     std::lock_guard<std::mutex> lock(connections_mutex_);
 
-    std::string connection_id = generate_connection_id();
+    const uint64_t connection_id = SnowflakeId::next();
     std::time_t now = std::time(nullptr);
 
     WebSocketConnection connection = {
@@ -20,13 +26,21 @@ std::string ConnectionManager::add_connection(const std::string& user_id) {
     };
 
     connections_[connection_id] = connection;
-    user_connections_[user_id].insert(connection_id);
+    auto& user_connections = user_connections_[user_id];
+    const bool came_online = user_connections.empty();
+    user_connections.insert(connection_id);
+    last_seen_[user_id] = now;
+    version_.fetch_add(1, std::memory_order_release);
+
+    if (came_online) {
+        notify_presence(user_id, true);
+    }
 
-    LOG_INFO("Connection added: " + connection_id + " for user: " + user_id);
+    LOG_DEBUG("Connection added: " + SnowflakeId::format(connection_id) + " for user: " + user_id);
     return connection_id;
 }
 
-bool ConnectionManager::remove_connection(const std::string& connection_id) {
+bool ConnectionManager::remove_connection(uint64_t connection_id) {
     std::lock_guard<std::mutex> lock(connections_mutex_);
 
     auto it = connections_.find(connection_id);
@@ -36,17 +50,10 @@ bool ConnectionManager::remove_connection(const std::string& connection_id) {
 
     std::string user_id = it->second.user_id;
     connections_.erase(it);
+    detach_connection(user_id, connection_id);
+    version_.fetch_add(1, std::memory_order_release);
 
-    // Remove from user connections
-    auto user_it = user_connections_.find(user_id);
-    if (user_it != user_connections_.end()) {
-        user_it->second.erase(connection_id);
-        if (user_it->second.empty()) {
-            user_connections_.erase(user_it);
-        }
-    }
-
-    LOG_INFO("Connection removed: " + connection_id + " for user: " + user_id);
+    LOG_DEBUG("Connection removed: " + SnowflakeId::format(connection_id) + " for user: " + user_id);
     return true;
 }
 
@@ -59,12 +66,16 @@ bool ConnectionManager::remove_user_connections(const std::string& user_id) {
     }
 
     // Remove all connections for this user
-    for (const std::string& connection_id : user_it->second) {
+    for (uint64_t connection_id : user_it->second) {
         connections_.erase(connection_id);
     }
 
     user_connections_.erase(user_it);
-    LOG_INFO("All connections removed for user: " + user_id);
+    last_seen_[user_id] = std::time(nullptr);
+    version_.fetch_add(1, std::memory_order_release);
+    notify_presence(user_id, false);
+
+    LOG_DEBUG("All connections removed for user: " + user_id);
     return true;
 }
 
@@ -72,7 +83,7 @@ void ConnectionManager::cleanup_inactive_connections() {
     std::lock_guard<std::mutex> lock(connections_mutex_);
 
     std::time_t now = std::time(nullptr);
-    std::vector<std::string> to_remove;
+    std::vector<uint64_t> to_remove;
 
     for (const auto& [connection_id, connection] : connections_) {
         if (now - connection.last_activity > 300) { // 5 minutes timeout
@@ -80,23 +91,17 @@ void ConnectionManager::cleanup_inactive_connections() {
         }
     }
 
-    for (const std::string& connection_id : to_remove) {
+    for (uint64_t connection_id : to_remove) {
         auto it = connections_.find(connection_id);
         if (it != connections_.end()) {
             std::string user_id = it->second.user_id;
             connections_.erase(it);
-
-            auto user_it = user_connections_.find(user_id);
-            if (user_it != user_connections_.end()) {
-                user_it->second.erase(connection_id);
-                if (user_it->second.empty()) {
-                    user_connections_.erase(user_it);
-                }
-            }
+            detach_connection(user_id, connection_id);
         }
     }
 
     if (!to_remove.empty()) {
+        version_.fetch_add(1, std::memory_order_release);
         LOG_INFO("Cleaned up " + std::to_string(to_remove.size()) + " inactive connections");
     }
 }
@@ -114,6 +119,35 @@ std::vector<std::string> ConnectionManager::get_online_users() {
     return users;
 }
 
+UserBitmap ConnectionManager::intersect_online(const UserBitmap& users) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    return UserBitmap::intersect(users, online_);
+}
+
+std::vector<std::string> ConnectionManager::filter_online_users(std::vector<std::string> candidates) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+
+    std::vector<std::string> online;
+
+    // Walk whichever side of the intersection is smaller
+    if (candidates.size() <= user_connections_.size()) {
+        for (auto& candidate : candidates) {
+            if (user_connections_.find(candidate) != user_connections_.end()) {
+                online.push_back(std::move(candidate));
+            }
+        }
+    } else {
+        std::sort(candidates.begin(), candidates.end());
+        for (const auto& [user_id, connections] : user_connections_) {
+            if (std::binary_search(candidates.begin(), candidates.end(), user_id)) {
+                online.push_back(user_id);
+            }
+        }
+    }
+
+    return online;
+}
+
 size_t ConnectionManager::get_total_connections() {
     std::lock_guard<std::mutex> lock(connections_mutex_);
     return connections_.size();
@@ -130,6 +164,20 @@ bool ConnectionManager::is_user_online(const std::string& user_id) {
     return it != user_connections_.end() && !it->second.empty();
 }
 
+std::optional<std::time_t> ConnectionManager::get_last_seen(const std::string& user_id) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+
+    if (user_connections_.find(user_id) != user_connections_.end()) {
+        return std::time(nullptr);
+    }
+
+    auto it = last_seen_.find(user_id);
+    if (it == last_seen_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
 json ConnectionManager::get_stats() {
     std::lock_guard<std::mutex> lock(connections_mutex_);
 
@@ -140,8 +188,32 @@ json ConnectionManager::get_stats() {
     };
 }
 
-std::string ConnectionManager::generate_connection_id() {
-    std::ostringstream oss;
-    oss << "conn_" << ++connection_counter_ << "_" << std::time(nullptr);
-    return oss.str();
-}
\ No newline at end of file
+void ConnectionManager::detach_connection(const std::string& user_id, uint64_t connection_id) {
+    auto user_it = user_connections_.find(user_id);
+    if (user_it == user_connections_.end()) {
+        return;
+    }
+
+    user_it->second.erase(connection_id);
+    if (user_it->second.empty()) {
+        user_connections_.erase(user_it);
+        last_seen_[user_id] = std::time(nullptr);
+        notify_presence(user_id, false);
+    }
+}
+
+void ConnectionManager::notify_presence(const std::string& user_id, bool is_connected) {
+    // Called with connections_mutex_ held so transitions reach the listener in order. Every first
+    // and last connection passes through here, so the online bitmap is kept current here too.
+    if (user_ids_) {
+        const UserIdInterner::Id id = user_ids_->intern(user_id);
+        if (is_connected) {
+            online_.add(id);
+        } else {
+            online_.remove(id);
+        }
+    }
+    if (presence_listener_) {
+        presence_listener_(user_id, is_connected);
+    }
+}
@@ -0,0 +1,166 @@
+#include "data/contact_graph.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <mutex>
+
+ContactGraph::ContactGraph(std::shared_ptr<UserIdInterner> user_ids)
+    : user_ids_(std::move(user_ids)) {
+}
+
+bool ContactGraph::add_contact(const std::string& username, const std::string& contact) {
+    if (username.empty() || contact.empty() || username == contact) {
+        return false;
+    }
+
+    // Every direct send passes through here, and the edge is almost always there already
+    if (are_contacts(username, contact)) {
+        return false;
+    }
+
+    const auto user_id = user_ids_->intern(username);
+    const auto contact_id = user_ids_->intern(contact);
+
+    std::unique_lock<std::shared_mutex> lock(graph_mutex_);
+    const bool added = link(user_id, contact_id);
+
+    if (added) {
+        LOG_INFO("Contact added: " + username + " -> " + contact);
+    }
+    return added;
+}
+
+void ContactGraph::add_conversation(const std::string& username, const std::vector<std::string>& participants) {
+    if (participants.size() < 2 || participants.size() > kMaxRosterConversationSize) {
+        return;
+    }
+
+    const auto user_id = user_ids_->intern(username);
+    std::vector<UserIdInterner::Id> ids;
+    ids.reserve(participants.size());
+    for (const auto& participant : participants) {
+        ids.push_back(user_ids_->intern(participant));
+    }
+
+    std::unique_lock<std::shared_mutex> lock(graph_mutex_);
+    for (const auto id : ids) {
+        if (id != user_id) {
+            link(user_id, id);
+        }
+    }
+}
+
+std::vector<std::string> ContactGraph::get_contacts(const std::string& username) const {
+    auto user_id = user_ids_->find(username);
+    if (!user_id.has_value()) {
+        return {};
+    }
+    return user_ids_->names(get_contact_ids(user_id.value()));
+}
+
+std::vector<std::string> ContactGraph::get_mutual_contacts(const std::string& username) const {
+    auto user_id = user_ids_->find(username);
+    if (!user_id.has_value()) {
+        return {};
+    }
+
+    std::vector<UserIdInterner::Id> mutual;
+    {
+        std::shared_lock<std::shared_mutex> lock(graph_mutex_);
+        if (user_id.value() >= adjacency_.size()) {
+            return {};
+        }
+        for (const auto contact_id : adjacency_[user_id.value()]) {
+            if (contact_id < adjacency_.size()) {
+                const auto& back = adjacency_[contact_id];
+                if (std::binary_search(back.begin(), back.end(), user_id.value())) {
+                    mutual.push_back(contact_id);
+                }
+            }
+        }
+    }
+    return user_ids_->names(mutual);
+}
+
+std::vector<UserIdInterner::Id> ContactGraph::get_contact_ids(UserIdInterner::Id user_id) const {
+    std::shared_lock<std::shared_mutex> lock(graph_mutex_);
+    if (user_id >= adjacency_.size()) {
+        return {};
+    }
+    return adjacency_[user_id];
+}
+
+bool ContactGraph::are_contacts(const std::string& username, const std::string& contact) const {
+    auto user_id = user_ids_->find(username);
+    auto contact_id = user_ids_->find(contact);
+    if (!user_id.has_value() || !contact_id.has_value()) {
+        return false;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(graph_mutex_);
+    if (user_id.value() >= adjacency_.size()) {
+        return false;
+    }
+    const auto& contacts = adjacency_[user_id.value()];
+    return std::binary_search(contacts.begin(), contacts.end(), contact_id.value());
+}
+
+void ContactGraph::track_new_links() {
+    std::unique_lock<std::shared_mutex> lock(graph_mutex_);
+    track_new_links_ = true;
+}
+
+std::vector<ContactGraph::Link> ContactGraph::take_new_links() {
+    std::vector<std::pair<UserIdInterner::Id, UserIdInterner::Id>> taken;
+    {
+        std::unique_lock<std::shared_mutex> lock(graph_mutex_);
+        taken.swap(new_links_);
+    }
+
+    std::vector<UserIdInterner::Id> ids;
+    ids.reserve(taken.size() * 2);
+    for (const auto& [from, to] : taken) {
+        ids.push_back(from);
+        ids.push_back(to);
+    }
+    const auto names = user_ids_->names(ids);
+
+    std::vector<Link> links;
+    links.reserve(taken.size());
+    for (size_t i = 0; i + 1 < names.size(); i += 2) {
+        links.emplace_back(names[i], names[i + 1]);
+    }
+    return links;
+}
+
+void ContactGraph::apply_links(const std::vector<Link>& links) {
+    std::vector<std::pair<UserIdInterner::Id, UserIdInterner::Id>> ids;
+    ids.reserve(links.size());
+    for (const auto& [username, contact] : links) {
+        if (!username.empty() && !contact.empty() && username != contact) {
+            ids.emplace_back(user_ids_->intern(username), user_ids_->intern(contact));
+        }
+    }
+
+    // Already shared by the worker that recorded them, so never queued again here
+    std::unique_lock<std::shared_mutex> lock(graph_mutex_);
+    for (const auto& [from, to] : ids) {
+        link(from, to, false);
+    }
+}
+
+bool ContactGraph::link(UserIdInterner::Id from, UserIdInterner::Id to, bool track) {
+    if (from >= adjacency_.size()) {
+        adjacency_.resize(from + 1);
+    }
+
+    auto& contacts = adjacency_[from];
+    auto it = std::lower_bound(contacts.begin(), contacts.end(), to);
+    if (it != contacts.end() && *it == to) {
+        return false;
+    }
+    contacts.insert(it, to);
+    if (track && track_new_links_) {
+        new_links_.emplace_back(from, to);
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#include "data/credential_store.h"
+#include "common/logger.h"
+#include "common/worker_cluster.h"
+
+CredentialStore::CredentialStore(std::shared_ptr<PasswordHasher> hasher)
+    : dummy_hash_(hasher->hash("dummy-password")) {
+    create_sample_credentials(*hasher);
+}
+
+bool CredentialStore::add(const std::string& username, const std::string& encoded_hash) {
+    std::lock_guard<std::mutex> lock(credentials_mutex_);
+    return hashes_.emplace(username, encoded_hash).second;
+}
+
+bool CredentialStore::exists(const std::string& username) {
+    std::lock_guard<std::mutex> lock(credentials_mutex_);
+    return hashes_.find(username) != hashes_.end();
+}
+
+std::optional<std::string> CredentialStore::get_hash(const std::string& username) {
+    std::lock_guard<std::mutex> lock(credentials_mutex_);
+    auto it = hashes_.find(username);
+    if (it == hashes_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void CredentialStore::update_hash(const std::string& username, const std::string& encoded_hash) {
+    std::lock_guard<std::mutex> lock(credentials_mutex_);
+    auto it = hashes_.find(username);
+    if (it != hashes_.end()) {
+        it->second = encoded_hash;
+    }
+}
+
+size_t CredentialStore::size() {
+    std::lock_guard<std::mutex> lock(credentials_mutex_);
+    return hashes_.size();
+}
+
+void CredentialStore::create_sample_credentials(PasswordHasher& hasher) {
+    // Matches the sample users in UserManager; in multi-worker mode each worker seeds the users it owns
+    for (const std::string username : {"alice", "bob", "charlie"}) {
+        if (WorkerCluster::owns(username)) {
+            hashes_[username] = hasher.hash("password123");
+        }
+    }
+
+    LOG_INFO("Sample credentials created (password: password123)");
+}
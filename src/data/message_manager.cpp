@@ -1,91 +1,484 @@
 #include "data/message_manager.h"
 #include "common/logger.h"
+#include "common/snowflake_id.h"
+#include "common/worker_cluster.h"
 #include <algorithm>
 #include <sstream>
 
-MessageManager::MessageManager() : message_counter_(1) {
+MessageManager::MessageManager(std::shared_ptr<ContactGraph> contact_graph, std::shared_ptr<ChangeLog> change_log,
+                               std::shared_ptr<SearchIndex> search_index)
+    : contact_graph_(std::move(contact_graph)), change_log_(std::move(change_log)),
+      search_index_(std::move(search_index)) {
     create_sample_messages();
 }
 
-std::string MessageManager::send_message(const std::string& from_user, const std::string& to_user, const std::string& content) {
+uint64_t MessageManager::send_message(const std::string& from_user, const std::string& to_user, const std::string& content) {
+    return send_messages(from_user, to_user, {content}).front().id;
+}
+
+std::vector<Message> MessageManager::send_messages(const std::string& from_user, const std::string& to_user,
+                                                   const std::vector<std::string>& contents) {
     std::lock_guard<std::mutex> lock(conversations_mutex_);
 
-    // Create message
-    Message message = {
-        generate_message_id(),
-        from_user,
-        to_user,
-        content,
-        std::time(nullptr),
-        false
-    };
+    const std::time_t now = std::time(nullptr);
 
     // Get or create conversation
     std::string conv_id = get_conversation_id(from_user, to_user);
 
     if (conversations_.find(conv_id) == conversations_.end()) {
-        conversations_[conv_id] = {
-            conv_id,
-            {from_user, to_user},
-            {},
-            message.timestamp
+        Conversation& created = conversations_[conv_id];
+        created.id = conv_id;
+        created.participants = {from_user, to_user};
+        created.last_activity = now;
+        user_conversations_[from_user].insert(conv_id);
+        user_conversations_[to_user].insert(conv_id);
+    }
+
+    // Writing to someone adds them to the sender's roster; a reply closes the loop
+    if (contact_graph_) {
+        contact_graph_->add_contact(from_user, to_user);
+    }
+
+    Conversation& conversation = conversations_[conv_id];
+    auto sent = append_messages(conversation, from_user, to_user, contents);
+
+    LOG_INFO("Messages sent: " + std::to_string(sent.size()) + " from " + from_user + " to " + to_user +
+             " (last " + SnowflakeId::format(sent.back().id) + ")");
+    return sent;
+}
+
+std::vector<Message> MessageManager::append_messages(Conversation& conversation, const std::string& from_user,
+                                                     const std::string& to_user,
+                                                     const std::vector<std::string>& contents) {
+    const std::time_t now = std::time(nullptr);
+    const bool had_unread = unread_in(conversation, from_user) > 0;
+
+    // A group's changes go to its own feed once, not to every member's
+    auto change = [&conversation](const std::string& type, json data) -> ChangeLog::Entry {
+        if (conversation.is_group) {
+            return {{}, type, std::move(data), conversation.id};
+        }
+        return {conversation.participants, type, std::move(data)};
+    };
+
+    std::vector<Message> sent;
+    sent.reserve(contents.size());
+    std::vector<ChangeLog::Entry> changes;
+    changes.reserve(contents.size() + 1);
+
+    for (const auto& content : contents) {
+        Message message = {
+            SnowflakeId::next(),
+            from_user,
+            to_user,
+            content,
+            now,
+            ++conversation.last_sequence
         };
+
+        conversation.messages.push_back(message);
+        index_message(message, conversation.id);
+
+        changes.push_back(change("message", {
+            {"conversation_id", conversation.id},
+            {"message", {
+                {"id", SnowflakeId::format(message.id)},
+                {"from_user", message.from_user},
+                {"to_user", message.to_user},
+                {"content", message.content},
+                {"timestamp", message.timestamp},
+                {"sequence", message.sequence}
+            }}
+        }));
+        sent.push_back(std::move(message));
+    }
+
+    if (!conversation.is_group && from_user != to_user) {
+        set_unread(conversation, to_user, conversation.read_states[to_user].unread + sent.size());
+    }
+
+    // Replying means the sender has seen everything before their own messages
+    conversation.read_states[from_user].read_up_to = conversation.last_sequence;
+    set_unread(conversation, from_user, 0);
+    if (conversation.is_group) {
+        update_group_unread(conversation, {from_user});
+    }
+    if (had_unread) {
+        changes.push_back(change("read", read_event(conversation, from_user)));
+    }
+
+    conversation.last_activity = now;
+    touch_participants(conversation);
+    if (change_log_) {
+        change_log_->append_all(std::move(changes));
+    }
+    return sent;
+}
+
+bool MessageManager::mark_message_as_read(uint64_t message_id, const std::string& username) {
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+
+    Conversation* conversation = nullptr;
+    Message* message = find_message(message_id, conversation);
+    if (message == nullptr) {
+        return false;
+    }
+    // A group message is addressed to every member but its sender
+    const bool addressed = conversation->is_group
+        ? message->from_user != username && is_user_participant(*conversation, username)
+        : message->to_user == username;
+    if (!addressed) {
+        return false;
+    }
+
+    if (advance_watermark(*conversation, username, message->sequence)) {
+        touch_participants(*conversation);
+        record_change(*conversation, "read", read_event(*conversation, username));
     }
+    LOG_INFO("Message marked as read: " + SnowflakeId::format(message_id) + " by " + username);
+    return true;
+}
+
+std::optional<ReadState> MessageManager::mark_read_up_to(const std::string& conversation_id,
+                                                         const std::string& username,
+                                                         std::optional<uint64_t> sequence) {
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
 
-    conversations_[conv_id].messages.push_back(message);
-    conversations_[conv_id].last_activity = message.timestamp;
+    auto it = conversations_.find(conversation_id);
+    if (it == conversations_.end() || !is_user_participant(it->second, username)) {
+        return std::nullopt;
+    }
 
-    LOG_INFO("Message sent: " + message.id + " from " + from_user + " to " + to_user);
-    return message.id;
+    Conversation& conversation = it->second;
+    if (advance_watermark(conversation, username, sequence.value_or(conversation.last_sequence))) {
+        touch_participants(conversation);
+        record_change(conversation, "read", read_event(conversation, username));
+        LOG_INFO("Conversation " + conversation_id + " read up to " +
+                 std::to_string(conversation.read_states[username].read_up_to) + " by " + username);
+    }
+    return ReadState{conversation.read_states[username].read_up_to, unread_in(conversation, username)};
 }
 
-bool MessageManager::mark_message_as_read(const std::string& message_id, const std::string& username) {
+bool MessageManager::delete_message(uint64_t message_id, const std::string& username) {
     std::lock_guard<std::mutex> lock(conversations_mutex_);
 
-    for (auto& [conv_id, conversation] : conversations_) {
-        for (auto& message : conversation.messages) {
-            if (message.id == message_id && message.to_user == username) {
-                message.is_read = true;
-                LOG_INFO("Message marked as read: " + message_id + " by " + username);
-                return true;
+    Conversation* conversation = nullptr;
+    Message* message = find_message(message_id, conversation);
+    if (message == nullptr || message->from_user != username) {
+        return false;
+    }
+
+    // An unread message stops counting for whoever hadn't read it
+    if (!conversation->is_group) {
+        ReadState& recipient = conversation->read_states[message->to_user];
+        if (message->sequence > recipient.read_up_to && recipient.unread > 0) {
+            set_unread(*conversation, message->to_user, recipient.unread - 1);
+        }
+    }
+
+    const uint64_t sequence = message->sequence;
+    auto indexed = message_index_.find(message_id);
+    if (search_index_) {
+        search_index_->remove(indexed->second.search_doc);
+    }
+    message_index_.erase(indexed);
+    conversation->messages.erase(conversation->messages.begin() + (message - conversation->messages.data()));
+
+    // Members who had read past it have one read message fewer; the rest one unread fewer
+    if (conversation->is_group) {
+        std::vector<std::string> readers;
+        for (const auto& [member, state] : conversation->read_states) {
+            if (state.read_up_to >= sequence) {
+                readers.push_back(member);
             }
         }
+        update_group_unread(*conversation, readers);
     }
+    touch_participants(*conversation);
+    record_change(*conversation, "delete", {{"conversation_id", conversation->id}, {"message_id", SnowflakeId::format(message_id)}});
+    LOG_INFO("Message deleted: " + SnowflakeId::format(message_id) + " by " + username);
+    return true;
+}
+
+std::string MessageManager::create_group(const std::string& creator, const std::string& name,
+                                         const std::vector<std::string>& members, size_t* member_count) {
+    const std::string group_id = "group_" + SnowflakeId::format(SnowflakeId::next());
+
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+
+    Conversation& group = conversations_[group_id];
+    group.id = group_id;
+    group.is_group = true;
+    group.name = name;
+    group.last_activity = std::time(nullptr);
+    group.members.insert(creator);
+    group.members.insert(members.begin(), members.end());
+    for (const auto& member : group.members) {
+        group.read_states[member];
+        user_conversations_[member].insert(group_id);
+    }
+    update_group_unread(group, {group.members.begin(), group.members.end()});
+
+    if (contact_graph_) {
+        contact_graph_->add_conversation(creator, {group.members.begin(), group.members.end()});
+    }
+
+    touch_participants(group);
+    record_change(group, "members", {
+        {"conversation_id", group_id},
+        {"name", name},
+        {"member_count", group.members.size()},
+        {"added", std::vector<std::string>(group.members.begin(), group.members.end())}
+    });
 
-    return false;
+    if (member_count) {
+        *member_count = group.members.size();
+    }
+    LOG_INFO("Group created: " + group_id + " by " + creator + " (" + std::to_string(group.members.size()) + " members)");
+    return group_id;
 }
 
-bool MessageManager::delete_message(const std::string& message_id, const std::string& username) {
+GroupUpdate MessageManager::add_group_members(const std::string& group_id, const std::string& username,
+                                              const std::vector<std::string>& members, size_t* member_count) {
     std::lock_guard<std::mutex> lock(conversations_mutex_);
 
-    for (auto& [conv_id, conversation] : conversations_) {
-        auto& messages = conversation.messages;
-        auto it = std::find_if(messages.begin(), messages.end(),
-            [&](const Message& msg) {
-                return msg.id == message_id && msg.from_user == username;
-            });
+    auto it = conversations_.find(group_id);
+    if (it == conversations_.end() || !it->second.is_group || !is_user_participant(it->second, username)) {
+        return GroupUpdate::NotFound;
+    }
 
-        if (it != messages.end()) {
-            messages.erase(it);
-            LOG_INFO("Message deleted: " + message_id + " by " + username);
-            return true;
+    Conversation& group = it->second;
+    std::vector<std::string> added;
+    for (const auto& member : members) {
+        if (group.members.count(member) == 0) {
+            added.push_back(member);
         }
     }
+    std::sort(added.begin(), added.end());
+    added.erase(std::unique(added.begin(), added.end()), added.end());
+    if (group.members.size() + added.size() > kMaxGroupMembers) {
+        return GroupUpdate::Full;
+    }
+    if (member_count) {
+        *member_count = group.members.size() + added.size();
+    }
+    if (added.empty()) {
+        return GroupUpdate::Updated;
+    }
 
-    return false;
+    // New members start with everything already in the group read
+    for (const auto& member : added) {
+        group.members.insert(member);
+        group.read_states[member] = {group.last_sequence, 0};
+        user_conversations_[member].insert(group_id);
+    }
+    update_group_unread(group, added);
+
+    if (contact_graph_) {
+        contact_graph_->add_conversation(username, {group.members.begin(), group.members.end()});
+    }
+
+    touch_participants(group);
+    record_change(group, "members", {
+        {"conversation_id", group_id},
+        {"name", group.name},
+        {"member_count", group.members.size()},
+        {"added", added}
+    });
+
+    LOG_INFO("Group " + group_id + ": " + std::to_string(added.size()) + " members added by " + username);
+    return GroupUpdate::Updated;
 }
 
-std::vector<Conversation> MessageManager::get_user_conversations(const std::string& username) {
+bool MessageManager::leave_group(const std::string& group_id, const std::string& username) {
     std::lock_guard<std::mutex> lock(conversations_mutex_);
 
-    std::vector<Conversation> user_conversations;
+    auto it = conversations_.find(group_id);
+    if (it == conversations_.end() || !it->second.is_group || !is_user_participant(it->second, username)) {
+        return false;
+    }
 
-    for (const auto& [conv_id, conversation] : conversations_) {
-        if (is_user_participant(conversation, username)) {
-            user_conversations.push_back(conversation);
+    Conversation& group = it->second;
+    group.members.erase(username);
+    group.read_states.erase(username);
+    auto conversations = user_conversations_.find(username);
+    conversations->second.erase(group_id);
+    if (conversations->second.empty()) {
+        user_conversations_.erase(conversations);
+    }
+    {
+        std::lock_guard<std::mutex> unread_lock(unread_mutex_);
+        auto groups = group_reads_.find(username);
+        groups->second.erase(group_id);
+        if (groups->second.empty()) {
+            group_reads_.erase(groups);
         }
     }
 
+    touch_participants(group);
+    {
+        // The group's version no longer counts towards the leaver's, so theirs moves on its own
+        std::lock_guard<std::mutex> versions_lock(versions_mutex_);
+        user_versions_[username] = ++version_counter_;
+    }
+
+    json event = {
+        {"conversation_id", group_id},
+        {"name", group.name},
+        {"member_count", group.members.size()},
+        {"removed", {username}}
+    };
+    // The leaver stops reading the group's feed, so they are told in their own
+    if (change_log_) {
+        change_log_->append_all({{{}, "members", event, group_id}, {{username}, "members", event}});
+    }
+
+    LOG_INFO("Group " + group_id + ": " + username + " left");
+    return true;
+}
+
+std::optional<std::vector<std::string>> MessageManager::group_members(const std::string& group_id,
+                                                                      const std::string& username) {
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+
+    auto it = conversations_.find(group_id);
+    if (it == conversations_.end() || !it->second.is_group || !is_user_participant(it->second, username)) {
+        return std::nullopt;
+    }
+
+    std::vector<std::string> members(it->second.members.begin(), it->second.members.end());
+    std::sort(members.begin(), members.end());
+    return members;
+}
+
+std::optional<Message> MessageManager::send_group_message(const std::string& group_id, const std::string& from_user,
+                                                          const std::string& content) {
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+
+    auto it = conversations_.find(group_id);
+    if (it == conversations_.end() || !it->second.is_group || !is_user_participant(it->second, from_user)) {
+        return std::nullopt;
+    }
+
+    Message message = append_messages(it->second, from_user, group_id, {content}).front();
+    LOG_INFO("Group message sent: " + SnowflakeId::format(message.id) + " from " + from_user + " to " + group_id);
+    return message;
+}
+
+std::vector<std::string> MessageManager::user_groups(const std::string& username) {
+    std::lock_guard<std::mutex> lock(unread_mutex_);
+
+    std::vector<std::string> groups;
+    auto it = group_reads_.find(username);
+    if (it != group_reads_.end()) {
+        groups.reserve(it->second.size());
+        for (const auto& [group_id, read] : it->second) {
+            groups.push_back(group_id);
+        }
+    }
+    return groups;
+}
+
+ArenaJson MessageManager::search_messages_json(const std::string& username, std::string_view query, size_t offset,
+                                               size_t limit, size_t& total) {
+    total = 0;
+    ArenaJson results = ArenaJson::array();
+    if (!search_index_) {
+        return results;
+    }
+
+    std::vector<std::string> scope;
+    {
+        std::lock_guard<std::mutex> lock(conversations_mutex_);
+        auto it = user_conversations_.find(username);
+        if (it != user_conversations_.end()) {
+            scope.assign(it->second.begin(), it->second.end());
+        }
+    }
+
+    // The index has its own lock; searching doesn't hold up senders
+    SearchIndex::Result result = search_index_->search(scope, query, offset, limit);
+    total = result.total;
+
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+    for (const auto& hit : result.hits) {
+        auto it = conversations_.find(hit.conversation_id);
+        if (it == conversations_.end()) {
+            continue;
+        }
+        // Skips messages deleted since the search ran
+        if (const Message* message = find_by_sequence(it->second, hit.sequence)) {
+            ArenaJson& result_json = results.emplace_back(message_to_json(it->second, *message));
+            result_json["conversation_id"] = hit.conversation_id;
+            result_json["score"] = hit.score;
+        }
+    }
+    return results;
+}
+
+UnreadCounts MessageManager::unread_counts(const std::string& username) {
+    std::lock_guard<std::mutex> lock(unread_mutex_);
+
+    UnreadCounts counts;
+    auto it = unread_counts_.find(username);
+    if (it != unread_counts_.end()) {
+        counts = it->second;
+    }
+
+    // A group's unread count is whatever the member hasn't read of what it holds
+    auto groups = group_reads_.find(username);
+    if (groups != group_reads_.end()) {
+        for (const auto& [group_id, read] : groups->second) {
+            const size_t unread = group_sizes_.at(group_id) - read;
+            if (unread > 0) {
+                counts.total += unread;
+                counts.conversations[group_id] = unread;
+            }
+        }
+    }
+    return counts;
+}
+
+uint64_t MessageManager::user_version(const std::string& username) {
+    // unread_mutex_ holds group membership; writers never take it together with versions_mutex_
+    std::lock_guard<std::mutex> lock(unread_mutex_);
+    std::lock_guard<std::mutex> versions_lock(versions_mutex_);
+
+    auto it = user_versions_.find(username);
+    uint64_t version = it == user_versions_.end() ? 0 : it->second;
+
+    // A group send stamps only the group; its members' versions include it from here
+    auto groups = group_reads_.find(username);
+    if (groups != group_reads_.end()) {
+        for (const auto& [group_id, read] : groups->second) {
+            auto group_version = group_versions_.find(group_id);
+            if (group_version != group_versions_.end()) {
+                version = std::max(version, group_version->second);
+            }
+        }
+    }
+    return version;
+}
+
+std::optional<uint64_t> MessageManager::conversation_version(const std::string& conversation_id,
+                                                             const std::string& username) {
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+
+    auto it = conversations_.find(conversation_id);
+    if (it == conversations_.end() || !is_user_participant(it->second, username)) {
+        return std::nullopt;
+    }
+    return it->second.version;
+}
+
+std::vector<Conversation> MessageManager::get_user_conversations(const std::string& username) {
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+
+    std::vector<Conversation> user_conversations;
+    for (const Conversation* conversation : conversations_of(username)) {
+        user_conversations.push_back(*conversation);
+    }
+
     // Sort by last activity (most recent first)
     std::sort(user_conversations.begin(), user_conversations.end(),
         [](const Conversation& a, const Conversation& b) {
@@ -121,55 +514,307 @@ std::vector<Message> MessageManager::get_conversation_messages(const std::string
     return it->second.messages;
 }
 
-json MessageManager::message_to_json(const Message& message) {
-    return {
-        {"id", message.id},
-        {"from_user", message.from_user},
-        {"to_user", message.to_user},
-        {"content", message.content},
-        {"timestamp", message.timestamp},
-        {"is_read", message.is_read}
-    };
+ArenaJson MessageManager::user_conversations_json(const std::string& username) {
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+
+    std::pmr::vector<const Conversation*> user_conversations(RequestArena::current());
+    for (const Conversation* conversation : conversations_of(username)) {
+        user_conversations.push_back(conversation);
+    }
+
+    std::sort(user_conversations.begin(), user_conversations.end(),
+        [](const Conversation* a, const Conversation* b) {
+            return a->last_activity > b->last_activity;
+        });
+
+    ArenaJson conversations_array = ArenaJson::array();
+    for (const Conversation* conversation : user_conversations) {
+        conversations_array.push_back(conversation_to_json(*conversation, username));
+    }
+    return conversations_array;
 }
 
-json MessageManager::conversation_to_json(const Conversation& conversation, bool include_messages) {
-    json conv_json = {
-        {"id", conversation.id},
-        {"participants", conversation.participants},
-        {"last_activity", conversation.last_activity},
-        {"message_count", conversation.messages.size()}
-    };
+std::optional<ArenaJson> MessageManager::conversation_messages_json(const std::string& conversation_id,
+                                                                    const std::string& username,
+                                                                    const MessageRange& range, bool* has_more) {
+    std::lock_guard<std::mutex> lock(conversations_mutex_);
+
+    auto it = conversations_.find(conversation_id);
+    if (it == conversations_.end() || !is_user_participant(it->second, username)) {
+        return std::nullopt;
+    }
+
+    // Ids increase with the sequence, so the bounds are binary searches
+    const auto& messages = it->second.messages;
+    auto first = messages.begin();
+    auto last = messages.end();
+    if (range.after) {
+        first = std::upper_bound(messages.begin(), messages.end(), *range.after,
+            [](uint64_t id, const Message& m) { return id < m.id; });
+    }
+    if (range.before) {
+        last = std::lower_bound(first, messages.end(), *range.before,
+            [](const Message& m, uint64_t id) { return m.id < id; });
+    }
+
+    const bool cut = range.limit != 0 && static_cast<size_t>(last - first) > range.limit;
+    if (cut) {
+        if (range.before && !range.after) {
+            first = last - range.limit;
+        } else {
+            last = first + range.limit;
+        }
+    }
+    if (has_more) {
+        *has_more = cut;
+    }
+
+    ArenaJson messages_array = ArenaJson::array();
+    for (auto message = first; message != last; ++message) {
+        messages_array.push_back(message_to_json(it->second, *message));
+    }
+    return messages_array;
+}
+
+ArenaJson MessageManager::message_to_json(const Conversation& conversation, const Message& message) {
+    // Keyed assignment rather than an initializer list: nlohmann's destructor allocates a scratch
+    // stack (outside the arena) for each {key, value} pair array the list would create
+    ArenaJson message_json(ArenaJson::value_t::object);
+    message_json["id"] = SnowflakeId::format(message.id);
+    message_json["from_user"] = message.from_user;
+    message_json["to_user"] = message.to_user;
+    message_json["content"] = message.content;
+    message_json["timestamp"] = message.timestamp;
+    message_json["sequence"] = message.sequence;
+    // Group messages have a reader per member; each sees their own read_up_to on the conversation
+    if (!conversation.is_group) {
+        auto reader = conversation.read_states.find(message.to_user);
+        message_json["is_read"] = reader != conversation.read_states.end() && message.sequence <= reader->second.read_up_to;
+    }
+    return message_json;
+}
+
+ArenaJson MessageManager::conversation_to_json(const Conversation& conversation, const std::string& username,
+                                               bool include_messages) {
+    auto state = conversation.read_states.find(username);
+    const uint64_t read_up_to = state == conversation.read_states.end() ? 0 : state->second.read_up_to;
+
+    ArenaJson conv_json(ArenaJson::value_t::object);
+    conv_json["id"] = conversation.id;
+    if (conversation.is_group) {
+        // Members are listed separately; a listing shouldn't carry thousands of names per group
+        conv_json["type"] = "group";
+        conv_json["name"] = conversation.name;
+        conv_json["member_count"] = conversation.members.size();
+    } else {
+        conv_json["type"] = "direct";
+        conv_json["participants"] = conversation.participants;
+    }
+    conv_json["last_activity"] = conversation.last_activity;
+    conv_json["message_count"] = conversation.messages.size();
+    conv_json["last_sequence"] = conversation.last_sequence;
+    conv_json["read_up_to"] = read_up_to;
+    conv_json["unread_count"] = unread_in(conversation, username);
 
     if (include_messages) {
-        json messages_array = json::array();
+        ArenaJson messages_array = ArenaJson::array();
         for (const auto& message : conversation.messages) {
-            messages_array.push_back(message_to_json(message));
+            messages_array.push_back(message_to_json(conversation, message));
         }
-        conv_json["messages"] = messages_array;
+        conv_json["messages"] = std::move(messages_array);
     } else if (!conversation.messages.empty()) {
         // Add last message preview
         const auto& last_msg = conversation.messages.back();
-        conv_json["last_message"] = {
-            {"content", last_msg.content.substr(0, 50) + (last_msg.content.length() > 50 ? "..." : "")},
-            {"from", last_msg.from_user},
-            {"timestamp", last_msg.timestamp}
-        };
+        ArenaJson& preview = conv_json["last_message"];
+        // Cut in the arena: a std::string temporary here would be one heap allocation per conversation
+        ArenaString content(last_msg.content.data(), std::min<size_t>(last_msg.content.size(), 50));
+        if (last_msg.content.length() > 50) {
+            content += "...";
+        }
+        preview["content"] = std::move(content);
+        preview["from"] = last_msg.from_user;
+        preview["timestamp"] = last_msg.timestamp;
     }
 
     return conv_json;
 }
 
-std::string MessageManager::generate_message_id() {
-    return "msg_" + std::to_string(std::time(nullptr)) + "_" + std::to_string(message_counter_++);
-}
-
 std::string MessageManager::get_conversation_id(const std::string& user1, const std::string& user2) {
     std::vector<std::string> users = {user1, user2};
     std::sort(users.begin(), users.end());
     return "conv_" + users[0] + "_" + users[1];
 }
 
+bool MessageManager::is_group_id(const std::string& conversation_id) {
+    return conversation_id.compare(0, 6, "group_") == 0;
+}
+
+int MessageManager::owner_of(const std::string& conversation_id) {
+    if (is_group_id(conversation_id)) {
+        if (auto id = SnowflakeId::parse(conversation_id.substr(6))) {
+            return static_cast<int>(SnowflakeId::node_of(*id));
+        }
+    }
+    return WorkerCluster::owner_of(conversation_id);
+}
+
+void MessageManager::touch_participants(Conversation& conversation) {
+    // Called with conversations_mutex_ held, so versions move in the same order as the data
+    std::lock_guard<std::mutex> lock(versions_mutex_);
+    const uint64_t version = ++version_counter_;
+    conversation.version = version;
+    // Group members pick the group's version up in user_version()
+    if (conversation.is_group) {
+        group_versions_[conversation.id] = version;
+    }
+    for (const auto& participant : conversation.participants) {
+        user_versions_[participant] = version;
+    }
+}
+
+void MessageManager::record_change(const Conversation& conversation, const std::string& type, json data) {
+    // Also called with conversations_mutex_ held, so each participant's feed is in mutation order
+    if (!change_log_) {
+        return;
+    }
+    if (conversation.is_group) {
+        change_log_->append_group(conversation.id, type, std::move(data));
+    } else {
+        change_log_->append(conversation.participants, type, std::move(data));
+    }
+}
+
+Message* MessageManager::find_message(uint64_t message_id, Conversation*& conversation) {
+    auto indexed = message_index_.find(message_id);
+    if (indexed == message_index_.end()) {
+        return nullptr;
+    }
+
+    auto it = conversations_.find(indexed->second.conversation_id);
+    if (it == conversations_.end()) {
+        return nullptr;
+    }
+
+    Message* message = find_by_sequence(it->second, indexed->second.sequence);
+    if (message != nullptr) {
+        conversation = &it->second;
+    }
+    return message;
+}
+
+Message* MessageManager::find_by_sequence(Conversation& conversation, uint64_t sequence) {
+    // Messages stay in sequence order (deletes leave gaps), so the position is a binary search away
+    auto& messages = conversation.messages;
+    auto message = std::lower_bound(messages.begin(), messages.end(), sequence,
+        [](const Message& m, uint64_t value) { return m.sequence < value; });
+    if (message == messages.end() || message->sequence != sequence) {
+        return nullptr;
+    }
+    return &*message;
+}
+
+void MessageManager::index_message(const Message& message, const std::string& conversation_id) {
+    // Called with conversations_mutex_ held, so the index sees messages in send order
+    SearchIndex::DocId doc = 0;
+    if (search_index_) {
+        doc = search_index_->add(conversation_id, message.sequence, message.content);
+    }
+    message_index_[message.id] = {conversation_id, message.sequence, doc};
+}
+
+bool MessageManager::advance_watermark(Conversation& conversation, const std::string& username, uint64_t sequence) {
+    ReadState& state = conversation.read_states[username];
+    sequence = std::min(sequence, conversation.last_sequence);
+    if (sequence <= state.read_up_to) {
+        return false;
+    }
+
+    // Everything above the old watermark was unread; count what the new one passes over
+    auto by_sequence = [](uint64_t value, const Message& m) { return value < m.sequence; };
+    const auto& messages = conversation.messages;
+    auto from = std::upper_bound(messages.begin(), messages.end(), state.read_up_to, by_sequence);
+    auto to = std::upper_bound(from, messages.end(), sequence, by_sequence);
+    set_unread(conversation, username, state.unread - std::min<size_t>(state.unread, static_cast<size_t>(to - from)));
+    state.read_up_to = sequence;
+    if (conversation.is_group) {
+        update_group_unread(conversation, {username});
+    }
+    return true;
+}
+
+void MessageManager::set_unread(Conversation& conversation, const std::string& username, size_t unread) {
+    // Called with conversations_mutex_ held, so totals move in the same order as the watermarks.
+    // Groups keep their counts in update_group_unread instead.
+    if (conversation.is_group) {
+        return;
+    }
+    ReadState& state = conversation.read_states[username];
+    if (state.unread == unread) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(unread_mutex_);
+    UnreadCounts& counts = unread_counts_[username];
+    counts.total = counts.total - state.unread + unread;
+    if (unread == 0) {
+        counts.conversations.erase(conversation.id);
+    } else {
+        counts.conversations[conversation.id] = unread;
+    }
+    state.unread = unread;
+}
+
+void MessageManager::update_group_unread(const Conversation& group, const std::vector<std::string>& readers) {
+    // Called with conversations_mutex_ held. A member's unread count is the group's size less what
+    // they have read, so only the readers named here move: a send touches the sender alone.
+    std::lock_guard<std::mutex> lock(unread_mutex_);
+    group_sizes_[group.id] = group.messages.size();
+    for (const auto& reader : readers) {
+        group_reads_[reader][group.id] = group.messages.size() - unread_in(group, reader);
+    }
+}
+
+json MessageManager::read_event(const Conversation& conversation, const std::string& username) {
+    return {
+        {"conversation_id", conversation.id},
+        {"username", username},
+        {"read_up_to", conversation.read_states.at(username).read_up_to}
+    };
+}
+
+size_t MessageManager::unread_in(const Conversation& conversation, const std::string& username) const {
+    auto state = conversation.read_states.find(username);
+    if (state == conversation.read_states.end()) {
+        return 0;
+    }
+    if (!conversation.is_group) {
+        return state->second.unread;
+    }
+
+    // Whatever lies above a watermark came from someone else, so it is all unread
+    const auto& messages = conversation.messages;
+    auto first_unread = std::upper_bound(messages.begin(), messages.end(), state->second.read_up_to,
+        [](uint64_t value, const Message& m) { return value < m.sequence; });
+    return static_cast<size_t>(messages.end() - first_unread);
+}
+
+std::vector<const Conversation*> MessageManager::conversations_of(const std::string& username) const {
+    std::vector<const Conversation*> result;
+    auto it = user_conversations_.find(username);
+    if (it == user_conversations_.end()) {
+        return result;
+    }
+    result.reserve(it->second.size());
+    for (const auto& conv_id : it->second) {
+        result.push_back(&conversations_.at(conv_id));
+    }
+    return result;
+}
+
 bool MessageManager::is_user_participant(const Conversation& conversation, const std::string& username) {
+    if (conversation.is_group) {
+        return conversation.members.count(username) > 0;
+    }
     const auto& participants = conversation.participants;
     return std::find(participants.begin(), participants.end(), username) != participants.end();
 }
@@ -177,18 +822,37 @@ bool MessageManager::is_user_participant(const Conversation& conversation, const
 void MessageManager::create_sample_messages() {
     std::time_t now = std::time(nullptr);
 
-    // Create sample conversation
+    // Every worker keeps the whole roster, so the sample edges go in everywhere
+    if (contact_graph_) {
+        contact_graph_->add_contact("alice", "bob");
+        contact_graph_->add_contact("bob", "alice");
+    }
+
+    // Create sample conversation (only on the worker that owns it)
     std::string conv_id = get_conversation_id("alice", "bob");
-    conversations_[conv_id] = {
-        conv_id,
-        {"alice", "bob"},
-        {
-            {"msg_1", "alice", "bob", "Hello Bob! How are you?", now - 3600, true},
-            {"msg_2", "bob", "alice", "Hi Alice! I'm doing great, thanks!", now - 3500, true},
-            {"msg_3", "alice", "bob", "That's wonderful to hear!", now - 3400, false}
-        },
-        now - 3400
+    if (!WorkerCluster::owns(conv_id)) {
+        return;
+    }
+
+    Conversation& conversation = conversations_[conv_id];
+    conversation.id = conv_id;
+    conversation.participants = {"alice", "bob"};
+    conversation.messages = {
+        {SnowflakeId::next(), "alice", "bob", "Hello Bob! How are you?", now - 3600, 1},
+        {SnowflakeId::next(), "bob", "alice", "Hi Alice! I'm doing great, thanks!", now - 3500, 2},
+        {SnowflakeId::next(), "alice", "bob", "That's wonderful to hear!", now - 3400, 3}
     };
+    conversation.last_activity = now - 3400;
+    conversation.last_sequence = 3;
+    // Bob has read up to his own reply; Alice's last message is still unread
+    conversation.read_states["alice"] = {3, 0};
+    conversation.read_states["bob"] = {2, 0};
+    set_unread(conversation, "bob", 1);
+    user_conversations_["alice"].insert(conv_id);
+    user_conversations_["bob"].insert(conv_id);
+    for (const auto& message : conversation.messages) {
+        index_message(message, conv_id);
+    }
 
     LOG_INFO("Sample messages created for conversation: " + conv_id);
 }
\ No newline at end of file
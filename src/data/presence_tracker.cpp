@@ -0,0 +1,100 @@
+#include "data/presence_tracker.h"
+#include "common/logger.h"
+
+PresenceTracker::PresenceTracker(std::chrono::milliseconds grace_period)
+    : grace_period_(grace_period),
+      raw_transitions_(0),
+      suppressed_flaps_(0),
+      published_changes_(0),
+      digests_(0),
+      digest_events_(0) {
+}
+
+void PresenceTracker::on_connection_state(const std::string& user_id, bool is_connected) {
+    std::lock_guard<std::mutex> lock(presence_mutex_);
+
+    ++raw_transitions_;
+
+    auto [it, inserted] = users_.try_emplace(user_id, Entry{false, false, Clock::time_point()});
+    Entry& entry = it->second;
+
+    if (is_connected) {
+        // Reconnected inside the grace window: contacts never saw the user leave
+        if (!entry.connected && entry.published_online) {
+            ++suppressed_flaps_;
+        }
+        entry.connected = true;
+    } else {
+        entry.connected = false;
+        entry.disconnected_at = Clock::now();
+    }
+
+    dirty_users_.insert(user_id);
+}
+
+std::vector<PresenceChange> PresenceTracker::collect_digest() {
+    std::lock_guard<std::mutex> lock(presence_mutex_);
+
+    std::vector<PresenceChange> changes;
+    if (dirty_users_.empty()) {
+        return changes;
+    }
+
+    const auto now = Clock::now();
+    const std::time_t timestamp = std::time(nullptr);
+
+    for (auto dirty_it = dirty_users_.begin(); dirty_it != dirty_users_.end();) {
+        auto it = users_.find(*dirty_it);
+        if (it == users_.end()) {
+            dirty_it = dirty_users_.erase(dirty_it);
+            continue;
+        }
+
+        Entry& entry = it->second;
+        if (!entry.connected && now - entry.disconnected_at < grace_period_) {
+            // Still inside the grace period, decide on a later digest
+            ++dirty_it;
+            continue;
+        }
+
+        if (entry.connected != entry.published_online) {
+            entry.published_online = entry.connected;
+            changes.push_back({it->first, entry.connected, timestamp});
+        }
+
+        if (!entry.connected) {
+            users_.erase(it);
+        }
+        dirty_it = dirty_users_.erase(dirty_it);
+    }
+
+    if (!changes.empty()) {
+        ++digests_;
+        published_changes_ += changes.size();
+    }
+
+    return changes;
+}
+
+void PresenceTracker::record_delivery(size_t events_sent) {
+    std::lock_guard<std::mutex> lock(presence_mutex_);
+    digest_events_ += events_sent;
+}
+
+std::chrono::milliseconds PresenceTracker::get_grace_period() const {
+    return grace_period_;
+}
+
+json PresenceTracker::get_stats() {
+    std::lock_guard<std::mutex> lock(presence_mutex_);
+
+    return {
+        {"grace_period_ms", grace_period_.count()},
+        {"raw_transitions", raw_transitions_},
+        {"suppressed_flaps", suppressed_flaps_},
+        {"published_changes", published_changes_},
+        {"digests", digests_},
+        {"digest_events", digest_events_},
+        {"pending_users", dirty_users_.size()}
+    };
+}
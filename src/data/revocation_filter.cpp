@@ -0,0 +1,62 @@
+#include "data/revocation_filter.h"
+
+RevocationFilter::RevocationFilter() {
+    for (auto& word : words_) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool RevocationFilter::may_contain(Domain domain, std::string_view key) const {
+    const uint64_t h = hash(domain, key);
+    const uint64_t step = (h >> 32) | 1;
+
+    for (int i = 0; i < kHashes; ++i) {
+        const uint64_t bit = (h + i * step) % kBits;
+        if ((words_[bit / 64].load(std::memory_order_acquire) & (uint64_t{1} << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RevocationFilter::add(Domain domain, std::string_view key) {
+    const uint64_t h = hash(domain, key);
+    const uint64_t step = (h >> 32) | 1;
+
+    for (int i = 0; i < kHashes; ++i) {
+        const uint64_t bit = (h + i * step) % kBits;
+        words_[bit / 64].fetch_or(uint64_t{1} << (bit % 64), std::memory_order_release);
+    }
+}
+
+void RevocationFilter::rebuild(const std::vector<std::pair<Domain, std::string_view>>& keys) {
+    std::vector<uint64_t> fresh(words_.size(), 0);
+    for (const auto& [domain, key] : keys) {
+        const uint64_t h = hash(domain, key);
+        const uint64_t step = (h >> 32) | 1;
+        for (int i = 0; i < kHashes; ++i) {
+            const uint64_t bit = (h + i * step) % kBits;
+            fresh[bit / 64] |= uint64_t{1} << (bit % 64);
+        }
+    }
+
+    for (size_t i = 0; i < words_.size(); ++i) {
+        words_[i].store(fresh[i], std::memory_order_release);
+    }
+}
+
+uint64_t RevocationFilter::hash(Domain domain, std::string_view key) {
+    // FNV-1a with the domain mixed in first, followed by a final avalanche
+    uint64_t h = 14695981039346656037ULL;
+    h ^= static_cast<uint8_t>(domain);
+    h *= 1099511628211ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,448 @@
+#include "data/search_index.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <mutex>
+#include <queue>
+
+namespace {
+
+constexpr size_t kMaxTokenBytes = 64;
+
+// BM25 parameters
+constexpr double kK1 = 1.2;
+constexpr double kB = 0.75;
+
+// Rough cost of a conversation-led step relative to decoding one posting
+constexpr size_t kScopeSeekCost = 4;
+
+// Decodes one code point; returns 0 bytes consumed for malformed input
+size_t decode_utf8(std::string_view text, size_t i, char32_t& cp) {
+    const auto byte = [&](size_t k) { return static_cast<unsigned char>(text[k]); };
+    const unsigned char lead = byte(i);
+    size_t length;
+    if (lead < 0x80) {
+        cp = lead;
+        return 1;
+    } else if ((lead & 0xE0) == 0xC0) {
+        cp = lead & 0x1F;
+        length = 2;
+    } else if ((lead & 0xF0) == 0xE0) {
+        cp = lead & 0x0F;
+        length = 3;
+    } else if ((lead & 0xF8) == 0xF0) {
+        cp = lead & 0x07;
+        length = 4;
+    } else {
+        return 0;
+    }
+
+    if (i + length > text.size()) {
+        return 0;
+    }
+    for (size_t k = 1; k < length; ++k) {
+        if ((byte(i + k) & 0xC0) != 0x80) {
+            return 0;
+        }
+        cp = (cp << 6) | (byte(i + k) & 0x3F);
+    }
+    return length;
+}
+
+void append_utf8(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+enum class CharKind { Separator, Word, Ideograph };
+
+CharKind classify(char32_t cp) {
+    if (cp < 0x80) {
+        return std::isalnum(static_cast<int>(cp)) ? CharKind::Word : CharKind::Separator;
+    }
+    if (cp < 0xC0 || cp == 0xD7 || cp == 0xF7) {
+        return CharKind::Separator;  // C1 controls, Latin-1 punctuation and symbols
+    }
+    if ((cp >= 0x2000 && cp <= 0x2BFF) || (cp >= 0x3000 && cp <= 0x303F) ||
+        (cp >= 0xFE00 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF0F) ||
+        (cp >= 0xFF1A && cp <= 0xFF20) || (cp >= 0xFF3B && cp <= 0xFF40) ||
+        (cp >= 0xFF5B && cp <= 0xFF65) || (cp >= 0x1F000 && cp <= 0x1FAFF)) {
+        return CharKind::Separator;  // Punctuation, symbols, variation selectors, emoji
+    }
+    if ((cp >= 0x3040 && cp <= 0x30FF) || (cp >= 0x3400 && cp <= 0x4DBF) ||
+        (cp >= 0x4E00 && cp <= 0x9FFF) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+        (cp >= 0x20000 && cp <= 0x2FFFF)) {
+        return CharKind::Ideograph;
+    }
+    return CharKind::Word;
+}
+
+char32_t fold_case(char32_t cp) {
+    if (cp < 0x80) {
+        return static_cast<char32_t>(std::tolower(static_cast<int>(cp)));
+    }
+    if (cp >= 0xFF10 && cp <= 0xFF5A) {
+        return fold_case(cp - 0xFEE0);  // Fullwidth digits and letters
+    }
+    if (cp >= 0xC0 && cp <= 0xDE) {
+        return cp + 0x20;
+    }
+    if ((cp >= 0x100 && cp <= 0x137) || (cp >= 0x14A && cp <= 0x177)) {
+        return cp | 1;
+    }
+    if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) {
+        return (cp & 1) ? cp + 1 : cp;
+    }
+    if (cp >= 0x391 && cp <= 0x3A9) {
+        return cp + 0x20;
+    }
+    if (cp == 0x3C2) {
+        return 0x3C3;  // Final sigma
+    }
+    if (cp >= 0x410 && cp <= 0x42F) {
+        return cp + 0x20;
+    }
+    if (cp >= 0x400 && cp <= 0x40F) {
+        return cp + 0x50;
+    }
+    return cp;
+}
+
+void write_varint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+} // namespace
+
+// Walks one posting list in document order
+class SearchIndex::Cursor {
+public:
+    // Matches add weight * (BM25 term saturation) to the score; filters weigh nothing
+    Cursor(const PostingList& list, double weight) : list_(&list), weight_(weight) {
+        enter_block(0);
+    }
+
+    DocId doc() const { return doc_; }
+    uint32_t frequency() const { return frequency_; }
+    uint32_t count() const { return list_->count; }
+    double weight() const { return weight_; }
+
+    bool next() {
+        if (pos_ == end_) {
+            if (block_ + 1 >= list_->skips.size()) {
+                return false;
+            }
+            enter_block(block_ + 1);
+        }
+        doc_ += read_varint();
+        frequency_ = read_varint();
+        positioned_ = true;
+        return true;
+    }
+
+    // Moves to the first posting at or after target; false once the list is exhausted
+    bool seek(DocId target) {
+        if (positioned_ && doc_ >= target) {
+            return true;
+        }
+
+        // Every document in a block is above its base, so start from the last block based below target
+        auto first = list_->skips.begin() + block_ + 1;
+        auto later = std::lower_bound(first, list_->skips.end(), target,
+            [](const Skip& skip, DocId value) { return skip.base < value; });
+        if (later != first) {
+            enter_block(static_cast<size_t>(later - list_->skips.begin()) - 1);
+        }
+
+        while (next()) {
+            if (doc_ >= target) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    void enter_block(size_t block) {
+        block_ = block;
+        pos_ = list_->skips[block].offset;
+        end_ = block + 1 < list_->skips.size() ? list_->skips[block + 1].offset : list_->bytes.size();
+        doc_ = list_->skips[block].base;
+        positioned_ = false;
+    }
+
+    uint32_t read_varint() {
+        uint32_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            const uint8_t byte = list_->bytes[pos_++];
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+    }
+
+    const PostingList* list_;
+    double weight_;
+    size_t block_ = 0;
+    size_t pos_ = 0;
+    size_t end_ = 0;
+    DocId doc_ = 0;
+    uint32_t frequency_ = 0;
+    bool positioned_ = false;
+};
+
+SearchIndex::DocId SearchIndex::add(const std::string& conversation_id, uint64_t sequence, std::string_view content) {
+    std::vector<std::string> tokens = tokenize(content);
+    std::sort(tokens.begin(), tokens.end());
+
+    std::unique_lock<std::shared_mutex> lock(index_mutex_);
+
+    auto [slot, inserted] = conversation_slots_.try_emplace(conversation_id,
+                                                            static_cast<uint32_t>(conversation_ids_.size()));
+    if (inserted) {
+        conversation_ids_.push_back(conversation_id);
+        conversation_postings_.emplace_back();
+    }
+
+    const DocId doc = static_cast<DocId>(documents_.size());
+    const uint16_t length = static_cast<uint16_t>(std::min<size_t>(tokens.size(), UINT16_MAX));
+    documents_.push_back({slot->second, length, true, sequence});
+    total_length_ += length;
+    ++live_documents_;
+
+    for (size_t i = 0; i < tokens.size();) {
+        size_t run = i + 1;
+        while (run < tokens.size() && tokens[run] == tokens[i]) {
+            ++run;
+        }
+        posting_bytes_ += append(postings_[tokens[i]], doc, static_cast<uint32_t>(run - i));
+        i = run;
+    }
+
+    posting_bytes_ += append(conversation_postings_[slot->second], doc, 1);
+    return doc;
+}
+
+void SearchIndex::remove(DocId doc) {
+    std::unique_lock<std::shared_mutex> lock(index_mutex_);
+
+    // Postings stay; the tombstone keeps the document out of results
+    if (doc < documents_.size() && documents_[doc].live) {
+        documents_[doc].live = false;
+        total_length_ -= documents_[doc].length;
+        --live_documents_;
+    }
+}
+
+SearchIndex::Result SearchIndex::search(const std::vector<std::string>& conversation_ids, std::string_view query,
+                                        size_t offset, size_t limit) const {
+    std::vector<std::string> terms = tokenize(query);
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    if (terms.size() > kMaxQueryTerms) {
+        terms.resize(kMaxQueryTerms);
+    }
+
+    Result result{{}, 0};
+    if (terms.empty() || limit == 0) {
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    ++searches_;
+
+    const double documents = static_cast<double>(live_documents_);
+    const double average_length = live_documents_ == 0 ? 1.0 : static_cast<double>(total_length_) / documents;
+
+    std::vector<Cursor> term_cursors;
+    uint32_t rarest = UINT32_MAX;
+    for (const auto& term : terms) {
+        auto it = postings_.find(term);
+        if (it == postings_.end()) {
+            return result;
+        }
+        const double df = it->second.count;
+        term_cursors.emplace_back(it->second, std::log(1.0 + std::max(0.0, documents - df + 0.5) / (df + 0.5)));
+        rarest = std::min(rarest, it->second.count);
+    }
+
+    std::vector<uint32_t> scope;
+    size_t scope_documents = 0;
+    for (const auto& conversation_id : conversation_ids) {
+        auto slot = conversation_slots_.find(conversation_id);
+        if (slot != conversation_slots_.end()) {
+            scope.push_back(slot->second);
+            scope_documents += conversation_postings_[slot->second].count;
+        }
+    }
+    if (scope.empty()) {
+        return result;
+    }
+
+    // Keeps the best offset + limit matches, the worst of them on top. Ties go to newer messages.
+    using Scored = std::pair<double, DocId>;
+    auto better = [](const Scored& a, const Scored& b) {
+        return a.first > b.first || (a.first == b.first && a.second > b.second);
+    };
+    std::priority_queue<Scored, std::vector<Scored>, decltype(better)> best(better);
+    const size_t keep = offset + limit;
+
+    // Leapfrog intersection led by the shortest list; in_scope is null when a conversation list takes part
+    auto intersect = [&](std::vector<Cursor> cursors, const std::vector<char>* in_scope) {
+        std::sort(cursors.begin(), cursors.end(), [](const Cursor& a, const Cursor& b) { return a.count() < b.count(); });
+
+        Cursor& lead = cursors.front();
+        bool more = lead.next();
+        while (more) {
+            const DocId candidate = lead.doc();
+
+            bool matched = true;
+            for (size_t i = 1; i < cursors.size() && matched; ++i) {
+                if (!cursors[i].seek(candidate)) {
+                    more = false;
+                    matched = false;
+                } else if (cursors[i].doc() != candidate) {
+                    more = lead.seek(cursors[i].doc());
+                    matched = false;
+                }
+            }
+            if (!matched) {
+                continue;
+            }
+
+            const Document& document = documents_[candidate];
+            if (document.live && (in_scope == nullptr || (*in_scope)[document.conversation])) {
+                ++result.total;
+
+                const double length_norm = kK1 * (1.0 - kB + kB * document.length / average_length);
+                double score = 0.0;
+                for (const auto& cursor : cursors) {
+                    const double tf = cursor.frequency();
+                    score += cursor.weight() * tf * (kK1 + 1.0) / (tf + length_norm);
+                }
+
+                const Scored scored{score, candidate};
+                if (best.size() < keep) {
+                    best.push(scored);
+                } else if (better(scored, best.top())) {
+                    best.pop();
+                    best.push(scored);
+                }
+            }
+            more = lead.next();
+        }
+    };
+
+    // Each step of a per-conversation walk seeks every term list, so it only wins when the user's history
+    // is clearly shorter than the rarest term's list; then the cost no longer grows with the index
+    if (scope_documents * kScopeSeekCost < rarest) {
+        for (uint32_t slot : scope) {
+            std::vector<Cursor> cursors = term_cursors;
+            cursors.emplace_back(conversation_postings_[slot], 0.0);
+            intersect(std::move(cursors), nullptr);
+        }
+    } else {
+        std::vector<char> in_scope(conversation_ids_.size(), 0);
+        for (uint32_t slot : scope) {
+            in_scope[slot] = 1;
+        }
+        intersect(std::move(term_cursors), &in_scope);
+    }
+
+    std::vector<Scored> ranked;
+    ranked.reserve(best.size());
+    while (!best.empty()) {
+        ranked.push_back(best.top());
+        best.pop();
+    }
+    std::reverse(ranked.begin(), ranked.end());
+
+    for (size_t i = offset; i < ranked.size(); ++i) {
+        const Document& document = documents_[ranked[i].second];
+        result.hits.push_back({conversation_ids_[document.conversation], document.sequence, ranked[i].first});
+    }
+    return result;
+}
+
+size_t SearchIndex::append(PostingList& list, DocId doc, uint32_t frequency) {
+    const size_t bytes_before = list.bytes.size();
+    if (list.count % kBlockSize == 0) {
+        list.skips.push_back({list.last_doc, static_cast<uint32_t>(list.bytes.size())});
+    }
+    write_varint(list.bytes, doc - list.last_doc);
+    write_varint(list.bytes, frequency);
+    list.last_doc = doc;
+    ++list.count;
+    return list.bytes.size() - bytes_before;
+}
+
+std::vector<std::string> SearchIndex::tokenize(std::string_view text) {
+    std::vector<std::string> tokens;
+    std::string current;
+
+    auto flush = [&]() {
+        if (!current.empty()) {
+            tokens.push_back(std::move(current));
+            current.clear();
+        }
+    };
+
+    for (size_t i = 0; i < text.size();) {
+        char32_t cp = 0;
+        const size_t length = decode_utf8(text, i, cp);
+        if (length == 0) {
+            flush();
+            ++i;
+            continue;
+        }
+        i += length;
+
+        switch (classify(cp)) {
+        case CharKind::Separator:
+            flush();
+            break;
+        case CharKind::Ideograph:
+            flush();
+            append_utf8(current, cp);
+            flush();
+            break;
+        case CharKind::Word:
+            // Overlong words are cut, not split, so a query for the same word still matches
+            if (current.size() < kMaxTokenBytes) {
+                append_utf8(current, fold_case(cp));
+            }
+            break;
+        }
+    }
+    flush();
+    return tokens;
+}
+
+json SearchIndex::get_stats() const {
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    return {
+        {"documents", documents_.size()},
+        {"live_documents", live_documents_},
+        {"terms", postings_.size()},
+        {"posting_bytes", posting_bytes_},
+        {"searches", searches_.load()}
+    };
+}
@@ -0,0 +1,348 @@
+#include "data/session_store.h"
+#include "common/sha256.h"
+#include "common/logger.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <ctime>
+#include <random>
+
+namespace {
+
+int64_t now_seconds() {
+    return std::time(nullptr);
+}
+
+int64_t now_milliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string random_hex(size_t bytes) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    thread_local std::random_device rd;
+
+    std::string out;
+    out.reserve(bytes * 2);
+    for (size_t i = 0; i < bytes; ++i) {
+        const auto byte = static_cast<uint8_t>(rd());
+        out += kHex[byte >> 4];
+        out += kHex[byte & 0x0f];
+    }
+    return out;
+}
+
+} // namespace
+
+SessionStore::SessionStore(int worker_index, int64_t revocation_ttl_seconds)
+    : worker_index_(worker_index), revocation_ttl_seconds_(revocation_ttl_seconds),
+      wheel_(kWheelSlots), wheel_time_(now_seconds()), reuse_detections_(0) {
+}
+
+SessionStore::IssuedSession SessionStore::create_session(const std::string& username) {
+    const int64_t now = now_seconds();
+    const std::string secret = random_hex(24);
+
+    Session session;
+    session.id = generate_session_id(now_milliseconds());
+    session.username = username;
+    session.created_at_ms = created_at_of(session.id);
+    session.last_used_at = now;
+    session.expires_at = now + kSessionTtlSeconds;
+    session.refresh_hash = hash_secret(secret);
+
+    IssuedSession issued{session.id, session.id + "." + secret};
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    advance_wheel(now);
+
+    schedule(EntryKind::Session, session.id, session.expires_at);
+    user_sessions_[username].push_back(session.id);
+    sessions_.emplace(session.id, std::move(session));
+
+    return issued;
+}
+
+SessionStore::RefreshResult SessionStore::rotate(const std::string& refresh_token) {
+    RefreshResult result{RefreshStatus::Invalid, "", "", ""};
+
+    const size_t separator = refresh_token.find('.');
+    if (separator == std::string::npos) {
+        return result;
+    }
+    const std::string session_id = refresh_token.substr(0, separator);
+    const std::string presented_hash = hash_secret(refresh_token.substr(separator + 1));
+    const int64_t now = now_seconds();
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    advance_wheel(now);
+
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end()) {
+        return result;
+    }
+
+    Session& session = it->second;
+    result.username = session.username;
+    result.session_id = session.id;
+
+    if (session.expires_at <= now) {
+        remove_session(session_id);
+        result.status = RefreshStatus::Expired;
+        return result;
+    }
+
+    if (presented_hash == session.previous_refresh_hash) {
+        // An old refresh token came back: someone else holds a copy, so end the whole session
+        ++reuse_detections_;
+        LOG_WARNING("Refresh token reuse detected for " + session.username + ", revoking session " + session_id);
+        remove_session(session_id);
+        revoked_sessions_[session_id] = now + revocation_ttl_seconds_;
+        filter_.add(RevocationFilter::Domain::Session, session_id);
+        schedule(EntryKind::RevokedSession, session_id, now + revocation_ttl_seconds_);
+        result.status = RefreshStatus::Reused;
+        return result;
+    }
+
+    if (presented_hash != session.refresh_hash) {
+        return result;
+    }
+
+    const std::string secret = random_hex(24);
+    session.previous_refresh_hash = session.refresh_hash;
+    session.refresh_hash = hash_secret(secret);
+    session.last_used_at = now;
+
+    result.status = RefreshStatus::Ok;
+    result.refresh_token = session_id + "." + secret;
+    return result;
+}
+
+bool SessionStore::revoke_session(const std::string& session_id) {
+    const int64_t now = now_seconds();
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    advance_wheel(now);
+
+    const bool held_here = sessions_.count(session_id) > 0;
+    remove_session(session_id);
+
+    revoked_sessions_[session_id] = now + revocation_ttl_seconds_;
+    filter_.add(RevocationFilter::Domain::Session, session_id);
+    schedule(EntryKind::RevokedSession, session_id, now + revocation_ttl_seconds_);
+
+    return held_here;
+}
+
+size_t SessionStore::revoke_all(const std::string& username) {
+    const int64_t now = now_seconds();
+    const int64_t cutoff_ms = now_milliseconds();
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    advance_wheel(now);
+
+    size_t removed = 0;
+    auto user_it = user_sessions_.find(username);
+    if (user_it != user_sessions_.end()) {
+        const auto session_ids = user_it->second;
+        for (const auto& session_id : session_ids) {
+            remove_session(session_id);
+            ++removed;
+        }
+    }
+
+    // Sessions created elsewhere are unknown here; the cutoff covers them by creation time
+    user_cutoffs_[username] = cutoff_ms;
+    filter_.add(RevocationFilter::Domain::User, username);
+    schedule(EntryKind::UserCutoff, username, now + revocation_ttl_seconds_);
+
+    return removed;
+}
+
+std::vector<SessionStore::Session> SessionStore::get_sessions(const std::string& username) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    std::vector<Session> result;
+    auto user_it = user_sessions_.find(username);
+    if (user_it == user_sessions_.end()) {
+        return result;
+    }
+
+    for (const auto& session_id : user_it->second) {
+        auto it = sessions_.find(session_id);
+        if (it != sessions_.end()) {
+            result.push_back(it->second);
+        }
+    }
+    return result;
+}
+
+bool SessionStore::is_revoked(const std::string& session_id, const std::string& username) const {
+    revocation_checks_.fetch_add(1, std::memory_order_relaxed);
+
+    const bool session_maybe = filter_.may_contain(RevocationFilter::Domain::Session, session_id);
+    const bool user_maybe = filter_.may_contain(RevocationFilter::Domain::User, username);
+    if (!session_maybe && !user_maybe) {
+        return false;
+    }
+
+    filter_maybes_.fetch_add(1, std::memory_order_relaxed);
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    bool revoked = session_maybe && revoked_sessions_.count(session_id) > 0;
+
+    if (!revoked && user_maybe) {
+        auto cutoff = user_cutoffs_.find(username);
+        revoked = cutoff != user_cutoffs_.end() && created_at_of(session_id) <= cutoff->second;
+    }
+
+    if (revoked) {
+        confirmed_revocations_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return revoked;
+}
+
+int SessionStore::worker_of(const std::string& session_id) {
+    if (session_id.size() < 2 || session_id[0] != 'w') {
+        return -1;
+    }
+
+    int worker = -1;
+    const char* begin = session_id.data() + 1;
+    const char* end = session_id.data() + session_id.size();
+    auto [ptr, ec] = std::from_chars(begin, end, worker);
+    if (ec != std::errc() || ptr == end || *ptr != '-') {
+        return -1;
+    }
+    return worker;
+}
+
+json SessionStore::get_stats() {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    return {
+        {"sessions", sessions_.size()},
+        {"users", user_sessions_.size()},
+        {"revoked_sessions", revoked_sessions_.size()},
+        {"user_cutoffs", user_cutoffs_.size()},
+        {"revocation_checks", revocation_checks_.load(std::memory_order_relaxed)},
+        {"filter_maybes", filter_maybes_.load(std::memory_order_relaxed)},
+        {"confirmed_revocations", confirmed_revocations_.load(std::memory_order_relaxed)},
+        {"refresh_reuse_detections", reuse_detections_}
+    };
+}
+
+std::string SessionStore::generate_session_id(int64_t now_ms) {
+    return "w" + std::to_string(worker_index_) + "-" + std::to_string(now_ms) + "-" + random_hex(8);
+}
+
+void SessionStore::schedule(EntryKind kind, const std::string& key, int64_t expires_at) {
+    wheel_[static_cast<size_t>(expires_at) % kWheelSlots].push_back({kind, key, expires_at});
+}
+
+void SessionStore::advance_wheel(int64_t now) {
+    // Caller holds the unique lock. Each slot is visited once per revolution; entries due
+    // further out than one revolution simply stay put until their turn comes round.
+    if (now <= wheel_time_) {
+        return;
+    }
+
+    const int64_t first_tick = std::max(wheel_time_ + 1, now - static_cast<int64_t>(kWheelSlots) + 1);
+    bool revocations_expired = false;
+
+    for (int64_t tick = first_tick; tick <= now; ++tick) {
+        auto& slot = wheel_[static_cast<size_t>(tick) % kWheelSlots];
+
+        auto due_end = std::partition(slot.begin(), slot.end(), [now](const WheelEntry& entry) {
+            return entry.expires_at > now;
+        });
+
+        for (auto entry = due_end; entry != slot.end(); ++entry) {
+            switch (entry->kind) {
+            case EntryKind::Session: {
+                auto session = sessions_.find(entry->key);
+                if (session != sessions_.end() && session->second.expires_at <= now) {
+                    remove_session(entry->key);
+                }
+                break;
+            }
+            case EntryKind::RevokedSession: {
+                auto revoked = revoked_sessions_.find(entry->key);
+                if (revoked != revoked_sessions_.end() && revoked->second <= now) {
+                    revoked_sessions_.erase(revoked);
+                    revocations_expired = true;
+                }
+                break;
+            }
+            case EntryKind::UserCutoff: {
+                // A later log-out-everywhere schedules its own entry; only drop the cutoff once
+                // the newest one has had its full TTL
+                auto cutoff = user_cutoffs_.find(entry->key);
+                if (cutoff != user_cutoffs_.end() &&
+                    cutoff->second / 1000 + revocation_ttl_seconds_ <= now) {
+                    user_cutoffs_.erase(cutoff);
+                    revocations_expired = true;
+                }
+                break;
+            }
+            }
+        }
+
+        slot.erase(due_end, slot.end());
+    }
+
+    wheel_time_ = now;
+
+    if (revocations_expired) {
+        rebuild_filter();
+    }
+}
+
+void SessionStore::remove_session(const std::string& session_id) {
+    auto it = sessions_.find(session_id);
+    if (it == sessions_.end()) {
+        return;
+    }
+
+    auto user_it = user_sessions_.find(it->second.username);
+    if (user_it != user_sessions_.end()) {
+        auto& ids = user_it->second;
+        ids.erase(std::remove(ids.begin(), ids.end(), session_id), ids.end());
+        if (ids.empty()) {
+            user_sessions_.erase(user_it);
+        }
+    }
+
+    sessions_.erase(it);
+}
+
+void SessionStore::rebuild_filter() {
+    std::vector<std::pair<RevocationFilter::Domain, std::string_view>> keys;
+    keys.reserve(revoked_sessions_.size() + user_cutoffs_.size());
+
+    for (const auto& [session_id, expires_at] : revoked_sessions_) {
+        keys.emplace_back(RevocationFilter::Domain::Session, session_id);
+    }
+    for (const auto& [username, cutoff] : user_cutoffs_) {
+        keys.emplace_back(RevocationFilter::Domain::User, username);
+    }
+
+    filter_.rebuild(keys);
+}
+
+int64_t SessionStore::created_at_of(const std::string& session_id) {
+    const size_t first = session_id.find('-');
+    if (first == std::string::npos) {
+        return 0;
+    }
+
+    int64_t created_at_ms = 0;
+    const char* begin = session_id.data() + first + 1;
+    std::from_chars(begin, session_id.data() + session_id.size(), created_at_ms);
+    return created_at_ms;
+}
+
+std::string SessionStore::hash_secret(const std::string& secret) {
+    const auto digest = Sha256::hash(secret);
+    return std::string(reinterpret_cast<const char*>(digest.data()), digest.size());
+}
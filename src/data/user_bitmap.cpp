@@ -0,0 +1,177 @@
+#include "data/user_bitmap.h"
+#include <algorithm>
+#include <iterator>
+
+bool UserBitmap::add(Id id) {
+    const uint16_t key = static_cast<uint16_t>(id >> 16);
+    const uint16_t low = static_cast<uint16_t>(id);
+
+    auto chunk = find_chunk(key);
+    if (chunk == chunks_.end() || chunk->key != key) {
+        chunk = chunks_.insert(chunk, Chunk{key, 0, {}, {}});
+    }
+
+    if (chunk->dense()) {
+        uint64_t& word = chunk->words[low >> 6];
+        const uint64_t bit = uint64_t{1} << (low & 63);
+        if (word & bit) {
+            return false;
+        }
+        word |= bit;
+    } else {
+        auto position = std::lower_bound(chunk->array.begin(), chunk->array.end(), low);
+        if (position != chunk->array.end() && *position == low) {
+            return false;
+        }
+        chunk->array.insert(position, low);
+        if (chunk->array.size() > kArrayLimit) {
+            to_dense(*chunk);
+        }
+    }
+
+    ++chunk->cardinality;
+    ++cardinality_;
+    return true;
+}
+
+bool UserBitmap::remove(Id id) {
+    const uint16_t key = static_cast<uint16_t>(id >> 16);
+    const uint16_t low = static_cast<uint16_t>(id);
+
+    auto chunk = find_chunk(key);
+    if (chunk == chunks_.end() || chunk->key != key) {
+        return false;
+    }
+
+    if (chunk->dense()) {
+        uint64_t& word = chunk->words[low >> 6];
+        const uint64_t bit = uint64_t{1} << (low & 63);
+        if (!(word & bit)) {
+            return false;
+        }
+        word &= ~bit;
+    } else {
+        auto position = std::lower_bound(chunk->array.begin(), chunk->array.end(), low);
+        if (position == chunk->array.end() || *position != low) {
+            return false;
+        }
+        chunk->array.erase(position);
+    }
+
+    --cardinality_;
+    if (--chunk->cardinality == 0) {
+        chunks_.erase(chunk);
+    } else if (chunk->dense() && chunk->cardinality <= kArrayLimit / 2) {
+        // Well below the limit, so a set hovering around it doesn't convert back and forth
+        to_sparse(*chunk);
+    }
+    return true;
+}
+
+bool UserBitmap::contains(Id id) const {
+    const uint16_t key = static_cast<uint16_t>(id >> 16);
+    const uint16_t low = static_cast<uint16_t>(id);
+
+    auto chunk = find_chunk(key);
+    if (chunk == chunks_.end() || chunk->key != key) {
+        return false;
+    }
+    if (chunk->dense()) {
+        return (chunk->words[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(chunk->array.begin(), chunk->array.end(), low);
+}
+
+size_t UserBitmap::memory_bytes() const {
+    size_t bytes = chunks_.capacity() * sizeof(Chunk);
+    for (const auto& chunk : chunks_) {
+        bytes += chunk.array.capacity() * sizeof(uint16_t) + chunk.words.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+UserBitmap UserBitmap::intersect(const UserBitmap& a, const UserBitmap& b) {
+    UserBitmap result;
+    auto left = a.chunks_.begin();
+    auto right = b.chunks_.begin();
+
+    // Chunks are sorted by key, so only chunks with matching keys meet
+    while (left != a.chunks_.end() && right != b.chunks_.end()) {
+        if (left->key < right->key) {
+            ++left;
+        } else if (right->key < left->key) {
+            ++right;
+        } else {
+            Chunk out{left->key, 0, {}, {}};
+            if (intersect_chunks(*left, *right, out)) {
+                result.cardinality_ += out.cardinality;
+                result.chunks_.push_back(std::move(out));
+            }
+            ++left;
+            ++right;
+        }
+    }
+    return result;
+}
+
+bool UserBitmap::intersect_chunks(const Chunk& a, const Chunk& b, Chunk& out) {
+    if (a.dense() && b.dense()) {
+        out.words.resize(kChunkWords);
+        size_t cardinality = 0;
+        for (size_t word = 0; word < kChunkWords; ++word) {
+            out.words[word] = a.words[word] & b.words[word];
+            cardinality += __builtin_popcountll(out.words[word]);
+        }
+        out.cardinality = static_cast<uint32_t>(cardinality);
+        if (cardinality <= kArrayLimit) {
+            to_sparse(out);
+        }
+    } else if (a.dense() || b.dense()) {
+        // Test each of the sparse side's ids against the dense side's bits
+        const Chunk& sparse = a.dense() ? b : a;
+        const Chunk& dense = a.dense() ? a : b;
+        for (uint16_t low : sparse.array) {
+            if ((dense.words[low >> 6] >> (low & 63)) & 1) {
+                out.array.push_back(low);
+            }
+        }
+        out.cardinality = static_cast<uint32_t>(out.array.size());
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(out.array));
+        out.cardinality = static_cast<uint32_t>(out.array.size());
+    }
+    return out.cardinality > 0;
+}
+
+std::vector<UserBitmap::Chunk>::iterator UserBitmap::find_chunk(uint16_t key) {
+    return std::lower_bound(chunks_.begin(), chunks_.end(), key,
+        [](const Chunk& chunk, uint16_t value) { return chunk.key < value; });
+}
+
+std::vector<UserBitmap::Chunk>::const_iterator UserBitmap::find_chunk(uint16_t key) const {
+    return std::lower_bound(chunks_.begin(), chunks_.end(), key,
+        [](const Chunk& chunk, uint16_t value) { return chunk.key < value; });
+}
+
+void UserBitmap::to_dense(Chunk& chunk) {
+    chunk.words.assign(kChunkWords, 0);
+    for (uint16_t low : chunk.array) {
+        chunk.words[low >> 6] |= uint64_t{1} << (low & 63);
+    }
+    chunk.array.clear();
+    chunk.array.shrink_to_fit();
+}
+
+void UserBitmap::to_sparse(Chunk& chunk) {
+    std::vector<uint16_t> array;
+    array.reserve(chunk.cardinality);
+    for (size_t word = 0; word < kChunkWords; ++word) {
+        for (uint64_t bits = chunk.words[word]; bits != 0; bits &= bits - 1) {
+            array.push_back(static_cast<uint16_t>(word * 64 + __builtin_ctzll(bits)));
+        }
+    }
+    chunk.array = std::move(array);
+    chunk.words.clear();
+    chunk.words.shrink_to_fit();
+}
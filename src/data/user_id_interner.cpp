@@ -0,0 +1,52 @@
+#include "data/user_id_interner.h"
+
+#include <mutex>
+
+UserIdInterner::Id UserIdInterner::intern(const std::string& username) {
+    {
+        std::shared_lock<std::shared_mutex> lock(interner_mutex_);
+        auto it = ids_.find(username);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(interner_mutex_);
+    auto [it, inserted] = ids_.try_emplace(username, static_cast<Id>(names_.size()));
+    if (inserted) {
+        names_.push_back(username);
+    }
+    return it->second;
+}
+
+std::optional<UserIdInterner::Id> UserIdInterner::find(const std::string& username) const {
+    std::shared_lock<std::shared_mutex> lock(interner_mutex_);
+    auto it = ids_.find(username);
+    if (it == ids_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::string UserIdInterner::name(Id id) const {
+    std::shared_lock<std::shared_mutex> lock(interner_mutex_);
+    return id < names_.size() ? names_[id] : std::string();
+}
+
+std::vector<std::string> UserIdInterner::names(const std::vector<Id>& ids) const {
+    std::shared_lock<std::shared_mutex> lock(interner_mutex_);
+
+    std::vector<std::string> result;
+    result.reserve(ids.size());
+    for (Id id : ids) {
+        if (id < names_.size()) {
+            result.push_back(names_[id]);
+        }
+    }
+    return result;
+}
+
+size_t UserIdInterner::size() const {
+    std::shared_lock<std::shared_mutex> lock(interner_mutex_);
+    return names_.size();
+}
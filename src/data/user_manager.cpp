@@ -2,7 +2,9 @@
 #include "common/logger.h"
 #include <algorithm>
 
-UserManager::UserManager() {
+UserManager::UserManager(std::shared_ptr<ConnectionManager> connection_manager,
+                         std::shared_ptr<ChangeLog> change_log)
+    : connection_manager_(std::move(connection_manager)), change_log_(std::move(change_log)) {
     create_sample_users();
 }
 
@@ -19,6 +21,10 @@ bool UserManager::add_user(const User& user) {
     }
 
     users_[user.username] = user;
+    version_.fetch_add(1, std::memory_order_release);
+    if (change_log_) {
+        change_log_->append_shared("profile", {{"username", user.username}, {"full_name", user.full_name}});
+    }
     LOG_INFO("User added: " + user.username);
     return true;
 }
@@ -37,26 +43,53 @@ bool UserManager::update_user(const std::string& username, const json& updates)
     if (updates.contains("email")) {
         it->second.email = updates["email"];
     }
+    version_.fetch_add(1, std::memory_order_release);
+    // Same fields as the user listing; email stays private to the profile endpoint
+    if (change_log_) {
+        change_log_->append_shared("profile", {{"username", username}, {"full_name", it->second.full_name}});
+    }
 
     LOG_INFO("User updated: " + username);
     return true;
 }
 
 bool UserManager::set_online_status(const std::string& username, bool is_online) {
-    std::lock_guard<std::mutex> lock(users_mutex_);
-
-    auto it = users_.find(username);
-    if (it == users_.end()) {
+    if (!user_exists(username)) {
         return false;
     }
 
-    it->second.is_online = is_online;
-    it->second.last_seen = std::time(nullptr);
+    // Presence lives in ConnectionManager. A manual "online" holds one connection of its own,
+    // and going offline drops only that one: the user's real sessions are left alone.
+    std::optional<uint64_t> previous;
+    {
+        std::lock_guard<std::mutex> lock(status_mutex_);
+        auto it = status_connections_.find(username);
+        if (it != status_connections_.end()) {
+            previous = it->second;
+            status_connections_.erase(it);
+        }
+        // Replaced rather than kept: idle cleanup may already have closed the old one.
+        // Added before the old one goes, so the user never briefly drops offline.
+        if (is_online) {
+            status_connections_[username] = connection_manager_->add_connection(username);
+        }
+    }
+    if (previous) {
+        connection_manager_->remove_connection(*previous);
+    }
 
-    LOG_INFO("User status updated: " + username + " -> " + (is_online ? "online" : "offline"));
+    LOG_DEBUG("User status updated: " + username + " -> " + (is_online ? "online" : "offline"));
     return true;
 }
 
+bool UserManager::is_online(const std::string& username) {
+    return connection_manager_->is_user_online(username);
+}
+
+std::time_t UserManager::get_last_seen(const User& user) {
+    return connection_manager_->get_last_seen(user.username).value_or(user.last_seen);
+}
+
 std::optional<User> UserManager::get_user(const std::string& username) {
     std::lock_guard<std::mutex> lock(users_mutex_);
 
@@ -68,6 +101,23 @@ std::optional<User> UserManager::get_user(const std::string& username) {
     return it->second;
 }
 
+std::vector<std::optional<User>> UserManager::get_users(const std::vector<std::string>& usernames) {
+    std::lock_guard<std::mutex> lock(users_mutex_);
+
+    std::vector<std::optional<User>> result;
+    result.reserve(usernames.size());
+    for (const auto& username : usernames) {
+        auto it = users_.find(username);
+        if (it == users_.end()) {
+            result.emplace_back(std::nullopt);
+        } else {
+            result.emplace_back(it->second);
+        }
+    }
+
+    return result;
+}
+
 std::vector<User> UserManager::get_all_users(const std::string& exclude_username) {
     std::lock_guard<std::mutex> lock(users_mutex_);
 
@@ -105,15 +155,15 @@ std::vector<User> UserManager::search_users(const std::string& query, const std:
     return result;
 }
 
-json UserManager::user_to_json(const User& user) {
-    return {
-        {"username", user.username},
-        {"email", user.email},
-        {"full_name", user.full_name},
-        {"is_online", user.is_online},
-        {"last_seen", user.last_seen},
-        {"created_at", user.created_at}
-    };
+ArenaJson UserManager::user_to_json(const User& user) {
+    ArenaJson user_json(ArenaJson::value_t::object);
+    user_json["username"] = user.username;
+    user_json["email"] = user.email;
+    user_json["full_name"] = user.full_name;
+    user_json["is_online"] = is_online(user.username);
+    user_json["last_seen"] = get_last_seen(user);
+    user_json["created_at"] = user.created_at;
+    return user_json;
 }
 
 void UserManager::create_sample_users() {
@@ -121,17 +171,17 @@ void UserManager::create_sample_users() {
 
     users_["alice"] = {
         "alice", "alice@example.com", "Alice Johnson",
-        true, now, now - 86400
+        now, now - 86400
     };
 
     users_["bob"] = {
         "bob", "bob@example.com", "Bob Smith",
-        false, now - 3600, now - 172800
+        now - 3600, now - 172800
     };
 
     users_["charlie"] = {
         "charlie", "charlie@example.com", "Charlie Brown",
-        true, now, now - 259200
+        now, now - 259200
     };
 
     LOG_INFO("Sample users created: alice, bob, charlie");
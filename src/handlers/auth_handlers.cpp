@@ -1,64 +1,136 @@
 #include "handlers/auth_handlers.h"
 #include "common/auth_middleware.h"
-#include "common/request_validator.h"
+#include "common/request_schema.h"
 #include "common/logger.h"
 
+namespace {
+
+// Upper bound on what gets fed to the password hash
+constexpr size_t kMaxPasswordLength = 1024;
+
+struct LoginRequest {
+    std::string username;
+    std::string password;
+};
+
+struct RegisterRequest {
+    std::string username;
+    std::string password;
+    std::string email;
+};
+
+struct RefreshRequest {
+    std::string refresh_token;
+};
+
+const RequestSchema<LoginRequest>& login_schema() {
+    static const auto schema = RequestSchema<LoginRequest>()
+        .string("username", &LoginRequest::username, StringRule::length(1, 50))
+        .string("password", &LoginRequest::password, StringRule::length(1, kMaxPasswordLength));
+    return schema;
+}
+
+const RequestSchema<RegisterRequest>& register_schema() {
+    static const auto schema = RequestSchema<RegisterRequest>()
+        .string("username", &RegisterRequest::username,
+                StringRule::length(3, 50)
+                    .with_chars(CharClass::username())
+                    .with_message("Username must be 3-50 characters and contain only letters, numbers, and underscores"))
+        .string("password", &RegisterRequest::password,
+                StringRule::length(4, kMaxPasswordLength).with_message("Password must be 4-1024 characters"))
+        .string("email", &RegisterRequest::email,
+                StringRule::length(3, 254).as_email().with_message("Invalid email format"));
+    return schema;
+}
+
+const RequestSchema<RefreshRequest>& refresh_schema() {
+    static const auto schema = RequestSchema<RefreshRequest>()
+        .string("refresh_token", &RefreshRequest::refresh_token, StringRule::length(1, 256));
+    return schema;
+}
+
+} // namespace
+
+AuthHandlers::AuthHandlers(std::shared_ptr<SessionStore> session_store,
+                           std::shared_ptr<CredentialStore> credential_store,
+                           std::shared_ptr<PasswordHasher> password_hasher,
+                           std::shared_ptr<UserManager> user_manager)
+    : session_store_(session_store), credential_store_(credential_store), password_hasher_(password_hasher),
+      user_manager_(user_manager) {
+}
+
 void AuthHandlers::handle_login(const httplib::Request& req, httplib::Response& res) {
-    auto validation = RequestValidator::validate_json_body(req, {"username", "password"});
-    if (!validation.is_valid) {
-        send_error_response(res, 400, validation.error_message);
+    LoginRequest request;
+    if (auto error = login_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
         return;
     }
 
-    const std::string username = validation.data["username"];
-    const std::string password = validation.data["password"];
+    const std::string& username = request.username;
+    const std::string& password = request.password;
 
     LOG_INFO("Login attempt for user: " + username);
 
-    if (validate_credentials(username, password)) {
-        const std::string token = AuthMiddleware::generate_jwt_token(username);
-        const json response = create_user_response(username, token);
-        send_json_response(res, 200, response);
-        LOG_INFO("Login successful for user: " + username);
-    } else {
+    // Unknown users are checked against a dummy hash so the response time doesn't reveal them.
+    // Blocks this thread until the hash is done; see kPasswordHashTimeout.
+    const auto stored_hash = credential_store_->get_hash(username);
+    auto pending = password_hasher_->verify_async(password, stored_hash.value_or(credential_store_->get_dummy_hash()));
+    if (!pending || pending->wait_for(kPasswordHashTimeout) != std::future_status::ready) {
+        send_hasher_busy(res);
+        return;
+    }
+
+    const auto result = pending->get();
+    if (!stored_hash.has_value() || !result.matches) {
         send_error_response(res, 401, "Invalid credentials");
         LOG_WARNING("Login failed for user: " + username);
+        return;
+    }
+
+    if (result.rehashed.has_value()) {
+        credential_store_->update_hash(username, result.rehashed.value());
+        LOG_INFO("Password hash upgraded for user: " + username);
     }
+
+    const json response = create_session_response(username);
+    send_json_response(res, 200, response);
+    LOG_INFO("Login successful for user: " + username);
 }
 
 void AuthHandlers::handle_register(const httplib::Request& req, httplib::Response& res) {
-    auto validation = RequestValidator::validate_json_body(req, {"username", "password", "email"});
-    if (!validation.is_valid) {
-        send_error_response(res, 400, validation.error_message);
+    // Username, email and password rules are all part of the schema
+    RegisterRequest request;
+    if (auto error = register_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
         return;
     }
 
-    const std::string username = validation.data["username"];
-    const std::string password = validation.data["password"];
-    const std::string email = validation.data["email"];
+    const std::string& username = request.username;
+    const std::string& password = request.password;
+    const std::string& email = request.email;
 
     LOG_INFO("Registration attempt for user: " + username);
 
-    // Validate username
-    if (!RequestValidator::is_valid_username(username)) {
-        send_error_response(res, 400, "Username must be 3-50 characters and contain only letters, numbers, and underscores");
+    if (credential_store_->exists(username)) {
+        send_error_response(res, 409, "Username already taken");
         return;
     }
 
-    // Validate email
-    if (!RequestValidator::is_valid_email(email)) {
-        send_error_response(res, 400, "Invalid email format");
+    auto pending = password_hasher_->hash_async(password);
+    if (!pending || pending->wait_for(kPasswordHashTimeout) != std::future_status::ready) {
+        send_hasher_busy(res);
         return;
     }
 
-    // Validate password
-    if (password.length() < 4) {
-        send_error_response(res, 400, "Password must be at least 4 characters");
+    if (!credential_store_->add(username, pending->get())) {
+        send_error_response(res, 409, "Username already taken");
         return;
     }
+    // Credentials and profiles are partitioned by the same key, so the profile lands on its owner
+    const std::time_t now = std::time(nullptr);
+    user_manager_->add_user({username, email, "", now, now});
 
-    const std::string token = AuthMiddleware::generate_jwt_token(username);
-    json response = create_user_response(username, token);
+    json response = create_session_response(username);
     response["email"] = email;
     response["created"] = true;
 
@@ -84,45 +156,115 @@ void AuthHandlers::handle_verify_token(const httplib::Request& req, httplib::Res
 }
 
 void AuthHandlers::handle_refresh_token(const httplib::Request& req, httplib::Response& res) {
-    auto validation = RequestValidator::validate_json_body(req, {"refresh_token"});
-    if (!validation.is_valid) {
-        send_error_response(res, 400, validation.error_message);
+    RefreshRequest request;
+    if (auto error = refresh_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
         return;
     }
 
-    // In real app, verify refresh token
-    std::string username = "user"; // Extract from refresh token
-    std::string new_token = AuthMiddleware::generate_jwt_token(username);
+    const auto result = session_store_->rotate(request.refresh_token);
+
+    switch (result.status) {
+    case SessionStore::RefreshStatus::Ok:
+        break;
+    case SessionStore::RefreshStatus::Reused:
+        send_error_response(res, 401, "Refresh token was already used; the session has been revoked");
+        return;
+    case SessionStore::RefreshStatus::Expired:
+        send_error_response(res, 401, "Session expired");
+        return;
+    case SessionStore::RefreshStatus::Invalid:
+        send_error_response(res, 401, "Invalid refresh token");
+        return;
+    }
 
     json response = {
-        {"access_token", new_token},
+        {"access_token", AuthMiddleware::generate_jwt_token(result.username, result.session_id)},
+        {"refresh_token", result.refresh_token},
+        {"session_id", result.session_id},
         {"token_type", "Bearer"},
-        {"expires_in", 3600}
+        {"expires_in", AuthMiddleware::kAccessTokenTtlSeconds}
     };
 
     send_json_response(res, 200, response);
-    LOG_INFO("Token refresh successful");
+    LOG_INFO("Token refresh successful for user: " + result.username);
 }
 
 void AuthHandlers::handle_logout(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    session_store_->revoke_session(auth_result.session_id);
+
     json response = {
-        {"message", "Logout successful"}
+        {"message", "Logout successful"},
+        {"session_id", auth_result.session_id}
     };
     send_json_response(res, 200, response);
-    LOG_INFO("User logout");
+    LOG_INFO("User logout: " + auth_result.username);
 }
 
-bool AuthHandlers::validate_credentials(const std::string& username, const std::string& password) {
-    // Simple validation for demo (in real app, check against database)
-    return !username.empty() && !password.empty() && password.length() >= 4;
+void AuthHandlers::handle_logout_all(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    const size_t revoked = session_store_->revoke_all(auth_result.username);
+
+    json response = {
+        {"message", "Logged out of all sessions"},
+        {"sessions_revoked", revoked}
+    };
+    send_json_response(res, 200, response);
+    LOG_INFO("User logout from all sessions: " + auth_result.username);
 }
 
-json AuthHandlers::create_user_response(const std::string& username, const std::string& token) {
+void AuthHandlers::handle_get_sessions(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    json sessions = json::array();
+    for (const auto& session : session_store_->get_sessions(auth_result.username)) {
+        sessions.push_back({
+            {"session_id", session.id},
+            {"created_at", session.created_at_ms / 1000},
+            {"last_used_at", session.last_used_at},
+            {"expires_at", session.expires_at},
+            {"current", session.id == auth_result.session_id}
+        });
+    }
+
+    json response = {
+        {"sessions", sessions},
+        {"count", sessions.size()}
+    };
+    send_json_response(res, 200, response);
+}
+
+void AuthHandlers::send_hasher_busy(httplib::Response& res) {
+    res.set_header("Retry-After", "1");
+    send_error_response(res, 503, "Too many password checks in progress, retry later");
+    LOG_WARNING("Password hashing pool saturated, request rejected");
+}
+
+json AuthHandlers::create_session_response(const std::string& username) {
+    const auto session = session_store_->create_session(username);
+
     return {
         {"username", username},
-        {"access_token", token},
+        {"access_token", AuthMiddleware::generate_jwt_token(username, session.session_id)},
+        {"refresh_token", session.refresh_token},
+        {"session_id", session.session_id},
         {"token_type", "Bearer"},
-        {"expires_in", 3600}
+        {"expires_in", AuthMiddleware::kAccessTokenTtlSeconds}
     };
 }
 
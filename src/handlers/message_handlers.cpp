@@ -1,10 +1,105 @@
 #include "handlers/message_handlers.h"
 #include "common/auth_middleware.h"
+#include "common/request_schema.h"
 #include "common/request_validator.h"
+#include "common/snowflake_id.h"
+#include "common/text_scanner.h"
+#include "common/worker_cluster.h"
 #include "common/logger.h"
+#include <charconv>
+#include <map>
+
+namespace {
+
+constexpr size_t kMaxBatchMessages = 100;
+constexpr size_t kMaxSearchQueryBytes = 200;
+constexpr size_t kMaxMessagePage = 500;
+
+struct SendMessageRequest {
+    std::string to_user;
+    std::string content;
+};
+
+const RequestSchema<SendMessageRequest>& send_message_schema() {
+    // Content rules (UTF-8, length in characters, control characters, whitespace) are checked by
+    // RequestValidator::is_valid_message_content
+    static const auto schema = RequestSchema<SendMessageRequest>()
+        .string("to_user", &SendMessageRequest::to_user, StringRule::length(1, 50))
+        .string("content", &SendMessageRequest::content);
+    return schema;
+}
+
+struct SendBatchRequest {
+    std::string to_user;
+    std::vector<std::string> contents;
+};
+
+const RequestSchema<SendBatchRequest>& send_batch_schema() {
+    static const auto schema = RequestSchema<SendBatchRequest>()
+        .string("to_user", &SendBatchRequest::to_user, StringRule::length(1, 50))
+        .string_array("contents", &SendBatchRequest::contents, kMaxBatchMessages);
+    return schema;
+}
+
+struct ReadUpToRequest {
+    std::optional<uint64_t> sequence;
+};
+
+const RequestSchema<ReadUpToRequest>& read_up_to_schema() {
+    static const auto schema = RequestSchema<ReadUpToRequest>()
+        .optional_unsigned("sequence", &ReadUpToRequest::sequence);
+    return schema;
+}
+
+struct CreateGroupRequest {
+    std::string name;
+    std::vector<std::string> members;
+};
+
+const RequestSchema<CreateGroupRequest>& create_group_schema() {
+    static const auto schema = RequestSchema<CreateGroupRequest>()
+        .string("name", &CreateGroupRequest::name, StringRule::length(1, 100))
+        .string_array("members", &CreateGroupRequest::members, MessageManager::kMaxGroupMembers - 1);
+    return schema;
+}
+
+struct AddMembersRequest {
+    std::vector<std::string> members;
+};
+
+const RequestSchema<AddMembersRequest>& add_members_schema() {
+    static const auto schema = RequestSchema<AddMembersRequest>()
+        .string_array("members", &AddMembersRequest::members, MessageManager::kMaxGroupMembers);
+    return schema;
+}
+
+struct GroupMessageRequest {
+    std::string content;
+};
+
+const RequestSchema<GroupMessageRequest>& group_message_schema() {
+    static const auto schema = RequestSchema<GroupMessageRequest>()
+        .string("content", &GroupMessageRequest::content);
+    return schema;
+}
+
+bool count_param(const httplib::Request& req, const std::string& name, size_t& out) {
+    if (!req.has_param(name)) {
+        return true;
+    }
+    const std::string value = req.get_param_value(name);
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), out);
+    return ec == std::errc() && ptr == value.data() + value.size();
+}
 
-MessageHandlers::MessageHandlers(std::shared_ptr<MessageManager> message_manager)
-    : message_manager_(message_manager) {
+} // namespace
+
+MessageHandlers::MessageHandlers(std::shared_ptr<MessageManager> message_manager,
+                                 std::shared_ptr<UserManager> user_manager,
+                                 std::shared_ptr<ContentFilter> content_filter,
+                                 std::shared_ptr<ResponseCache> response_cache)
+    : message_manager_(message_manager), user_manager_(user_manager), content_filter_(content_filter),
+      response_cache_(response_cache) {
 }
 
 void MessageHandlers::handle_send_message(const httplib::Request& req, httplib::Response& res) {
@@ -14,27 +109,33 @@ void MessageHandlers::handle_send_message(const httplib::Request& req, httplib::
         return;
     }
 
-    auto validation = RequestValidator::validate_json_body(req, {"to_user", "content"});
-    if (!validation.is_valid) {
-        send_error_response(res, 400, validation.error_message);
+    SendMessageRequest request;
+    if (auto error = send_message_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
         return;
     }
 
-    const std::string to_user = validation.data["to_user"];
-    const std::string content = validation.data["content"];
+    const std::string& to_user = request.to_user;
+    const std::string& content = request.content;
 
     // Validate message content
     std::string content_error;
-    if (!validate_message_content(content, content_error)) {
+    if (!RequestValidator::is_valid_message_content(content, content_error)) {
         send_error_response(res, 400, content_error);
         return;
     }
 
+    if (auto term = content_filter_->find_blocked_term(content)) {
+        LOG_WARNING("Blocked message from " + auth_result.username + " (matched \"" + *term + "\")");
+        send_error_response(res, 400, "Message contains blocked content");
+        return;
+    }
+
     // Send message
-    std::string message_id = message_manager_->send_message(auth_result.username, to_user, content);
+    const uint64_t message_id = message_manager_->send_message(auth_result.username, to_user, content);
 
-    json response = {
-        {"message_id", message_id},
+    ArenaJson response = {
+        {"message_id", SnowflakeId::format(message_id)},
         {"from_user", auth_result.username},
         {"to_user", to_user},
         {"content", content},
@@ -46,27 +147,85 @@ void MessageHandlers::handle_send_message(const httplib::Request& req, httplib::
     LOG_INFO("Message sent from " + auth_result.username + " to " + to_user);
 }
 
-void MessageHandlers::handle_get_conversations(const httplib::Request& req, httplib::Response& res) {
+void MessageHandlers::handle_send_batch(const httplib::Request& req, httplib::Response& res) {
     auto auth_result = AuthMiddleware::validate_token(req);
     if (!auth_result.is_valid) {
         send_error_response(res, 401, auth_result.error_message);
         return;
     }
 
-    auto conversations = message_manager_->get_user_conversations(auth_result.username);
-    json conversations_array = json::array();
+    SendBatchRequest request;
+    if (auto error = send_batch_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
 
-    for (const auto& conversation : conversations) {
-        conversations_array.push_back(message_manager_->conversation_to_json(conversation, false));
+    if (request.contents.empty()) {
+        send_error_response(res, 400, "contents must not be empty");
+        return;
     }
 
-    json response = {
-        {"conversations", conversations_array},
-        {"total", conversations_array.size()}
+    // All or nothing: one bad message rejects the batch before anything is stored
+    for (size_t i = 0; i < request.contents.size(); ++i) {
+        std::string content_error;
+        if (!RequestValidator::is_valid_message_content(request.contents[i], content_error)) {
+            send_error_response(res, 400, "contents[" + std::to_string(i) + "]: " + content_error);
+            return;
+        }
+
+        if (auto term = content_filter_->find_blocked_term(request.contents[i])) {
+            LOG_WARNING("Blocked message from " + auth_result.username + " (matched \"" + *term + "\")");
+            send_error_response(res, 400, "contents[" + std::to_string(i) + "]: Message contains blocked content");
+            return;
+        }
+    }
+
+    auto sent = message_manager_->send_messages(auth_result.username, request.to_user, request.contents);
+
+    ArenaJson messages_array = ArenaJson::array();
+    for (const auto& message : sent) {
+        ArenaJson message_json(ArenaJson::value_t::object);
+        message_json["message_id"] = SnowflakeId::format(message.id);
+        message_json["sequence"] = message.sequence;
+        message_json["timestamp"] = message.timestamp;
+        messages_array.push_back(std::move(message_json));
+    }
+
+    ArenaJson response = {
+        {"from_user", auth_result.username},
+        {"to_user", request.to_user},
+        {"messages", std::move(messages_array)},
+        {"sent", sent.size()}
+    };
+
+    send_json_response(res, 201, response);
+    LOG_INFO("Batch of " + std::to_string(sent.size()) + " messages sent from " + auth_result.username + " to " + request.to_user);
+}
+
+void MessageHandlers::handle_get_conversations(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    const std::string cache_key = ResponseCache::make_key(req, auth_result.username);
+    const uint64_t version = message_manager_->user_version(auth_result.username);
+    if (response_cache_->serve(cache_key, version, res)) {
+        return;
+    }
+
+    ArenaJson conversations_array = message_manager_->user_conversations_json(auth_result.username);
+    const size_t total = conversations_array.size();
+
+    ArenaJson response = {
+        {"conversations", std::move(conversations_array)},
+        {"total", total}
     };
 
     send_json_response(res, 200, response);
-    LOG_INFO("Conversations retrieved for user: " + auth_result.username + " (" + std::to_string(conversations.size()) + " conversations)");
+    response_cache_->store(cache_key, version, res);
+    LOG_INFO("Conversations retrieved for user: " + auth_result.username + " (" + std::to_string(total) + " conversations)");
 }
 
 void MessageHandlers::handle_get_messages(const httplib::Request& req, httplib::Response& res) {
@@ -78,29 +237,103 @@ void MessageHandlers::handle_get_messages(const httplib::Request& req, httplib::
 
     std::string conv_id = req.matches[1];
 
-    auto messages = message_manager_->get_conversation_messages(conv_id, auth_result.username);
-    if (messages.empty()) {
-        // Check if conversation exists but user has no access
-        auto conversation = message_manager_->get_conversation(conv_id, auth_result.username);
-        if (!conversation.has_value()) {
-            send_error_response(res, 404, "Conversation not found or access denied");
-            return;
+    // Message ids are time-ordered, so they double as cursors: after/before page forwards and back
+    MessageRange range;
+    auto parse_bound = [&req](const std::string& name, std::optional<uint64_t>& out) {
+        if (!req.has_param(name)) {
+            return true;
         }
+        out = SnowflakeId::parse(req.get_param_value(name));
+        return out.has_value();
+    };
+    if (!parse_bound("after", range.after) || !parse_bound("before", range.before)) {
+        send_error_response(res, 400, "after and before must be message ids");
+        return;
+    }
+    if (!count_param(req, "limit", range.limit) || (req.has_param("limit") && range.limit == 0) ||
+        range.limit > kMaxMessagePage) {
+        send_error_response(res, 400, "limit must be between 1 and 500");
+        return;
     }
 
-    json messages_array = json::array();
-    for (const auto& message : messages) {
-        messages_array.push_back(message_manager_->message_to_json(message));
+    bool has_more = false;
+    auto messages_array = message_manager_->conversation_messages_json(conv_id, auth_result.username, range, &has_more);
+    if (!messages_array.has_value()) {
+        send_error_response(res, 404, "Conversation not found or access denied");
+        return;
     }
+    const size_t total = messages_array->size();
 
-    json response = {
+    ArenaJson response = {
         {"conversation_id", conv_id},
-        {"messages", messages_array},
-        {"total", messages_array.size()}
+        {"messages", std::move(*messages_array)},
+        {"total", total},
+        {"has_more", has_more}
+    };
+
+    send_json_response(res, 200, response);
+    LOG_INFO("Messages retrieved for conversation: " + conv_id + " by user: " + auth_result.username + " (" + std::to_string(total) + " messages)");
+}
+
+void MessageHandlers::handle_get_unread(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    UnreadCounts counts = message_manager_->unread_counts(auth_result.username);
+
+    ArenaJson conversations(ArenaJson::value_t::object);
+    for (const auto& [conv_id, unread] : counts.conversations) {
+        conversations[conv_id.c_str()] = unread;
+    }
+
+    ArenaJson response = {
+        {"total", counts.total},
+        {"conversations", std::move(conversations)}
+    };
+
+    send_json_response(res, 200, response);
+}
+
+void MessageHandlers::handle_search_messages(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    const std::string query = req.get_param_value("q");
+    if (query.empty()) {
+        send_error_response(res, 400, "Search query parameter 'q' is required");
+        return;
+    }
+    if (query.size() > kMaxSearchQueryBytes) {
+        send_error_response(res, 400, "Search query must be 200 bytes or less");
+        return;
+    }
+
+    size_t offset = 0;
+    size_t limit = 0;
+    if (!parse_search_page(req, offset, limit)) {
+        send_error_response(res, 400, "limit must be at least 1 and offset + limit at most 1000");
+        return;
+    }
+
+    size_t total = 0;
+    ArenaJson results = message_manager_->search_messages_json(auth_result.username, query, offset, limit, total);
+
+    ArenaJson response = {
+        {"query", query},
+        {"results", std::move(results)},
+        {"total", total},
+        {"offset", offset},
+        {"limit", limit}
     };
 
     send_json_response(res, 200, response);
-    LOG_INFO("Messages retrieved for conversation: " + conv_id + " by user: " + auth_result.username + " (" + std::to_string(messages.size()) + " messages)");
+    LOG_INFO("Message search by " + auth_result.username + ": " + query + " (" + std::to_string(total) + " matches)");
 }
 
 void MessageHandlers::handle_mark_as_read(const httplib::Request& req, httplib::Response& res) {
@@ -112,12 +345,13 @@ void MessageHandlers::handle_mark_as_read(const httplib::Request& req, httplib::
 
     std::string message_id = req.matches[1];
 
-    if (!message_manager_->mark_message_as_read(message_id, auth_result.username)) {
+    auto id = SnowflakeId::parse(message_id);
+    if (!id || !message_manager_->mark_message_as_read(*id, auth_result.username)) {
         send_error_response(res, 404, "Message not found or access denied");
         return;
     }
 
-    json response = {
+    ArenaJson response = {
         {"message_id", message_id},
         {"marked_as_read", true}
     };
@@ -126,6 +360,40 @@ void MessageHandlers::handle_mark_as_read(const httplib::Request& req, httplib::
     LOG_INFO("Message marked as read: " + message_id + " by user: " + auth_result.username);
 }
 
+void MessageHandlers::handle_read_up_to(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    std::string conv_id = req.matches[1];
+
+    // The body is optional; without a sequence everything so far is read
+    ReadUpToRequest request;
+    if (!req.body.empty()) {
+        if (auto error = read_up_to_schema().parse(req.body, request)) {
+            send_error_response(res, 400, *error);
+            return;
+        }
+    }
+
+    auto read_state = message_manager_->mark_read_up_to(conv_id, auth_result.username, request.sequence);
+    if (!read_state.has_value()) {
+        send_error_response(res, 404, "Conversation not found or access denied");
+        return;
+    }
+
+    ArenaJson response = {
+        {"conversation_id", conv_id},
+        {"read_up_to", read_state->read_up_to},
+        {"unread_count", read_state->unread}
+    };
+
+    send_json_response(res, 200, response);
+    LOG_INFO("Conversation " + conv_id + " read up to " + std::to_string(read_state->read_up_to) + " by user: " + auth_result.username);
+}
+
 void MessageHandlers::handle_delete_message(const httplib::Request& req, httplib::Response& res) {
     auto auth_result = AuthMiddleware::validate_token(req);
     if (!auth_result.is_valid) {
@@ -135,12 +403,13 @@ void MessageHandlers::handle_delete_message(const httplib::Request& req, httplib
 
     std::string message_id = req.matches[1];
 
-    if (!message_manager_->delete_message(message_id, auth_result.username)) {
+    auto id = SnowflakeId::parse(message_id);
+    if (!id || !message_manager_->delete_message(*id, auth_result.username)) {
         send_error_response(res, 404, "Message not found or access denied");
         return;
     }
 
-    json response = {
+    ArenaJson response = {
         {"message_id", message_id},
         {"deleted", true}
     };
@@ -149,33 +418,266 @@ void MessageHandlers::handle_delete_message(const httplib::Request& req, httplib
     LOG_INFO("Message deleted: " + message_id + " by user: " + auth_result.username);
 }
 
-bool MessageHandlers::validate_message_content(const std::string& content, std::string& error_message) {
-    if (content.empty()) {
-        error_message = "Message content cannot be empty";
-        return false;
+void MessageHandlers::handle_create_group(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
     }
 
-    if (content.length() > 1000) {
-        error_message = "Message content must be 1000 characters or less";
-        return false;
+    CreateGroupRequest request;
+    if (auto error = create_group_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+
+    std::string members_error;
+    if (!validate_usernames(request.members, members_error)) {
+        send_error_response(res, 400, members_error);
+        return;
+    }
+    if (auto unknown = find_unknown_user(request.members)) {
+        send_error_response(res, 404, "User not found: " + *unknown);
+        return;
+    }
+    const TextScanner::Result scan = TextScanner::scan(request.name);
+    if (!scan.valid_utf8 || scan.has_control || scan.all_whitespace) {
+        send_error_response(res, 400, "Group name must be printable UTF-8");
+        return;
+    }
+
+    size_t member_count = 0;
+    const std::string group_id = message_manager_->create_group(auth_result.username, request.name, request.members,
+                                                                &member_count);
+
+    ArenaJson response = {
+        {"conversation_id", group_id},
+        {"name", request.name},
+        {"member_count", member_count},
+        {"created", true}
+    };
+
+    send_json_response(res, 201, response);
+    LOG_INFO("Group " + group_id + " created by " + auth_result.username);
+}
+
+void MessageHandlers::handle_get_group_members(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
     }
 
-    // Check for only whitespace
-    if (content.find_first_not_of(" \t\n\r") == std::string::npos) {
-        error_message = "Message content cannot be only whitespace";
+    std::string group_id = req.matches[1];
+
+    auto members = message_manager_->group_members(group_id, auth_result.username);
+    if (!members.has_value()) {
+        send_error_response(res, 404, "Group not found or access denied");
+        return;
+    }
+    const size_t total = members->size();
+
+    ArenaJson members_array = ArenaJson::array();
+    for (const auto& member : *members) {
+        members_array.push_back(member);
+    }
+
+    ArenaJson response = {
+        {"conversation_id", group_id},
+        {"members", std::move(members_array)},
+        {"total", total}
+    };
+
+    send_json_response(res, 200, response);
+}
+
+void MessageHandlers::handle_add_group_members(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    std::string group_id = req.matches[1];
+
+    AddMembersRequest request;
+    if (auto error = add_members_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+
+    std::string members_error;
+    if (!validate_usernames(request.members, members_error)) {
+        send_error_response(res, 400, members_error);
+        return;
+    }
+    if (auto unknown = find_unknown_user(request.members)) {
+        send_error_response(res, 404, "User not found: " + *unknown);
+        return;
+    }
+
+    size_t member_count = 0;
+    switch (message_manager_->add_group_members(group_id, auth_result.username, request.members, &member_count)) {
+    case GroupUpdate::NotFound:
+        send_error_response(res, 404, "Group not found or access denied");
+        return;
+    case GroupUpdate::Full:
+        send_error_response(res, 409, "A group holds at most " + std::to_string(MessageManager::kMaxGroupMembers) + " members");
+        return;
+    case GroupUpdate::Updated:
+        break;
+    }
+
+    ArenaJson response = {
+        {"conversation_id", group_id},
+        {"member_count", member_count},
+        {"updated", true}
+    };
+
+    send_json_response(res, 200, response);
+    LOG_INFO("Members added to group " + group_id + " by " + auth_result.username);
+}
+
+void MessageHandlers::handle_leave_group(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    std::string group_id = req.matches[1];
+
+    if (!message_manager_->leave_group(group_id, auth_result.username)) {
+        send_error_response(res, 404, "Group not found or access denied");
+        return;
+    }
+
+    ArenaJson response = {
+        {"conversation_id", group_id},
+        {"left", true}
+    };
+
+    send_json_response(res, 200, response);
+    LOG_INFO("User " + auth_result.username + " left group " + group_id);
+}
+
+void MessageHandlers::handle_send_group_message(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    std::string group_id = req.matches[1];
+
+    GroupMessageRequest request;
+    if (auto error = group_message_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+
+    std::string content_error;
+    if (!RequestValidator::is_valid_message_content(request.content, content_error)) {
+        send_error_response(res, 400, content_error);
+        return;
+    }
+
+    if (auto term = content_filter_->find_blocked_term(request.content)) {
+        LOG_WARNING("Blocked message from " + auth_result.username + " (matched \"" + *term + "\")");
+        send_error_response(res, 400, "Message contains blocked content");
+        return;
+    }
+
+    auto message = message_manager_->send_group_message(group_id, auth_result.username, request.content);
+    if (!message.has_value()) {
+        send_error_response(res, 404, "Group not found or access denied");
+        return;
+    }
+
+    ArenaJson response = {
+        {"message_id", SnowflakeId::format(message->id)},
+        {"conversation_id", group_id},
+        {"from_user", auth_result.username},
+        {"content", message->content},
+        {"timestamp", message->timestamp},
+        {"sequence", message->sequence},
+        {"sent", true}
+    };
+
+    send_json_response(res, 201, response);
+    LOG_INFO("Group message sent from " + auth_result.username + " to " + group_id);
+}
+
+bool MessageHandlers::parse_search_page(const httplib::Request& req, size_t& offset, size_t& limit) {
+    offset = 0;
+    limit = kDefaultSearchLimit;
+    if (!count_param(req, "offset", offset) || !count_param(req, "limit", limit)) {
         return false;
     }
+    return limit > 0 && offset < kMaxSearchWindow && limit <= kMaxSearchWindow - offset;
+}
 
+bool MessageHandlers::validate_usernames(const std::vector<std::string>& usernames, std::string& error_message) {
+    for (size_t i = 0; i < usernames.size(); ++i) {
+        if (!RequestValidator::is_valid_username(usernames[i])) {
+            error_message = "members[" + std::to_string(i) + "]: Invalid username";
+            return false;
+        }
+    }
     return true;
 }
 
-void MessageHandlers::send_json_response(httplib::Response& res, int status, const json& data) {
+std::optional<std::string> MessageHandlers::find_unknown_user(const std::vector<std::string>& usernames) {
+    // Profiles are partitioned by username; the ones held elsewhere are checked by their owner
+    std::vector<std::string> local;
+    std::map<int, std::vector<std::string>> remote;
+    for (const auto& username : usernames) {
+        if (WorkerCluster::owns(username)) {
+            local.push_back(username);
+        } else {
+            remote[WorkerCluster::owner_of(username)].push_back(username);
+        }
+    }
+
+    // One lookup for the whole list rather than a lock round trip per member
+    auto users = user_manager_->get_users(local);
+    for (size_t i = 0; i < users.size(); ++i) {
+        if (!users[i]) {
+            return local[i];
+        }
+    }
+
+    // And one request per owner
+    for (const auto& [worker, names] : remote) {
+        httplib::Request lookup;
+        lookup.method = "POST";
+        lookup.path = "/internal/users/unknown";
+        lookup.body = json{{"usernames", names}}.dump();
+        lookup.set_header("Content-Type", "application/json");
+
+        httplib::Response answer;
+        if (!WorkerCluster::forward("UserService", worker, lookup, answer) || answer.status != 200) {
+            LOG_WARNING("Worker " + std::to_string(worker) + " could not check " + std::to_string(names.size()) +
+                        " usernames; accepting them");
+            continue;
+        }
+        const json body = json::parse(answer.body, nullptr, false);
+        if (body.is_object() && body.contains("unknown") && body["unknown"].is_array() &&
+            !body["unknown"].empty() && body["unknown"][0].is_string()) {
+            return body["unknown"][0].get<std::string>();
+        }
+    }
+    return std::nullopt;
+}
+
+void MessageHandlers::send_json_response(httplib::Response& res, int status, const ArenaJson& data) {
     res.status = status;
-    res.set_content(data.dump(2), "application/json");
+    const ArenaString body = data.dump(2);
+    res.set_content(body.data(), body.size(), "application/json");
 }
 
 void MessageHandlers::send_error_response(httplib::Response& res, int status, const std::string& message) {
-    const json error_data = {
+    const ArenaJson error_data = {
         {"error", true},
         {"message", message},
         {"status", status}
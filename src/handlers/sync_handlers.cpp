@@ -0,0 +1,110 @@
+#include "handlers/sync_handlers.h"
+#include "common/auth_middleware.h"
+#include "common/worker_cluster.h"
+#include "common/logger.h"
+
+SyncHandlers::SyncHandlers(std::shared_ptr<ChangeLog> change_log,
+                           std::shared_ptr<MessageManager> message_manager,
+                           std::shared_ptr<UserManager> user_manager,
+                           std::shared_ptr<ConnectionManager> connection_manager)
+    : change_log_(change_log), message_manager_(message_manager), user_manager_(user_manager),
+      connection_manager_(connection_manager) {
+}
+
+void SyncHandlers::handle_sync(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    std::optional<ChangeLog::Delta> delta;
+    if (req.has_param("since")) {
+        if (auto since = parse_since(req.get_param_value("since"))) {
+            delta = change_log_->changes_since(auth_result.username, *since,
+                                               message_manager_->user_groups(auth_result.username));
+        }
+    }
+
+    ArenaJson response(ArenaJson::value_t::object);
+    ArenaJson& changes = response["changes"] = ArenaJson::array();
+    uint64_t cursor = 0;
+
+    if (delta) {
+        cursor = delta->cursor;
+        response["full"] = false;
+        for (const auto& change : delta->changes) {
+            ArenaJson& entry = changes.emplace_back(ArenaJson::value_t::object);
+            entry["type"] = change->type;
+            entry["timestamp"] = change->timestamp;
+            entry["data"] = ArenaJson(change->data);
+        }
+    } else {
+        // Cursor first: whatever changes while the snapshot is built is delivered again next time,
+        // and applying a change twice is harmless
+        cursor = change_log_->cursor();
+        response["full"] = true;
+        response["snapshot"] = build_snapshot(auth_result.username);
+    }
+    response["cursor"] = change_log_->format_cursor(cursor);
+
+    send_json_response(res, 200, response);
+    LOG_INFO("Sync for " + auth_result.username + ": " +
+             (delta ? std::to_string(delta->changes.size()) + " changes" : std::string("full snapshot")));
+}
+
+std::optional<uint64_t> SyncHandlers::parse_since(const std::string& cursor) const {
+    // Pick this worker's part; a cursor from a differently sized cluster is treated as expired
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        const size_t end = cursor.find(kCursorSeparator, start);
+        parts.push_back(cursor.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+
+    if (parts.size() != static_cast<size_t>(WorkerCluster::worker_count())) {
+        return std::nullopt;
+    }
+    return change_log_->parse_cursor(parts[WorkerCluster::worker_index()]);
+}
+
+ArenaJson SyncHandlers::build_snapshot(const std::string& username) {
+    ArenaJson snapshot(ArenaJson::value_t::object);
+    snapshot["conversations"] = message_manager_->user_conversations_json(username);
+
+    // Listing fields, with presence reported once in online_users. Every worker holds the sample
+    // users, so only the owner of each profile reports it.
+    auto users = user_manager_->get_all_users(username);
+    ArenaJson& users_array = snapshot["users"] = ArenaJson::array();
+    for (const auto& user : users) {
+        if (!WorkerCluster::owns(user.username)) {
+            continue;
+        }
+        ArenaJson& user_info = users_array.emplace_back(ArenaJson::value_t::object);
+        user_info["username"] = user.username;
+        user_info["full_name"] = user.full_name;
+        user_info["last_seen"] = user_manager_->get_last_seen(user);
+    }
+
+    snapshot["online_users"] = connection_manager_->get_online_users();
+    return snapshot;
+}
+
+void SyncHandlers::send_json_response(httplib::Response& res, int status, const ArenaJson& data) {
+    res.status = status;
+    const ArenaString body = data.dump(2);
+    res.set_content(body.data(), body.size(), "application/json");
+}
+
+void SyncHandlers::send_error_response(httplib::Response& res, int status, const std::string& message) {
+    const ArenaJson error_data = {
+        {"error", true},
+        {"message", message},
+        {"status", status}
+    };
+    send_json_response(res, status, error_data);
+}
@@ -1,10 +1,49 @@
 #include "handlers/user_handlers.h"
 #include "common/auth_middleware.h"
 #include "common/request_validator.h"
+#include "common/request_schema.h"
 #include "common/logger.h"
 
-UserHandlers::UserHandlers(std::shared_ptr<UserManager> user_manager)
-    : user_manager_(user_manager) {
+namespace {
+
+struct OnlineStatusRequest {
+    bool is_online = false;
+};
+
+struct AddContactRequest {
+    std::string username;
+};
+
+struct PresenceRequest {
+    std::vector<std::string> user_ids;
+};
+
+const RequestSchema<OnlineStatusRequest>& online_status_schema() {
+    static const auto schema = RequestSchema<OnlineStatusRequest>()
+        .boolean("is_online", &OnlineStatusRequest::is_online);
+    return schema;
+}
+
+const RequestSchema<AddContactRequest>& add_contact_schema() {
+    static const auto schema = RequestSchema<AddContactRequest>()
+        .string("username", &AddContactRequest::username, StringRule::length(1, 50));
+    return schema;
+}
+
+const RequestSchema<PresenceRequest>& presence_schema() {
+    static const auto schema = RequestSchema<PresenceRequest>()
+        .string_array("user_ids", &PresenceRequest::user_ids, UserHandlers::kMaxPresenceBatch);
+    return schema;
+}
+
+} // namespace
+
+UserHandlers::UserHandlers(std::shared_ptr<UserManager> user_manager,
+                           std::shared_ptr<ConnectionManager> connection_manager,
+                           std::shared_ptr<ContactGraph> contact_graph,
+                           std::shared_ptr<ResponseCache> response_cache)
+    : user_manager_(user_manager), connection_manager_(connection_manager), contact_graph_(contact_graph),
+      response_cache_(response_cache) {
 }
 
 void UserHandlers::handle_get_user(const httplib::Request& req, httplib::Response& res) {
@@ -20,7 +59,7 @@ void UserHandlers::handle_get_user(const httplib::Request& req, httplib::Respons
         return;
     }
 
-    json response = user_manager_->user_to_json(user.value());
+    ArenaJson response = user_manager_->user_to_json(user.value());
     send_json_response(res, 200, response);
     LOG_INFO("Profile retrieved for user: " + auth_result.username);
 }
@@ -44,7 +83,7 @@ void UserHandlers::handle_update_user(const httplib::Request& req, httplib::Resp
     }
 
     auto updated_user = user_manager_->get_user(auth_result.username);
-    json response = user_manager_->user_to_json(updated_user.value());
+    ArenaJson response = user_manager_->user_to_json(updated_user.value());
     response["updated"] = true;
 
     send_json_response(res, 200, response);
@@ -58,25 +97,32 @@ void UserHandlers::handle_get_users(const httplib::Request& req, httplib::Respon
         return;
     }
 
+    // Both counters only grow, so their sum changes whenever either does
+    const std::string cache_key = ResponseCache::make_key(req, auth_result.username);
+    const uint64_t version = user_manager_->version() + connection_manager_->version();
+    if (response_cache_->serve(cache_key, version, res)) {
+        return;
+    }
+
     auto users = user_manager_->get_all_users(auth_result.username);
-    json users_array = json::array();
+    auto online = get_online_set(users);
+    ArenaJson users_array = ArenaJson::array();
 
     for (const auto& user : users) {
-        json user_info = {
-            {"username", user.username},
-            {"full_name", user.full_name},
-            {"is_online", user.is_online},
-            {"last_seen", user.last_seen}
-        };
-        users_array.push_back(user_info);
-    }
-
-    json response = {
-        {"users", users_array},
-        {"total", users_array.size()}
+        ArenaJson& user_info = users_array.emplace_back(ArenaJson::value_t::object);
+        user_info["username"] = user.username;
+        user_info["full_name"] = user.full_name;
+        user_info["is_online"] = online.count(user.username) > 0;
+        user_info["last_seen"] = user_manager_->get_last_seen(user);
+    }
+
+    ArenaJson response = {
+        {"users", std::move(users_array)},
+        {"total", users.size()}
     };
 
     send_json_response(res, 200, response);
+    response_cache_->store(cache_key, version, res);
     LOG_INFO("Users list retrieved for: " + auth_result.username);
 }
 
@@ -94,25 +140,24 @@ void UserHandlers::handle_search_users(const httplib::Request& req, httplib::Res
     }
 
     auto users = user_manager_->search_users(query, auth_result.username);
-    json results = json::array();
+    auto online = get_online_set(users);
+    ArenaJson results = ArenaJson::array();
 
     for (const auto& user : users) {
-        json user_info = {
-            {"username", user.username},
-            {"full_name", user.full_name},
-            {"is_online", user.is_online}
-        };
-        results.push_back(user_info);
+        ArenaJson& user_info = results.emplace_back(ArenaJson::value_t::object);
+        user_info["username"] = user.username;
+        user_info["full_name"] = user.full_name;
+        user_info["is_online"] = online.count(user.username) > 0;
     }
 
-    json response = {
-        {"results", results},
+    ArenaJson response = {
+        {"results", std::move(results)},
         {"query", query},
-        {"total", results.size()}
+        {"total", users.size()}
     };
 
     send_json_response(res, 200, response);
-    LOG_INFO("User search performed: " + query + " (" + std::to_string(results.size()) + " results)");
+    LOG_INFO("User search performed: " + query + " (" + std::to_string(users.size()) + " results)");
 }
 
 void UserHandlers::handle_set_online_status(const httplib::Request& req, httplib::Response& res) {
@@ -122,20 +167,20 @@ void UserHandlers::handle_set_online_status(const httplib::Request& req, httplib
         return;
     }
 
-    auto validation = RequestValidator::validate_json_body(req, {"is_online"});
-    if (!validation.is_valid) {
-        send_error_response(res, 400, validation.error_message);
+    OnlineStatusRequest request;
+    if (auto error = online_status_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
         return;
     }
 
-    bool is_online = validation.data["is_online"];
+    const bool is_online = request.is_online;
 
     if (!user_manager_->set_online_status(auth_result.username, is_online)) {
         send_error_response(res, 404, "User not found");
         return;
     }
 
-    json response = {
+    ArenaJson response = {
         {"username", auth_result.username},
         {"is_online", is_online},
         {"updated", true}
@@ -145,13 +190,120 @@ void UserHandlers::handle_set_online_status(const httplib::Request& req, httplib
     LOG_INFO("Online status updated for user: " + auth_result.username + " -> " + (is_online ? "online" : "offline"));
 }
 
-void UserHandlers::send_json_response(httplib::Response& res, int status, const json& data) {
+void UserHandlers::handle_get_contacts(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    auto contacts = contact_graph_->get_contacts(auth_result.username);
+
+    ArenaJson response = {
+        {"contacts", contacts},
+        {"total", contacts.size()}
+    };
+
+    send_json_response(res, 200, response);
+    LOG_INFO("Contacts retrieved for user: " + auth_result.username + " (" + std::to_string(contacts.size()) + " contacts)");
+}
+
+void UserHandlers::handle_add_contact(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    AddContactRequest request;
+    if (auto error = add_contact_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+
+    const std::string& contact = request.username;
+    if (contact == auth_result.username) {
+        send_error_response(res, 400, "Cannot add yourself as a contact");
+        return;
+    }
+
+    if (!user_manager_->user_exists(contact)) {
+        send_error_response(res, 404, "User not found");
+        return;
+    }
+
+    bool added = contact_graph_->add_contact(auth_result.username, contact);
+
+    ArenaJson response = {
+        {"username", auth_result.username},
+        {"contact", contact},
+        {"added", added}
+    };
+
+    send_json_response(res, added ? 201 : 200, response);
+    LOG_INFO("Contact add requested by " + auth_result.username + ": " + contact);
+}
+
+void UserHandlers::handle_get_presence(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    PresenceRequest request;
+    if (auto error = presence_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+
+    const std::vector<std::string>& user_ids = request.user_ids;
+
+    // One pass over each manager for the whole batch
+    auto online = connection_manager_->filter_online_users(user_ids);
+    std::unordered_set<std::string> online_set(online.begin(), online.end());
+    auto users = user_manager_->get_users(user_ids);
+
+    ArenaJson presence = ArenaJson::array();
+    for (size_t i = 0; i < user_ids.size(); ++i) {
+        ArenaJson& entry = presence.emplace_back(ArenaJson::value_t::object);
+        entry["user_id"] = user_ids[i];
+        entry["is_online"] = online_set.count(user_ids[i]) > 0;
+        entry["exists"] = users[i].has_value();
+        if (users[i].has_value()) {
+            entry["last_seen"] = user_manager_->get_last_seen(users[i].value());
+        }
+    }
+
+    ArenaJson response = {
+        {"presence", std::move(presence)},
+        {"online", online.size()},
+        {"total", user_ids.size()}
+    };
+
+    send_json_response(res, 200, response);
+    LOG_INFO("Presence resolved for " + std::to_string(user_ids.size()) + " users by: " + auth_result.username);
+}
+
+std::unordered_set<std::string> UserHandlers::get_online_set(const std::vector<User>& users) {
+    std::vector<std::string> usernames;
+    usernames.reserve(users.size());
+    for (const auto& user : users) {
+        usernames.push_back(user.username);
+    }
+
+    auto online = connection_manager_->filter_online_users(std::move(usernames));
+    return {online.begin(), online.end()};
+}
+
+void UserHandlers::send_json_response(httplib::Response& res, int status, const ArenaJson& data) {
     res.status = status;
-    res.set_content(data.dump(2), "application/json");
+    const ArenaString body = data.dump(2);
+    res.set_content(body.data(), body.size(), "application/json");
 }
 
 void UserHandlers::send_error_response(httplib::Response& res, int status, const std::string& message) {
-    const json error_data = {
+    const ArenaJson error_data = {
         {"error", true},
         {"message", message},
         {"status", status}
@@ -1,19 +1,79 @@
 #include "handlers/websocket_handlers.h"
 #include "common/auth_middleware.h"
 #include "common/request_validator.h"
+#include "common/request_schema.h"
+#include "common/snowflake_id.h"
+#include "common/text_scanner.h"
 #include "common/logger.h"
+#include <optional>
+#include <unordered_map>
+
+namespace {
+
+struct DirectMessageRequest {
+    std::string to_user;
+    std::string message;
+};
+
+struct BroadcastRequest {
+    std::string message;
+};
+
+struct CreateChannelRequest {
+    std::string name;
+    std::optional<std::string> description;
+};
+
+const RequestSchema<DirectMessageRequest>& direct_message_schema() {
+    static const auto schema = RequestSchema<DirectMessageRequest>()
+        .string("to_user", &DirectMessageRequest::to_user, StringRule::length(1, 50))
+        .string("message", &DirectMessageRequest::message, StringRule::length(1, RequestValidator::kMaxMessageCharacters * 4));
+    return schema;
+}
+
+const RequestSchema<BroadcastRequest>& broadcast_schema() {
+    static const auto schema = RequestSchema<BroadcastRequest>()
+        .string("message", &BroadcastRequest::message, StringRule::length(1, RequestValidator::kMaxMessageCharacters * 4));
+    return schema;
+}
+
+const RequestSchema<CreateChannelRequest>& create_channel_schema() {
+    static const auto schema = RequestSchema<CreateChannelRequest>()
+        .string("name", &CreateChannelRequest::name, StringRule::length(1, 64).with_chars(CharClass::username()))
+        .optional_string("description", &CreateChannelRequest::description, StringRule::length(0, 500));
+    return schema;
+}
 
-WebSocketHandlers::WebSocketHandlers(std::shared_ptr<ConnectionManager> connection_manager)
-    : connection_manager_(connection_manager) {
+} // namespace
+
+WebSocketHandlers::WebSocketHandlers(std::shared_ptr<ConnectionManager> connection_manager,
+                                     std::shared_ptr<ContactGraph> contact_graph,
+                                     std::shared_ptr<PresenceTracker> presence_tracker,
+                                     std::shared_ptr<ContentFilter> content_filter,
+                                     std::shared_ptr<ResponseCache> response_cache,
+                                     std::shared_ptr<ChannelManager> channel_manager,
+                                     std::shared_ptr<UserIdInterner> user_ids)
+    : connection_manager_(connection_manager), contact_graph_(contact_graph), presence_tracker_(presence_tracker),
+      content_filter_(content_filter), response_cache_(response_cache), channel_manager_(channel_manager),
+      user_ids_(user_ids) {
 }
 
-void WebSocketHandlers::handle_get_stats(const httplib::Request& req, httplib::Response& res) {
+void WebSocketHandlers::handle_get_stats(const httplib::Request& /*req*/, httplib::Response& res) {
     json stats = connection_manager_->get_stats();
+    stats["presence"] = presence_tracker_->get_stats();
+    stats["channels"] = channel_manager_->get_stats();
     send_json_response(res, 200, stats);
     LOG_INFO("WebSocket stats requested");
 }
 
 void WebSocketHandlers::handle_get_online_users(const httplib::Request& req, httplib::Response& res) {
+    // Same list for every caller; the timestamp is when it was built
+    const std::string cache_key = ResponseCache::make_key(req, "");
+    const uint64_t version = connection_manager_->version();
+    if (response_cache_->serve(cache_key, version, res)) {
+        return;
+    }
+
     auto online_users = connection_manager_->get_online_users();
 
     json response = {
@@ -23,6 +83,7 @@ void WebSocketHandlers::handle_get_online_users(const httplib::Request& req, htt
     };
 
     send_json_response(res, 200, response);
+    response_cache_->store(cache_key, version, res);
     LOG_INFO("Online users list requested (" + std::to_string(online_users.size()) + " users)");
 }
 
@@ -57,12 +118,8 @@ void WebSocketHandlers::handle_connect_user(const httplib::Request& req, httplib
         return;
     }
 
-    LOG_INFO("User connecting: " + user_id);
-
-    std::string connection_id = connection_manager_->add_connection(user_id);
-
-    // Notify other users about new user online
-    notify_user_status_change(user_id, true);
+    // Presence changes are picked up by the tracker and published in the next digest
+    const std::string connection_id = SnowflakeId::format(connection_manager_->add_connection(user_id));
 
     json response = {
         {"connection_id", connection_id},
@@ -82,14 +139,24 @@ void WebSocketHandlers::handle_send_message(const httplib::Request& req, httplib
         return;
     }
 
-    auto validation = RequestValidator::validate_json_body(req, {"to_user", "message"});
-    if (!validation.is_valid) {
-        send_error_response(res, 400, validation.error_message);
+    DirectMessageRequest request;
+    if (auto error = direct_message_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+    std::string content_error;
+    if (!RequestValidator::is_valid_message_content(request.message, content_error)) {
+        send_error_response(res, 400, content_error);
+        return;
+    }
+    if (auto term = content_filter_->find_blocked_term(request.message)) {
+        LOG_WARNING("Blocked message from " + auth_result.username + " (matched \"" + *term + "\")");
+        send_error_response(res, 400, "Message contains blocked content");
         return;
     }
 
-    const std::string target_user = validation.data["to_user"];
-    const std::string message_text = validation.data["message"];
+    const std::string& target_user = request.to_user;
+    const std::string& message_text = request.message;
 
     json message = {
         {"from", auth_result.username},
@@ -118,13 +185,23 @@ void WebSocketHandlers::handle_broadcast_message(const httplib::Request& req, ht
         return;
     }
 
-    auto validation = RequestValidator::validate_json_body(req, {"message"});
-    if (!validation.is_valid) {
-        send_error_response(res, 400, validation.error_message);
+    BroadcastRequest request;
+    if (auto error = broadcast_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+    std::string content_error;
+    if (!RequestValidator::is_valid_message_content(request.message, content_error)) {
+        send_error_response(res, 400, content_error);
+        return;
+    }
+    if (auto term = content_filter_->find_blocked_term(request.message)) {
+        LOG_WARNING("Blocked message from " + auth_result.username + " (matched \"" + *term + "\")");
+        send_error_response(res, 400, "Message contains blocked content");
         return;
     }
 
-    const std::string message_text = validation.data["message"];
+    const std::string& message_text = request.message;
 
     json message = {
         {"from", auth_result.username},
@@ -150,7 +227,8 @@ void WebSocketHandlers::handle_disconnect_user(const httplib::Request& req, http
     std::string user_id = req.get_param_value("user_id");
 
     if (!connection_id.empty()) {
-        if (connection_manager_->remove_connection(connection_id)) {
+        auto id = SnowflakeId::parse(connection_id);
+        if (id && connection_manager_->remove_connection(*id)) {
             json response = {
                 {"disconnected", true},
                 {"connection_id", connection_id}
@@ -162,7 +240,6 @@ void WebSocketHandlers::handle_disconnect_user(const httplib::Request& req, http
         }
     } else if (!user_id.empty()) {
         if (connection_manager_->remove_user_connections(user_id)) {
-            notify_user_status_change(user_id, false);
             json response = {
                 {"disconnected", true},
                 {"user_id", user_id}
@@ -177,26 +254,242 @@ void WebSocketHandlers::handle_disconnect_user(const httplib::Request& req, http
     }
 }
 
+void WebSocketHandlers::handle_create_channel(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    CreateChannelRequest request;
+    if (auto error = create_channel_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+    const std::string description = request.description.value_or("");
+    if (!description.empty()) {
+        const TextScanner::Result scan = TextScanner::scan(description);
+        if (!scan.valid_utf8 || scan.has_control || scan.all_whitespace) {
+            send_error_response(res, 400, "Channel description must be printable UTF-8");
+            return;
+        }
+    }
+
+    if (!channel_manager_->create_channel(request.name, description, auth_result.username)) {
+        send_error_response(res, 409, "Channel already exists");
+        return;
+    }
+    // Every worker registers the channel and the creator's subscription alike
+    channel_manager_->subscribe(request.name, auth_result.username);
+
+    json response = {
+        {"channel", request.name},
+        {"description", description},
+        {"created_by", auth_result.username},
+        {"created", true}
+    };
+
+    send_json_response(res, 201, response);
+}
+
+void WebSocketHandlers::handle_list_channels(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    json channels = json::array();
+    for (const auto& channel : channel_manager_->list_channels(auth_result.username)) {
+        channels.push_back({
+            {"name", channel.name},
+            {"description", channel.description},
+            {"created_by", channel.created_by},
+            {"created_at", channel.created_at},
+            {"subscribers", channel.subscribers},
+            {"subscribed", channel.subscribed}
+        });
+    }
+
+    json response = {
+        {"channels", channels},
+        {"count", channels.size()}
+    };
+
+    send_json_response(res, 200, response);
+}
+
+void WebSocketHandlers::handle_subscribe(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    std::string channel = req.matches[1];
+
+    if (!channel_manager_->subscribe(channel, auth_result.username)) {
+        send_error_response(res, 404, "Channel not found");
+        return;
+    }
+
+    json response = {
+        {"channel", channel},
+        {"subscribed", true}
+    };
+
+    send_json_response(res, 200, response);
+}
+
+void WebSocketHandlers::handle_unsubscribe(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    std::string channel = req.matches[1];
+
+    if (!channel_manager_->unsubscribe(channel, auth_result.username)) {
+        send_error_response(res, 404, "Channel not found");
+        return;
+    }
+
+    json response = {
+        {"channel", channel},
+        {"subscribed", false}
+    };
+
+    send_json_response(res, 200, response);
+}
+
+void WebSocketHandlers::handle_publish(const httplib::Request& req, httplib::Response& res) {
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        send_error_response(res, 401, auth_result.error_message);
+        return;
+    }
+
+    std::string channel = req.matches[1];
+
+    BroadcastRequest request;
+    if (auto error = broadcast_schema().parse(req.body, request)) {
+        send_error_response(res, 400, *error);
+        return;
+    }
+    std::string content_error;
+    if (!RequestValidator::is_valid_message_content(request.message, content_error)) {
+        send_error_response(res, 400, content_error);
+        return;
+    }
+    if (auto term = content_filter_->find_blocked_term(request.message)) {
+        LOG_WARNING("Blocked message from " + auth_result.username + " (matched \"" + *term + "\")");
+        send_error_response(res, 400, "Message contains blocked content");
+        return;
+    }
+
+    auto subscribers = channel_manager_->subscribers(channel);
+    if (!subscribers) {
+        send_error_response(res, 404, "Channel not found");
+        return;
+    }
+    if (!channel_manager_->can_publish(channel, auth_result.username)) {
+        send_error_response(res, 403, "Only the channel's creator and subscribers can publish");
+        return;
+    }
+
+    json message = {
+        {"from", auth_result.username},
+        {"channel", channel},
+        {"message", request.message},
+        {"timestamp", std::time(nullptr)},
+        {"type", "channel_message"}
+    };
+
+    // Subscribers who aren't connected here get nothing; no per-subscriber lookups either way
+    const UserBitmap online = connection_manager_->intersect_online(*subscribers);
+    const size_t delivered = deliver_to_users(online, message);
+    channel_manager_->record_publish(delivered);
+
+    json response = {
+        {"channel", channel},
+        {"published", true},
+        {"subscribers", subscribers->cardinality()},
+        {"delivered", delivered}
+    };
+
+    send_json_response(res, 200, response);
+    LOG_INFO("Channel " + channel + ": message from " + auth_result.username + " delivered to " +
+             std::to_string(delivered) + " of " + std::to_string(subscribers->cardinality()) + " subscribers");
+}
+
 void WebSocketHandlers::send_message_to_user(const std::string& target_user, const json& message) {
     // Simulate sending message to user (in real implementation, send via WebSocket)
-    LOG_INFO("Message sent to user " + target_user + ": " + message.dump());
+    LOG_DEBUG("Message sent to user " + target_user + ": " + message.dump());
 }
 
-void WebSocketHandlers::broadcast_message_to_all(const json& message) {
+void WebSocketHandlers::broadcast_message_to_all(const json& /*message*/) {
     auto online_users = connection_manager_->get_online_users();
     LOG_INFO("Broadcast message sent to " + std::to_string(online_users.size()) + " users (simulated)");
 }
 
-void WebSocketHandlers::notify_user_status_change(const std::string& user_id, bool is_online) {
-    json notification = {
-        {"type", "user_status_change"},
-        {"user_id", user_id},
-        {"is_online", is_online},
-        {"timestamp", std::time(nullptr)}
+size_t WebSocketHandlers::deliver_to_users(const UserBitmap& users, const json& message) {
+    size_t delivered = 0;
+    std::vector<UserIdInterner::Id> batch;
+    batch.reserve(kDeliveryBatch);
+
+    auto flush = [&]() {
+        for (const auto& user : user_ids_->names(batch)) {
+            send_message_to_user(user, message);
+            ++delivered;
+        }
+        batch.clear();
     };
 
-    broadcast_message_to_all(notification);
-    LOG_INFO("User status change broadcasted: " + user_id + " -> " + (is_online ? "online" : "offline"));
+    users.for_each([&](UserIdInterner::Id id) {
+        batch.push_back(id);
+        if (batch.size() == kDeliveryBatch) {
+            flush();
+        }
+    });
+    flush();
+    return delivered;
+}
+
+void WebSocketHandlers::publish_presence_digest(const std::vector<PresenceChange>& changes) {
+    if (changes.empty()) {
+        return;
+    }
+
+    // Group changes by recipient so each online contact gets a single digest event
+    std::unordered_map<std::string, json> digests;
+    for (const auto& change : changes) {
+        json entry = {
+            {"user_id", change.user_id},
+            {"is_online", change.is_online},
+            {"timestamp", change.timestamp}
+        };
+
+        // Only online mutual contacts see this user's presence
+        auto recipients = connection_manager_->filter_online_users(contact_graph_->get_mutual_contacts(change.user_id));
+        for (const auto& recipient : recipients) {
+            auto [it, inserted] = digests.try_emplace(recipient, json::array());
+            it->second.push_back(entry);
+        }
+    }
+
+    for (const auto& [recipient, entries] : digests) {
+        json digest = {
+            {"type", "presence_digest"},
+            {"changes", entries},
+            {"timestamp", std::time(nullptr)}
+        };
+        send_message_to_user(recipient, digest);
+    }
+
+    presence_tracker_->record_delivery(digests.size());
+    LOG_INFO("Presence digest published: " + std::to_string(changes.size()) + " changes to " +
+             std::to_string(digests.size()) + " online contacts");
 }
 
 void WebSocketHandlers::send_json_response(httplib::Response& res, int status, const json& data) {
@@ -1,33 +1,160 @@
 #include "services/auth_service.h"
 #include "handlers/auth_handlers.h"
+#include "common/auth_middleware.h"
 #include "common/logger.h"
+#include <algorithm>
 
-AuthService::AuthService(const int port) : HttpService("AuthService", port) {
+AuthService::AuthService(int port, std::shared_ptr<ServiceContext> context, PasswordHasher::Options hashing_options)
+    : HttpService("AuthService", port) {
+    session_store_ = context->sessions;
+    password_hasher_ = std::make_shared<PasswordHasher>(hashing_options);
+    credential_store_ = std::make_shared<CredentialStore>(password_hasher_);
+    handlers_ = std::make_unique<AuthHandlers>(session_store_, credential_store_, password_hasher_,
+                                               context->user_manager);
+
+    // Login and register hold their HTTP thread while the hashing pool works (httplib can't finish
+    // a response later), and admission waiters hold one too. Running more of them than there are
+    // hashing threads only queues them in the hasher, so each route runs that many with as many
+    // waiting: 8 threads for both routes with the default 2 hashing threads. The gateway
+    // reserves room for these on top of its own pool. Requests past this point are shed.
+    auto credential_limits = AdmissionController::default_limits();
+    credential_limits.max_concurrency = hashing_options.threads;
+    credential_limits.min_concurrency = std::min(credential_limits.min_concurrency, hashing_options.threads);
+    credential_limits.max_queue = hashing_options.threads;
+    credential_limits.deadline = std::chrono::milliseconds(5000);
+    credential_limits.target_latency = std::chrono::milliseconds(2000);
+    limit_route("/api/auth/login", credential_limits);
+    limit_route("/api/auth/register", credential_limits);
+
+    // Slow down password guessing from a single address
+    limit_rate("/api/auth/login", {5.0, 10.0, false, true});
+    limit_rate("/api/auth/register", {1.0, 5.0, false, true});
+}
+
+std::vector<std::string> AuthService::route_prefixes() const {
+    return {"/api/auth"};
+}
+
+json AuthService::collect_metrics() {
+    json metrics = HttpService::collect_metrics();
+    metrics["token_cache"] = AuthMiddleware::get_token_cache_stats();
+    metrics["sessions"] = session_store_->get_stats();
+    metrics["password_hasher"] = password_hasher_->get_stats();
+    metrics["credentials"] = credential_store_->size();
+    return metrics;
 }
 
-void AuthService::setup_routes() {
-    auto& server = get_server();
+void AuthService::setup_routes(Router& router) {
 
     // Authentication endpoints
-    server.Post("/api/auth/login", [](const httplib::Request& req, httplib::Response& res) {
-        AuthHandlers::handle_login(req, res);
+    router.Post("/api/auth/login", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_login(req, res);
     });
 
-    server.Post("/api/auth/register", [](const httplib::Request& req, httplib::Response& res) {
-        AuthHandlers::handle_register(req, res);
+    router.Post("/api/auth/register", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_register(req, res);
     });
 
-    server.Post("/api/auth/verify", [](const httplib::Request& req, httplib::Response& res) {
-        AuthHandlers::handle_verify_token(req, res);
+    router.Post("/api/auth/verify", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_verify_token(req, res);
     });
 
-    server.Post("/api/auth/refresh", [](const httplib::Request& req, httplib::Response& res) {
-        AuthHandlers::handle_refresh_token(req, res);
+    router.Post("/api/auth/refresh", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_refresh_token(req, res);
     });
 
-    server.Post("/api/auth/logout", [](const httplib::Request& req, httplib::Response& res) {
-        AuthHandlers::handle_logout(req, res);
+    router.Post("/api/auth/logout", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_logout(req, res);
+    });
+
+    // Session management
+    router.Post("/api/auth/logout_all", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_logout_all(req, res);
+    });
+
+    router.Get("/api/auth/sessions", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_get_sessions(req, res);
     });
 
     LOG_INFO("Auth Service routes configured");
-}
\ No newline at end of file
+}
+
+bool AuthService::route_to_worker(const httplib::Request& req, httplib::Response& res) {
+    // Sessions live on the worker that created them (the id says which one); revocations
+    // have to reach every worker, since any of them may see the revoked access token
+    if (req.method == "POST" && req.path == "/api/auth/refresh") {
+        const json body = json::parse(req.body, nullptr, false);
+        if (!body.is_object() || !body.contains("refresh_token") || !body["refresh_token"].is_string()) {
+            return false;
+        }
+
+        const int owner = SessionStore::worker_of(body["refresh_token"].get<std::string>());
+        if (owner < 0 || owner >= WorkerCluster::worker_count() || owner == WorkerCluster::worker_index()) {
+            return false;
+        }
+
+        if (!WorkerCluster::forward(get_name(), owner, req, res)) {
+            send_error_response(res, 502, "Worker " + std::to_string(owner) + " is unavailable");
+        }
+        return true;
+    }
+
+    if (req.method == "POST" && (req.path == "/api/auth/logout" || req.path == "/api/auth/logout_all")) {
+        json merged;
+        size_t sessions_revoked = 0;
+        for (const auto& body : gather_from_workers(req)) {
+            if (body.is_object()) {
+                sessions_revoked += body.value("sessions_revoked", size_t{0});
+                if (merged.is_null()) {
+                    merged = body;
+                }
+            }
+        }
+
+        if (merged.is_null()) {
+            return false; // Let the local handler produce the error response
+        }
+        if (merged.contains("sessions_revoked")) {
+            merged["sessions_revoked"] = sessions_revoked;
+        }
+        send_json_response(res, 200, merged);
+        return true;
+    }
+
+    if (req.method == "GET" && req.path == "/api/auth/sessions") {
+        json sessions = json::array();
+        bool answered = false;
+        for (const auto& body : gather_from_workers(req)) {
+            if (body.is_object() && body.contains("sessions")) {
+                answered = true;
+                for (const auto& session : body["sessions"]) {
+                    sessions.push_back(session);
+                }
+            }
+        }
+
+        if (!answered) {
+            return false;
+        }
+
+        json response = {
+            {"sessions", sessions},
+            {"count", sessions.size()}
+        };
+        send_json_response(res, 200, response);
+        return true;
+    }
+
+    return HttpService::route_to_worker(req, res);
+}
+
+std::optional<std::string> AuthService::partition_key(const httplib::Request& req) {
+    // Credentials are partitioned by username
+    if (req.method == "POST" && (req.path == "/api/auth/login" || req.path == "/api/auth/register")) {
+        const json body = json::parse(req.body, nullptr, false);
+        if (body.is_object() && body.contains("username") && body["username"].is_string()) {
+            return body["username"].get<std::string>();
+        }
+    }
+    return std::nullopt;
+}
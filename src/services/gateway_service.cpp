@@ -0,0 +1,74 @@
+#include "services/gateway_service.h"
+#include "common/logger.h"
+#include <algorithm>
+
+GatewayService::GatewayService(int port, std::vector<HttpService*> services, size_t worker_threads)
+    : HttpService("Gateway", port), services_(std::move(services)) {
+    // Routes with their own limits (password hashing above all, which blocks its thread) get
+    // their slots and queues on top of the shared pool, so they can never take it over
+    size_t reserved_running = 0;
+    size_t reserved_waiting = 0;
+    for (auto* service : services_) {
+        for (const auto& prefix : service->route_prefixes()) {
+            prefixes_.emplace_back(prefix, service->get_name());
+        }
+        for (const auto& [prefix, route_limits] : service->route_limits()) {
+            limit_route(prefix, route_limits);
+            reserved_running += route_limits.max_concurrency;
+            reserved_waiting += route_limits.max_queue;
+        }
+        for (const auto& [prefix, policy] : service->rate_policies()) {
+            limit_rate(prefix, policy);
+        }
+        for (const auto& route : service->entity_tag_routes()) {
+            tag_route(route.pattern, route.tag);
+        }
+    }
+
+    // worker_threads requests run at once besides the reserved ones; as many again may wait for a
+    // slot. Every waiter holds a pool thread, so the pool covers both queues as well.
+    auto limits = AdmissionController::default_limits();
+    limits.max_concurrency = worker_threads + reserved_running;
+    limits.min_concurrency = std::min(limits.min_concurrency, worker_threads);
+    limits.max_queue = worker_threads;
+    set_admission_limits(limits);
+    set_worker_threads(limits.max_concurrency + limits.max_queue + reserved_waiting);
+
+    std::sort(prefixes_.begin(), prefixes_.end(), [](const auto& a, const auto& b) {
+        return a.first.size() > b.first.size();
+    });
+}
+
+void GatewayService::setup_routes(Router& router) {
+    for (auto* service : services_) {
+        service->register_routes(router);
+    }
+
+    LOG_INFO("Gateway routes configured: " + std::to_string(router.size()) + " routes from " +
+             std::to_string(services_.size()) + " services");
+}
+
+json GatewayService::collect_metrics() {
+    json metrics = HttpService::collect_metrics();
+
+    json services = json::array();
+    for (auto* service : services_) {
+        services.push_back(service->collect_metrics());
+    }
+    metrics["services"] = services;
+
+    return metrics;
+}
+
+bool GatewayService::handle_before_routing(const httplib::Request& req, httplib::Response& res) {
+    for (const auto& [prefix, service_name] : prefixes_) {
+        if (req.path.compare(0, prefix.size(), prefix) == 0 &&
+            (req.path.size() == prefix.size() || req.path[prefix.size()] == '/')) {
+            return false;
+        }
+    }
+
+    // No service owns this prefix: answer without walking the route table
+    send_error_response(res, 404, "No service handles " + req.path);
+    return true;
+}
@@ -1,34 +1,457 @@
 #include "services/message_service.h"
+#include "common/auth_middleware.h"
 #include "common/logger.h"
+#include "common/snowflake_id.h"
+#include <algorithm>
+#include <regex>
+#include <unordered_set>
 
-MessageService::MessageService(int port) : HttpService("MessageService", port) {
-    message_manager_ = std::make_shared<MessageManager>();
-    handlers_ = std::make_unique<MessageHandlers>(message_manager_);
+MessageService::MessageService(int port, std::shared_ptr<ServiceContext> context) : HttpService("MessageService", port) {
+    change_log_ = context->change_log;
+    search_index_ = std::make_shared<SearchIndex>();
+    message_manager_ = std::make_shared<MessageManager>(context->contact_graph, change_log_, search_index_);
+    content_filter_ = context->content_filter;
+    response_cache_ = std::make_shared<ResponseCache>();
+    idempotency_cache_ = std::make_shared<IdempotencyCache>();
+    handlers_ = std::make_unique<MessageHandlers>(message_manager_, context->user_manager, content_filter_,
+                                                  response_cache_);
+    // Sync spans conversations, profiles and presence; it lives here because conversations are most of it
+    sync_handlers_ = std::make_unique<SyncHandlers>(change_log_, message_manager_, context->user_manager,
+                                                    context->connection_manager);
+
+    // Conversation reads walk message history and, in multi-worker mode, gather from every worker
+    auto listing_limits = AdmissionController::default_limits();
+    listing_limits.max_concurrency = 4;
+    listing_limits.max_queue = 8;
+    limit_route("/api/conversations", listing_limits);
+
+    // Per sender, plus a looser per-address cap for clients sharing a NAT
+    limit_rate("/api/messages/send", {10.0, 20.0, true, false});
+    limit_rate("/api/messages/send", {50.0, 100.0, false, true});
+    // Batches also pass the /api/messages/send policies above; this caps them per sender on top
+    limit_rate("/api/messages/send_batch", {2.0, 5.0, true, false});
+    // Group sends and membership changes reach every member's reads
+    limit_rate("/api/groups", {10.0, 20.0, true, false});
+
+    // Pollers revalidate with If-None-Match; only state held entirely by this worker can be tagged
+    tag_route("/api/conversations", [manager = message_manager_](const httplib::Request& req,
+                                                                 const std::smatch&) -> std::optional<std::string> {
+        auto auth_result = AuthMiddleware::validate_token(req);
+        if (!auth_result.is_valid || WorkerCluster::is_enabled()) {
+            return std::nullopt;
+        }
+        return auth_result.username + "." + std::to_string(manager->user_version(auth_result.username));
+    });
+    tag_route("/api/conversations/(.*)/messages", [manager = message_manager_](const httplib::Request& req,
+                                                                               const std::smatch& match) -> std::optional<std::string> {
+        const std::string conv_id = match[1];
+        auto auth_result = AuthMiddleware::validate_token(req);
+        if (!auth_result.is_valid ||
+            (WorkerCluster::is_enabled() && MessageManager::owner_of(conv_id) != WorkerCluster::worker_index())) {
+            return std::nullopt;
+        }
+        auto version = manager->conversation_version(conv_id, auth_result.username);
+        if (!version) {
+            return std::nullopt;
+        }
+        return "c" + std::to_string(*version);
+    });
 }
 
-void MessageService::setup_routes() {
-    auto& server = get_server();
+std::vector<std::string> MessageService::route_prefixes() const {
+    return {"/api/messages", "/api/conversations", "/api/groups", "/api/sync"};
+}
+
+json MessageService::collect_metrics() {
+    json metrics = HttpService::collect_metrics();
+    // Shared with the websocket service, so its scans are counted here too
+    metrics["content_filter"] = content_filter_->get_stats();
+    metrics["response_cache"] = response_cache_->get_stats();
+    metrics["change_log"] = change_log_->get_stats();
+    metrics["search_index"] = search_index_->get_stats();
+    metrics["idempotency"] = idempotency_cache_->get_stats();
+    return metrics;
+}
+
+void MessageService::setup_routes(Router& router) {
 
     // Message endpoints
-    server.Post("/api/messages/send", [this](const httplib::Request& req, httplib::Response& res) {
-        handlers_->handle_send_message(req, res);
+    router.Post("/api/messages/send", [this](const httplib::Request& req, httplib::Response& res) {
+        run_idempotent(req, res, [this](const httplib::Request& req, httplib::Response& res) {
+            handlers_->handle_send_message(req, res);
+        });
     });
 
-    server.Get("/api/conversations", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/messages/send_batch", [this](const httplib::Request& req, httplib::Response& res) {
+        run_idempotent(req, res, [this](const httplib::Request& req, httplib::Response& res) {
+            handlers_->handle_send_batch(req, res);
+        });
+    });
+
+    router.Get("/api/conversations", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_get_conversations(req, res);
     });
 
-    server.Get("/api/conversations/(.*)/messages", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/conversations/(.*)/messages", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_get_messages(req, res);
     });
 
-    server.Put("/api/messages/(.*)/read", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/messages/unread", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_get_unread(req, res);
+    });
+
+    router.Get("/api/messages/search", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_search_messages(req, res);
+    });
+
+    router.Put("/api/messages/(.*)/read", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_mark_as_read(req, res);
     });
 
-    server.Delete("/api/messages/(.*)", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/conversations/(.*)/read_up_to", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_read_up_to(req, res);
+    });
+
+    router.Delete("/api/messages/(.*)", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_delete_message(req, res);
     });
 
+    // Group endpoints; reading messages and receipts goes through the conversation routes above
+    router.Post("/api/groups", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_create_group(req, res);
+    });
+
+    router.Get("/api/groups/(.*)/members", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_get_group_members(req, res);
+    });
+
+    router.Post("/api/groups/(.*)/members", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_add_group_members(req, res);
+    });
+
+    router.Post("/api/groups/(.*)/leave", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_leave_group(req, res);
+    });
+
+    router.Post("/api/groups/(.*)/messages", [this](const httplib::Request& req, httplib::Response& res) {
+        run_idempotent(req, res, [this](const httplib::Request& req, httplib::Response& res) {
+            handlers_->handle_send_group_message(req, res);
+        });
+    });
+
+    router.Get("/api/sync", [this](const httplib::Request& req, httplib::Response& res) {
+        sync_handlers_->handle_sync(req, res);
+    });
+
     LOG_INFO("Message Service routes configured");
-}
\ No newline at end of file
+}
+
+bool MessageService::route_to_worker(const httplib::Request& req, httplib::Response& res) {
+    // Conversations are partitioned by conversation id
+    static const std::regex conversation_messages_path(R"(^/api/conversations/(.+)/messages$)");
+    static const std::regex read_up_to_path(R"(^/api/conversations/(.+)/read_up_to$)");
+    static const std::regex group_path(R"(^/api/groups/([^/]+)/(members|leave|messages)$)");
+    static const std::regex message_path(R"(^/api/messages/([^/]+)(/read)?$)");
+
+    std::smatch match;
+
+    if (req.method == "GET" && req.path == "/api/conversations") {
+        // Every worker holds a slice of the user's conversations; keep each one from its owner
+        json conversations = json::array();
+        auto bodies = gather_from_workers(req);
+        for (size_t worker = 0; worker < bodies.size(); ++worker) {
+            if (!bodies[worker].is_object() || !bodies[worker].contains("conversations")) {
+                continue;
+            }
+            for (auto& conversation : bodies[worker]["conversations"]) {
+                if (MessageManager::owner_of(conversation.value("id", "")) == static_cast<int>(worker)) {
+                    conversations.push_back(std::move(conversation));
+                }
+            }
+        }
+
+        std::sort(conversations.begin(), conversations.end(), [](const json& a, const json& b) {
+            return a.value("last_activity", 0) > b.value("last_activity", 0);
+        });
+
+        json response = {
+            {"conversations", conversations},
+            {"total", conversations.size()}
+        };
+        send_json_response(res, 200, response);
+        return true;
+    }
+
+    if (req.method == "GET" && req.path == "/api/messages/unread") {
+        if (!AuthMiddleware::validate_token(req).is_valid) {
+            return false; // Let the local handler produce the error response
+        }
+
+        // Each worker counts only the conversations it owns, so the totals add up
+        size_t total = 0;
+        json conversations = json::object();
+        for (auto& body : gather_from_workers(req)) {
+            if (!body.is_object() || !body.contains("conversations")) {
+                continue;
+            }
+            total += body.value("total", size_t{0});
+            for (auto& [conv_id, unread] : body["conversations"].items()) {
+                conversations[conv_id] = std::move(unread);
+            }
+        }
+
+        json response = {
+            {"total", total},
+            {"conversations", conversations}
+        };
+        send_json_response(res, 200, response);
+        return true;
+    }
+
+    if (req.method == "GET" && req.path == "/api/messages/search") {
+        return gather_search(req, res);
+    }
+
+    if (req.method == "GET" && req.path == "/api/sync") {
+        if (!AuthMiddleware::validate_token(req).is_valid) {
+            return false; // Let the local handler produce the error response
+        }
+        gather_sync(req, res);
+        return true;
+    }
+
+    if (req.method == "GET" && std::regex_match(req.path, match, conversation_messages_path)) {
+        return forward_to_worker(MessageManager::owner_of(match[1]), req, res);
+    }
+
+    if (req.method == "POST" && std::regex_match(req.path, match, read_up_to_path)) {
+        return forward_to_worker(MessageManager::owner_of(match[1]), req, res);
+    }
+
+    // A group lives where it was created (POST /api/groups stays local), and its id says where that was
+    if (std::regex_match(req.path, match, group_path)) {
+        return forward_to_worker(MessageManager::owner_of(match[1]), req, res);
+    }
+
+    if (req.method == "POST" && (req.path == "/api/messages/send" || req.path == "/api/messages/send_batch")) {
+        auto auth_result = AuthMiddleware::validate_token(req);
+        auto body = json::parse(req.body, nullptr, false);
+        if (!auth_result.is_valid || !body.is_object() || !body.contains("to_user") || !body["to_user"].is_string()) {
+            return false; // Let the local handler produce the error response
+        }
+        return forward_to_owner(MessageManager::get_conversation_id(auth_result.username, body["to_user"]), req, res);
+    }
+
+    // Message ids are issued by the worker that owns the conversation and say which one that was
+    if ((req.method == "PUT" || req.method == "DELETE") && std::regex_match(req.path, match, message_path)) {
+        auto id = SnowflakeId::parse(match[1].str());
+        return id && forward_to_worker(static_cast<int>(SnowflakeId::node_of(*id)), req, res);
+    }
+
+    return false;
+}
+
+void MessageService::run_idempotent(const httplib::Request& req, httplib::Response& res,
+                                    const std::function<void(const httplib::Request&, httplib::Response&)>& handler) {
+    static constexpr size_t kMaxKeyLength = 255;
+
+    const std::string key = req.get_header_value("Idempotency-Key");
+    if (key.empty()) {
+        handler(req, res);
+        return;
+    }
+    if (key.size() > kMaxKeyLength) {
+        send_error_response(res, 400, "Idempotency-Key must be at most " + std::to_string(kMaxKeyLength) + " characters");
+        return;
+    }
+
+    auto auth_result = AuthMiddleware::validate_token(req);
+    if (!auth_result.is_valid) {
+        handler(req, res); // Nothing to remember; the handler answers 401
+        return;
+    }
+
+    // Sends reach the conversation's owner before routing, so every retry lands on this cache
+    const uint64_t fingerprint = std::hash<std::string>{}(req.path + "\n" + req.body);
+    auto claim = idempotency_cache_->claim(auth_result.username, key, fingerprint, std::time(nullptr));
+    switch (claim.kind) {
+    case IdempotencyCache::Claim::Kind::Replay:
+        res.status = claim.response.status;
+        res.set_content(claim.response.body, claim.response.content_type);
+        res.set_header("Idempotent-Replayed", "true");
+        return;
+    case IdempotencyCache::Claim::Kind::Mismatch:
+        send_error_response(res, 422, "Idempotency-Key was already used for a different request");
+        return;
+    case IdempotencyCache::Claim::Kind::Busy:
+        send_error_response(res, 409, "A request with this Idempotency-Key is still in progress");
+        return;
+    case IdempotencyCache::Claim::Kind::Owner:
+        break;
+    }
+
+    try {
+        handler(req, res);
+    } catch (...) {
+        idempotency_cache_->abandon(auth_result.username, key);
+        throw;
+    }
+
+    // Server errors may not have written anything, so a retry should run again
+    if (res.status >= 500) {
+        idempotency_cache_->abandon(auth_result.username, key);
+    } else {
+        idempotency_cache_->complete(auth_result.username, key,
+                                     {res.status, res.body, res.get_header_value("Content-Type")});
+    }
+}
+
+bool MessageService::gather_search(const httplib::Request& req, httplib::Response& res) {
+    size_t offset = 0;
+    size_t limit = 0;
+    if (!AuthMiddleware::validate_token(req).is_valid || !MessageHandlers::parse_search_page(req, offset, limit)) {
+        return false; // Let the local handler produce the error response
+    }
+
+    // Every worker ranks its own conversations, so each is asked for everything up to the end of the page
+    httplib::Request prefix = req;
+    prefix.params.erase("offset");
+    prefix.params.erase("limit");
+    prefix.params.emplace("limit", std::to_string(offset + limit));
+
+    json results = json::array();
+    json failed_workers = json::array();
+    size_t total = 0;
+    for (auto& gathered : WorkerCluster::gather(get_name(), prefix)) {
+        const auto& status = gathered.response.status;
+        // A rejected query is rejected the same way everywhere; the client gets it as is
+        if (gathered.ok && status >= 400 && status < 500) {
+            res.status = status;
+            res.set_content(gathered.response.body, "application/json");
+            return true;
+        }
+        auto body = gathered.ok && status == 200 ? json::parse(gathered.response.body, nullptr, false) : json();
+        if (!body.is_object() || !body.contains("results")) {
+            failed_workers.push_back(gathered.worker);
+            continue;
+        }
+        total += body.value("total", size_t{0});
+        for (auto& result : body["results"]) {
+            results.push_back(std::move(result));
+        }
+    }
+
+    // Scores use each worker's own term statistics, so ranking across workers is approximate
+    std::stable_sort(results.begin(), results.end(), [](const json& a, const json& b) {
+        return a.value("score", 0.0) > b.value("score", 0.0);
+    });
+    json page = json::array();
+    for (size_t i = offset; i < results.size() && page.size() < limit; ++i) {
+        page.push_back(std::move(results[i]));
+    }
+
+    if (failed_workers.size() == static_cast<size_t>(WorkerCluster::worker_count())) {
+        send_error_response(res, 502, "No worker could run the search");
+        return true;
+    }
+
+    json response = {
+        {"query", req.get_param_value("q")},
+        {"results", page},
+        {"total", total},
+        {"offset", offset},
+        {"limit", limit}
+    };
+    // Conversations held by a worker that didn't answer are missing from the page and the total
+    if (!failed_workers.empty()) {
+        response["partial"] = true;
+        response["failed_workers"] = failed_workers;
+        LOG_WARNING("[" + get_name() + "] Search answered without workers " + failed_workers.dump());
+    }
+    send_json_response(res, 200, response);
+    return true;
+}
+
+void MessageService::gather_sync(const httplib::Request& req, httplib::Response& res) {
+    // Each worker logs the changes it made and reads its own part of the cursor
+    auto bodies = gather_from_workers(req);
+
+    // A snapshot from one worker can't be combined with deltas from the others
+    const bool full = std::any_of(bodies.begin(), bodies.end(), [](const json& body) {
+        return !body.is_object() || body.value("full", true);
+    });
+    if (full && req.has_param("since")) {
+        httplib::Request fresh = req;
+        fresh.params.erase("since");
+        bodies = gather_from_workers(fresh);
+    }
+
+    std::vector<std::string> cursors;
+    json changes = json::array();
+    json conversations = json::array();
+    json users = json::array();
+    json online_users = json::array();
+    // Profiles are reported by their owner, but one that exists on several workers (or a user
+    // connected to more than one) must still be listed once
+    std::unordered_set<std::string> seen_users;
+    std::unordered_set<std::string> seen_online;
+
+    for (size_t worker = 0; worker < bodies.size(); ++worker) {
+        auto& body = bodies[worker];
+        if (!body.is_object() || !body.contains("cursor")) {
+            send_error_response(res, 502, "Worker " + std::to_string(worker) + " is unavailable");
+            return;
+        }
+
+        cursors.push_back(body["cursor"].get<std::string>());
+        for (auto& change : body["changes"]) {
+            changes.push_back(std::move(change));
+        }
+        if (full && body.contains("snapshot")) {
+            auto& snapshot = body["snapshot"];
+            for (auto& conversation : snapshot["conversations"]) {
+                conversations.push_back(std::move(conversation));
+            }
+            for (auto& user : snapshot["users"]) {
+                if (seen_users.insert(user.value("username", "")).second) {
+                    users.push_back(std::move(user));
+                }
+            }
+            for (auto& user_id : snapshot["online_users"]) {
+                if (user_id.is_string() && seen_online.insert(user_id.get<std::string>()).second) {
+                    online_users.push_back(std::move(user_id));
+                }
+            }
+        }
+    }
+
+    // Sequences are per worker, so interleave by time; each worker's own order is preserved
+    std::stable_sort(changes.begin(), changes.end(), [](const json& a, const json& b) {
+        return a.value("timestamp", 0) < b.value("timestamp", 0);
+    });
+
+    std::string cursor;
+    for (const auto& part : cursors) {
+        if (!cursor.empty()) {
+            cursor += SyncHandlers::kCursorSeparator;
+        }
+        cursor += part;
+    }
+
+    json response = {
+        {"cursor", cursor},
+        {"full", full},
+        {"changes", changes}
+    };
+    if (full) {
+        std::sort(conversations.begin(), conversations.end(), [](const json& a, const json& b) {
+            return a.value("last_activity", 0) > b.value("last_activity", 0);
+        });
+        response["snapshot"] = {
+            {"conversations", conversations},
+            {"users", users},
+            {"online_users", online_users}
+        };
+    }
+    send_json_response(res, 200, response);
+}
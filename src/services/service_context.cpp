@@ -0,0 +1,22 @@
+#include "services/service_context.h"
+#include "common/auth_middleware.h"
+#include "common/worker_cluster.h"
+
+ServiceContext::ServiceContext(std::chrono::milliseconds presence_grace_period)
+    : user_ids(std::make_shared<UserIdInterner>()),
+      contact_graph(std::make_shared<ContactGraph>(user_ids)),
+      connection_manager(std::make_shared<ConnectionManager>(user_ids)),
+      presence_tracker(std::make_shared<PresenceTracker>(presence_grace_period)),
+      sessions(std::make_shared<SessionStore>(WorkerCluster::worker_index(), AuthMiddleware::kAccessTokenTtlSeconds)),
+      content_filter(std::make_shared<ContentFilter>()),
+      change_log(std::make_shared<ChangeLog>()),
+      user_manager(std::make_shared<UserManager>(connection_manager, change_log)) {
+    // Every connection transition, whichever service caused it, feeds the presence state machine
+    connection_manager->set_presence_listener(
+        [tracker = presence_tracker](const std::string& user_id, bool is_connected) {
+            tracker->on_connection_state(user_id, is_connected);
+        });
+
+    // Every service authenticates through AuthMiddleware, so one store makes a logout visible to all
+    AuthMiddleware::set_session_store(sessions);
+}
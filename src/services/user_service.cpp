@@ -1,34 +1,175 @@
 #include "services/user_service.h"
+#include "common/auth_middleware.h"
 #include "common/logger.h"
 
-UserService::UserService(int port) : HttpService("UserService", port) {
-    user_manager_ = std::make_shared<UserManager>();
-    handlers_ = std::make_unique<UserHandlers>(user_manager_);
+UserService::UserService(int port, std::shared_ptr<ServiceContext> context) : HttpService("UserService", port) {
+    user_manager_ = context->user_manager;
+    response_cache_ = std::make_shared<ResponseCache>();
+    handlers_ = std::make_unique<UserHandlers>(user_manager_, context->connection_manager, context->contact_graph,
+                                               response_cache_);
+
+    // The listing leaves out the caller and shows presence, so it changes with either counter
+    tag_route("/api/users", [users = user_manager_, connections = context->connection_manager](
+                                const httplib::Request& req, const std::smatch&) -> std::optional<std::string> {
+        auto auth_result = AuthMiddleware::validate_token(req);
+        if (!auth_result.is_valid || WorkerCluster::is_enabled()) {
+            return std::nullopt;
+        }
+        return auth_result.username + "." + std::to_string(users->version()) + "." +
+               std::to_string(connections->version());
+    });
 }
 
-void UserService::setup_routes() {
-    auto& server = get_server();
+json UserService::collect_metrics() {
+    json metrics = HttpService::collect_metrics();
+    metrics["response_cache"] = response_cache_->get_stats();
+    return metrics;
+}
+
+std::vector<std::string> UserService::route_prefixes() const {
+    return {"/api/users"};
+}
+
+void UserService::setup_routes(Router& router) {
 
     // User management endpoints
-    server.Get("/api/users/profile", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/users/profile", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_get_user(req, res);
     });
 
-    server.Put("/api/users/profile", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Put("/api/users/profile", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_update_user(req, res);
     });
 
-    server.Get("/api/users", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/users", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_get_users(req, res);
     });
 
-    server.Get("/api/users/search", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/users/search", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_search_users(req, res);
     });
 
-    server.Post("/api/users/status", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/users/status", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_set_online_status(req, res);
     });
 
+    router.Get("/api/users/contacts", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_get_contacts(req, res);
+    });
+
+    router.Post("/api/users/contacts", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_add_contact(req, res);
+    });
+
+    router.Post("/api/users/presence", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_get_presence(req, res);
+    });
+
     LOG_INFO("User Service routes configured");
-}
\ No newline at end of file
+}
+
+void UserService::setup_internal_routes(Router& router) {
+    // Existence check for usernames this worker owns, e.g. new group members
+    router.Post("/internal/users/unknown", [this](const httplib::Request& req, httplib::Response& res) {
+        const json body = json::parse(req.body, nullptr, false);
+        if (!body.is_object() || !body.contains("usernames") || !body["usernames"].is_array()) {
+            send_error_response(res, 400, "Expected usernames");
+            return;
+        }
+
+        std::vector<std::string> usernames;
+        for (const auto& username : body["usernames"]) {
+            if (username.is_string()) {
+                usernames.push_back(username.get<std::string>());
+            }
+        }
+
+        json unknown = json::array();
+        const auto users = user_manager_->get_users(usernames);
+        for (size_t i = 0; i < users.size(); ++i) {
+            if (!users[i]) {
+                unknown.push_back(usernames[i]);
+            }
+        }
+        send_json_response(res, 200, {{"unknown", unknown}});
+    });
+}
+
+bool UserService::route_to_worker(const httplib::Request& req, httplib::Response& res) {
+    // Users are partitioned by username, the same key the WebSocket service uses for their
+    // connections, so a user's profile and presence always live on the same worker
+    if (req.method == "GET" && (req.path == "/api/users" || req.path == "/api/users/search")) {
+        const std::string list_key = req.path == "/api/users" ? "users" : "results";
+
+        json users = json::array();
+        auto bodies = gather_from_workers(req);
+        for (size_t worker = 0; worker < bodies.size(); ++worker) {
+            if (!bodies[worker].is_object() || !bodies[worker].contains(list_key)) {
+                continue;
+            }
+            for (auto& user : bodies[worker][list_key]) {
+                if (WorkerCluster::owner_of(user.value("username", "")) == static_cast<int>(worker)) {
+                    users.push_back(std::move(user));
+                }
+            }
+        }
+
+        json response = {
+            {list_key, users},
+            {"total", users.size()}
+        };
+        if (list_key == "results") {
+            response["query"] = req.get_param_value("q");
+        }
+        send_json_response(res, 200, response);
+        return true;
+    }
+
+    if (req.method == "POST" && req.path == "/api/users/presence") {
+        // Only the owner of a user has their connections; merge the per-worker answers
+        auto bodies = gather_from_workers(req);
+        json merged;
+        for (const auto& body : bodies) {
+            if (!body.is_object() || !body.contains("presence")) {
+                continue;
+            }
+            if (merged.is_null()) {
+                merged = body;
+                continue;
+            }
+            for (size_t i = 0; i < merged["presence"].size() && i < body["presence"].size(); ++i) {
+                auto& entry = merged["presence"][i];
+                const auto& other = body["presence"][i];
+                entry["is_online"] = entry["is_online"].get<bool>() || other["is_online"].get<bool>();
+                if (other.contains("last_seen") &&
+                    (!entry.contains("last_seen") || other["last_seen"] > entry["last_seen"])) {
+                    entry["last_seen"] = other["last_seen"];
+                }
+            }
+        }
+
+        if (merged.is_null()) {
+            return false; // Let the local handler produce the error response
+        }
+
+        size_t online = 0;
+        for (const auto& entry : merged["presence"]) {
+            online += entry["is_online"].get<bool>() ? 1 : 0;
+        }
+        merged["online"] = online;
+        send_json_response(res, 200, merged);
+        return true;
+    }
+
+    return HttpService::route_to_worker(req, res);
+}
+
+std::optional<std::string> UserService::partition_key(const httplib::Request& req) {
+    if (req.path == "/api/users/profile" || req.path == "/api/users/status" || req.path == "/api/users/contacts") {
+        auto auth_result = AuthMiddleware::validate_token(req);
+        if (auth_result.is_valid) {
+            return auth_result.username;
+        }
+    }
+    return std::nullopt;
+}
@@ -1,11 +1,42 @@
 #include "services/websocket_service.h"
+#include "common/auth_middleware.h"
 #include "common/logger.h"
+#include "common/snowflake_id.h"
+#include <regex>
+#include <set>
 #include <chrono>
 
-WebSocketService::WebSocketService(int port)
+WebSocketService::WebSocketService(int port, std::shared_ptr<ServiceContext> context)
     : HttpService("WebSocketService", port), should_cleanup_(false) {
-    connection_manager_ = std::make_shared<ConnectionManager>();
-    handlers_ = std::make_unique<WebSocketHandlers>(connection_manager_);
+    connection_manager_ = context->connection_manager;
+    contact_graph_ = context->contact_graph;
+    presence_tracker_ = context->presence_tracker;
+    change_log_ = context->change_log;
+    response_cache_ = std::make_shared<ResponseCache>();
+    channel_manager_ = std::make_shared<ChannelManager>(context->user_ids);
+    handlers_ = std::make_unique<WebSocketHandlers>(connection_manager_, contact_graph_, presence_tracker_,
+                                                    context->content_filter, response_cache_, channel_manager_,
+                                                    context->user_ids);
+
+    // Broadcast fans out to every connection, so it gets a much smaller budget than direct sends
+    limit_rate("/api/websocket/send", {20.0, 40.0, true, true});
+    limit_rate("/api/websocket/broadcast", {1.0, 3.0, true, true});
+    // A publish can reach as many users as a broadcast; subscribing is cheap but shares the budget
+    limit_rate("/api/channels", {2.0, 10.0, true, true});
+
+    // A user's connections live on one worker, their contacts on others; the digest worker needs
+    // the whole roster to find them, and the contacts' workers need it to check the edge back
+    if (WorkerCluster::is_enabled()) {
+        contact_graph_->track_new_links();
+    }
+
+    tag_route("/api/websocket/online", [connections = connection_manager_](
+                                           const httplib::Request&, const std::smatch&) -> std::optional<std::string> {
+        if (WorkerCluster::is_enabled()) {
+            return std::nullopt;
+        }
+        return "o" + std::to_string(connections->version());
+    });
 }
 
 WebSocketService::~WebSocketService() {
@@ -15,41 +46,122 @@ WebSocketService::~WebSocketService() {
     }
 }
 
-void WebSocketService::setup_routes() {
-    auto& server = get_server();
+std::vector<std::string> WebSocketService::route_prefixes() const {
+    return {"/api/websocket", "/api/channels"};
+}
+
+json WebSocketService::collect_metrics() {
+    json metrics = HttpService::collect_metrics();
+    metrics["response_cache"] = response_cache_->get_stats();
+    metrics["channels"] = channel_manager_->get_stats();
+    return metrics;
+}
+
+void WebSocketService::setup_routes(Router& router) {
 
     // WebSocket management endpoints
-    server.Get("/api/websocket/stats", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/websocket/stats", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_get_stats(req, res);
     });
 
-    server.Get("/api/websocket/online", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Get("/api/websocket/online", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_get_online_users(req, res);
     });
 
-    server.Post("/api/websocket/connect", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/websocket/connect", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_connect_user(req, res);
     });
 
-    server.Post("/api/websocket/send", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/websocket/send", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_send_message(req, res);
     });
 
-    server.Post("/api/websocket/broadcast", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/websocket/broadcast", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_broadcast_message(req, res);
     });
 
-    server.Post("/api/websocket/disconnect", [this](const httplib::Request& req, httplib::Response& res) {
+    router.Post("/api/websocket/disconnect", [this](const httplib::Request& req, httplib::Response& res) {
         handlers_->handle_disconnect_user(req, res);
     });
 
+    // Channel endpoints
+    router.Post("/api/channels", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_create_channel(req, res);
+    });
+
+    router.Get("/api/channels", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_list_channels(req, res);
+    });
+
+    router.Post("/api/channels/(.*)/subscribe", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_subscribe(req, res);
+    });
+
+    router.Post("/api/channels/(.*)/unsubscribe", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_unsubscribe(req, res);
+    });
+
+    router.Post("/api/channels/(.*)/publish", [this](const httplib::Request& req, httplib::Response& res) {
+        handlers_->handle_publish(req, res);
+    });
+
     LOG_INFO("WebSocket Service routes configured");
 }
 
+void WebSocketService::setup_internal_routes(Router& router) {
+    router.Post("/internal/contacts", [this](const httplib::Request& req, httplib::Response& res) {
+        const json body = json::parse(req.body, nullptr, false);
+        if (!body.is_object() || !body.contains("links") || !body["links"].is_array()) {
+            send_error_response(res, 400, "Expected links");
+            return;
+        }
+
+        std::vector<ContactGraph::Link> links;
+        for (const auto& link : body["links"]) {
+            if (link.is_array() && link.size() == 2 && link[0].is_string() && link[1].is_string()) {
+                links.emplace_back(link[0].get<std::string>(), link[1].get<std::string>());
+            }
+        }
+        contact_graph_->apply_links(links);
+        send_json_response(res, 200, {{"applied", links.size()}});
+    });
+
+    // A digest from the worker holding these users' connections, for the contacts connected here
+    router.Post("/internal/presence", [this](const httplib::Request& req, httplib::Response& res) {
+        const json body = json::parse(req.body, nullptr, false);
+        if (!body.is_object() || !body.contains("changes") || !body["changes"].is_array()) {
+            send_error_response(res, 400, "Expected changes");
+            return;
+        }
+
+        std::vector<PresenceChange> changes;
+        for (const auto& change : body["changes"]) {
+            if (change.is_object() && change.contains("user_id") && change["user_id"].is_string()) {
+                changes.push_back({change["user_id"].get<std::string>(), change.value("is_online", false),
+                                   change.value("timestamp", std::time_t{0})});
+            }
+        }
+        handlers_->publish_presence_digest(changes);
+        send_json_response(res, 200, {{"received", changes.size()}});
+    });
+}
+
+bool WebSocketService::replicate_to_workers(const httplib::Request& req, httplib::Response& res) {
+    // Applied on every worker; the first one that answers speaks for all of them
+    for (auto& gathered : WorkerCluster::gather(get_name(), req)) {
+        if (gathered.ok) {
+            res.status = gathered.response.status;
+            res.set_content(gathered.response.body, "application/json");
+            return true;
+        }
+    }
+    return false; // Let the local handler produce the error response
+}
+
 void WebSocketService::on_start() {
     HttpService::on_start();
 
-    // Start cleanup thread
+    // Start cleanup and presence digest thread
     should_cleanup_ = true;
     cleanup_thread_ = std::thread(&WebSocketService::cleanup_worker, this);
     LOG_INFO("WebSocket cleanup thread started");
@@ -66,8 +178,204 @@ void WebSocketService::on_stop() {
 }
 
 void WebSocketService::cleanup_worker() {
+    auto next_cleanup = std::chrono::steady_clock::now();
+
     while (should_cleanup_) {
-        connection_manager_->cleanup_inactive_connections();
-        std::this_thread::sleep_for(std::chrono::seconds(30)); // Cleanup every 30 seconds
+        if (std::chrono::steady_clock::now() >= next_cleanup) {
+            connection_manager_->cleanup_inactive_connections();
+            next_cleanup += kCleanupInterval;
+        }
+
+        // Flush coalesced presence changes once per digest interval; syncing clients get the same
+        // debounced transitions
+        auto changes = presence_tracker_->collect_digest();
+        for (const auto& change : changes) {
+            change_log_->append_shared("presence", {
+                {"user_id", change.user_id},
+                {"is_online", change.is_online},
+                {"timestamp", change.timestamp}
+            });
+        }
+        handlers_->publish_presence_digest(changes);
+        if (WorkerCluster::is_enabled()) {
+            share_with_workers(changes);
+        }
+        std::this_thread::sleep_for(kPresenceDigestInterval);
+    }
+}
+
+void WebSocketService::share_with_workers(const std::vector<PresenceChange>& changes) {
+    // Edges first, so a peer already knows a brand-new contact when the digest naming them arrives
+    const auto links = contact_graph_->take_new_links();
+    if (!links.empty()) {
+        httplib::Request req;
+        req.method = "POST";
+        req.path = "/internal/contacts";
+        req.body = json{{"links", links}}.dump();
+        req.set_header("Content-Type", "application/json");
+        const size_t delivered = WorkerCluster::notify_peers(get_name(), req);
+        if (delivered + 1 < static_cast<size_t>(WorkerCluster::worker_count())) {
+            LOG_WARNING(std::to_string(links.size()) + " contact links reached only " +
+                        std::to_string(delivered) + " other workers");
+        }
+    }
+
+    if (changes.empty()) {
+        return;
+    }
+
+    json entries = json::array();
+    for (const auto& change : changes) {
+        entries.push_back({
+            {"user_id", change.user_id},
+            {"is_online", change.is_online},
+            {"timestamp", change.timestamp}
+        });
+    }
+    httplib::Request req;
+    req.method = "POST";
+    req.path = "/internal/presence";
+    req.body = json{{"changes", entries}}.dump();
+    req.set_header("Content-Type", "application/json");
+    WorkerCluster::notify_peers(get_name(), req);
+}
+
+bool WebSocketService::route_to_worker(const httplib::Request& req, httplib::Response& res) {
+    // Connections are partitioned by user id; channels and their subscribers are replicated, and each
+    // worker delivers a publish to the subscribers connected to it
+    static const std::regex subscription_path(R"(^/api/channels/[^/]+/(un)?subscribe$)");
+    static const std::regex publish_path(R"(^/api/channels/[^/]+/publish$)");
+
+    if (req.method == "GET" && req.path == "/api/websocket/online") {
+        std::set<std::string> online_users;
+        for (const auto& body : gather_from_workers(req)) {
+            if (body.is_object() && body.contains("online_users")) {
+                for (const auto& user_id : body["online_users"]) {
+                    online_users.insert(user_id.get<std::string>());
+                }
+            }
+        }
+
+        json response = {
+            {"online_users", online_users},
+            {"count", online_users.size()},
+            {"timestamp", std::time(nullptr)}
+        };
+        send_json_response(res, 200, response);
+        return true;
+    }
+
+    if (req.method == "GET" && req.path == "/api/websocket/stats") {
+        size_t total_connections = 0;
+        size_t active_users = 0;
+        json workers = json::array();
+        for (const auto& body : gather_from_workers(req)) {
+            if (body.is_object()) {
+                total_connections += body.value("total_connections", size_t{0});
+                active_users += body.value("active_users", size_t{0});
+            }
+            workers.push_back(body);
+        }
+
+        json response = {
+            {"total_connections", total_connections},
+            {"active_users", active_users},
+            {"workers", workers},
+            {"timestamp", std::time(nullptr)}
+        };
+        send_json_response(res, 200, response);
+        return true;
+    }
+
+    if (req.method == "POST" && req.path == "/api/websocket/broadcast") {
+        // Each worker delivers to the users connected to it
+        size_t sent_to = 0;
+        json first;
+        for (const auto& body : gather_from_workers(req)) {
+            if (body.is_object() && body.contains("sent_to")) {
+                sent_to += body["sent_to"].get<size_t>();
+                if (first.is_null()) {
+                    first = body;
+                }
+            }
+        }
+
+        if (first.is_null()) {
+            return false; // Let the local handler produce the error response
+        }
+        first["sent_to"] = sent_to;
+        send_json_response(res, 200, first);
+        return true;
+    }
+
+    if (req.method == "POST" && (req.path == "/api/channels" || std::regex_match(req.path, subscription_path))) {
+        // Channels and their subscriptions are registered on every worker, which all answer alike
+        return replicate_to_workers(req, res);
+    }
+
+    if (req.method == "GET" && req.path == "/api/channels") {
+        // Every worker holds the same channels and subscribers
+        for (auto& body : gather_from_workers(req)) {
+            if (body.is_object() && body.contains("channels")) {
+                send_json_response(res, 200, body);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (req.method == "POST" && std::regex_match(req.path, publish_path)) {
+        // Each worker delivers to the subscribers connected to it
+        size_t delivered = 0;
+        json first;
+        for (const auto& body : gather_from_workers(req)) {
+            if (body.is_object() && body.contains("delivered")) {
+                delivered += body.value("delivered", size_t{0});
+                if (first.is_null()) {
+                    first = body;
+                }
+            }
+        }
+
+        if (first.is_null()) {
+            return false; // Let the local handler produce the error response
+        }
+        first["delivered"] = delivered;
+        send_json_response(res, 200, first);
+        return true;
     }
-}
\ No newline at end of file
+
+    if (req.method == "POST" && req.path == "/api/websocket/connect") {
+        std::string user_id = req.get_param_value("user_id");
+        if (user_id.empty()) {
+            auto body = json::parse(req.body, nullptr, false);
+            if (body.is_object() && body.contains("user_id") && body["user_id"].is_string()) {
+                user_id = body["user_id"];
+            }
+        }
+        if (user_id.empty()) {
+            user_id = AuthMiddleware::validate_token(req).username;
+        }
+        return !user_id.empty() && forward_to_owner(user_id, req, res);
+    }
+
+    if (req.method == "POST" && req.path == "/api/websocket/disconnect") {
+        std::string user_id = req.get_param_value("user_id");
+        if (!user_id.empty()) {
+            return forward_to_owner(user_id, req, res);
+        }
+        // Connection ids name the worker that holds the connection
+        auto id = SnowflakeId::parse(req.get_param_value("connection_id"));
+        return id && forward_to_worker(static_cast<int>(SnowflakeId::node_of(*id)), req, res);
+    }
+
+    if (req.method == "POST" && req.path == "/api/websocket/send") {
+        // Deliver on the worker that holds the recipient's connections
+        auto body = json::parse(req.body, nullptr, false);
+        if (body.is_object() && body.contains("to_user") && body["to_user"].is_string()) {
+            return forward_to_owner(body["to_user"], req, res);
+        }
+    }
+
+    return false;
+}
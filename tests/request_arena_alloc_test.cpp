@@ -0,0 +1,161 @@
+// Counts heap allocations per request with the global operator new replaced,
+// calling the message handlers directly: inside a RequestArena::Scope (as the
+// router runs them) and without one. The arena has to keep the heap out of
+// response building, so the scoped requests must stay far below the unscoped
+// ones and under a fixed ceiling however long the response is.
+#include "common/auth_middleware.h"
+#include "common/content_filter.h"
+#include "common/request_arena.h"
+#include "common/response_cache.h"
+#include "common/token_signer.h"
+#include "data/connection_manager.h"
+#include "data/message_manager.h"
+#include "data/user_manager.h"
+#include "handlers/message_handlers.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <regex>
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+std::atomic<bool> counting{false};
+
+// Out of line so the compiler doesn't pair the free() below with the operator new it sees
+[[gnu::noinline]] void* allocate(size_t size, size_t alignment) {
+    if (counting.load(std::memory_order_relaxed)) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    size = size == 0 ? 1 : size;
+    void* pointer = alignment <= alignof(std::max_align_t)
+        ? std::malloc(size)
+        : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+[[gnu::noinline]] void release(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+} // namespace
+
+// Both forms count: outside a scope the arena allocators fall back to the default pmr resource,
+// which uses the aligned one
+void* operator new(size_t size) {
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+    release(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    release(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    release(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    release(pointer);
+}
+
+namespace {
+
+constexpr int kWarmup = 3;
+constexpr int kRepetitions = 50;
+constexpr size_t kHistoryLength = 200;
+constexpr size_t kConversations = 50;
+
+double allocations_per_request(bool in_arena, const std::function<void()>& request) {
+    auto run = [&] {
+        if (in_arena) {
+            RequestArena::Scope scope;
+            request();
+        } else {
+            request();
+        }
+    };
+
+    // Warm-up fills the token cache and the arena's initial block
+    for (int i = 0; i < kWarmup; ++i) {
+        run();
+    }
+    allocations = 0;
+    counting = true;
+    for (int i = 0; i < kRepetitions; ++i) {
+        run();
+    }
+    counting = false;
+    return static_cast<double>(allocations.load()) / kRepetitions;
+}
+
+} // namespace
+
+int main() {
+    TokenSigner::instance().add_key("test", "request-arena-test-key");
+
+    auto message_manager = std::make_shared<MessageManager>();
+    for (size_t i = 0; i < kHistoryLength; ++i) {
+        const bool from_alice = i % 2 == 0;
+        message_manager->send_message(from_alice ? "alice" : "bob", from_alice ? "bob" : "alice",
+                                      "Message number " + std::to_string(i) +
+                                      " with enough text to leave the small-string buffer");
+    }
+    for (size_t i = 0; i < kConversations; ++i) {
+        message_manager->send_message("contact" + std::to_string(i), "alice", "Hello from contact " + std::to_string(i));
+    }
+    auto user_manager = std::make_shared<UserManager>(std::make_shared<ConnectionManager>());
+    // No room to cache anything: every request builds its response
+    MessageHandlers handlers(message_manager, user_manager, std::make_shared<ContentFilter>(),
+                             std::make_shared<ResponseCache>(0));
+
+    const std::string authorization = "Bearer " + AuthMiddleware::generate_jwt_token("alice", "");
+    const std::string conversation_id = MessageManager::get_conversation_id("alice", "bob");
+    const std::regex messages_path("/api/conversations/(.*)/messages");
+
+    struct Case {
+        const char* name;
+        std::function<void()> request;
+        double ceiling;  // Allocations per request allowed inside the arena
+    };
+    const Case cases[] = {
+        {"GET conversation messages", [&] {
+            httplib::Request req;
+            req.headers.emplace("Authorization", authorization);
+            req.path = "/api/conversations/" + conversation_id + "/messages";
+            std::regex_match(req.path, req.matches, messages_path);
+            httplib::Response res;
+            handlers.handle_get_messages(req, res);
+        }, 64},
+        {"GET conversations", [&] {
+            httplib::Request req;
+            req.headers.emplace("Authorization", authorization);
+            httplib::Response res;
+            handlers.handle_get_conversations(req, res);
+        }, 64},
+    };
+
+    int failures = 0;
+    for (const auto& test : cases) {
+        const double heap = allocations_per_request(false, test.request);
+        const double arena = allocations_per_request(true, test.request);
+        const bool passed = arena <= test.ceiling && arena * 10 <= heap;
+        std::printf("%-28s %9.1f without arena %7.1f with arena  %s\n", test.name, heap, arena,
+                    passed ? "ok" : "FAIL");
+        failures += passed ? 0 : 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,145 @@
+// Differential fuzz of the TextScanner kernels: every SIMD kernel this CPU
+// supports must agree with the scalar reference on random, piece-built and
+// mostly-valid input, plus a few fixed cases with known answers.
+#include "common/text_scanner.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kIterations = 200000;
+constexpr size_t kMaxLength = 360;
+
+const char* const kKernels[] = {"avx2", "ssse3"};
+
+// Code points picked to hit every encoded length, the control and blank ranges, and the edges
+// the validator has to reject (surrogates, overlongs, past U+10FFFF) once mutated
+const uint32_t kCodePoints[] = {
+    0x09, 0x0A, 0x0D, 0x1F, 0x20, 0x41, 0x7E, 0x7F, 0x80, 0x85, 0x9F, 0xA0, 0xE9, 0x7FF,
+    0x800, 0x0430, 0x1680, 0x2000, 0x200B, 0x2028, 0x3000, 0xD7FF, 0xE000, 0xFEFF, 0xFFFD,
+    0xFFFF, 0x10000, 0x1F600, 0x10FFFF
+};
+
+void append_utf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+std::string random_bytes(std::mt19937& rng, size_t length) {
+    std::string text(length, '\0');
+    for (auto& c : text) {
+        c = static_cast<char>(rng() & 0xFF);
+    }
+    return text;
+}
+
+std::string piece_built(std::mt19937& rng, size_t length) {
+    std::string text;
+    while (text.size() < length) {
+        append_utf8(text, kCodePoints[rng() % std::size(kCodePoints)]);
+    }
+    return text;
+}
+
+std::string mostly_valid(std::mt19937& rng, size_t length) {
+    std::string text = piece_built(rng, length);
+    if (!text.empty()) {
+        text[rng() % text.size()] = static_cast<char>(rng() & 0xFF);
+    }
+    return text;
+}
+
+bool same(const TextScanner::Result& a, const TextScanner::Result& b) {
+    if (a.valid_utf8 != b.valid_utf8) {
+        return false;
+    }
+    // The other fields are only meaningful for valid text
+    return !a.valid_utf8 || (a.has_control == b.has_control && a.all_whitespace == b.all_whitespace &&
+                             a.code_points == b.code_points);
+}
+
+std::string hex(const std::string& text) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (unsigned char c : text) {
+        out += digits[c >> 4];
+        out += digits[c & 0xF];
+    }
+    return out;
+}
+
+size_t failures = 0;
+
+void check(const char* kernel, const std::string& text, const TextScanner::Result& expected) {
+    auto result = TextScanner::scan_using(kernel, text);
+    if (result && !same(*result, expected)) {
+        if (++failures <= 10) {
+            std::printf("FAIL %s on %s: valid %d/%d control %d/%d blank %d/%d code points %zu/%zu\n", kernel,
+                        hex(text).c_str(), result->valid_utf8, expected.valid_utf8, result->has_control,
+                        expected.has_control, result->all_whitespace, expected.all_whitespace,
+                        result->code_points, expected.code_points);
+        }
+    }
+}
+
+void check_known(const std::string& text, bool valid, bool control, bool blank, size_t code_points) {
+    const TextScanner::Result expected{valid, control, blank, code_points};
+    check("scalar", text, expected);
+    for (const char* kernel : kKernels) {
+        check(kernel, text, expected);
+    }
+}
+
+} // namespace
+
+int main() {
+    check_known("", true, false, true, 0);
+    check_known("hello", true, false, false, 5);
+    check_known(" \t\r\n", true, false, true, 4);
+    check_known("caf\xC3\xA9", true, false, false, 4);
+    check_known("\xE2\x80\x8B\xEF\xBB\xBF", true, false, true, 2);     // ZWSP, BOM
+    check_known("a\x01", true, true, false, 2);
+    check_known("\xC2\x85", true, true, true, 1);                     // NEL: C1 control and White_Space
+    check_known("\xC0\xAF", false, false, false, 0);                  // overlong
+    check_known("\xED\xA0\x80", false, false, false, 0);              // surrogate
+    check_known("\xF4\x90\x80\x80", false, false, false, 0);          // past U+10FFFF
+    check_known(std::string(64, 'a') + "\xE2\x82", false, false, false, 0);  // truncated at a block edge
+
+    std::mt19937 rng(20261018);
+    using Generator = std::string (*)(std::mt19937&, size_t);
+    const Generator generators[] = {random_bytes, piece_built, mostly_valid};
+
+    size_t compared = 0;
+    for (size_t i = 0; i < kIterations; ++i) {
+        const std::string text = generators[i % std::size(generators)](rng, rng() % (kMaxLength + 1));
+        const TextScanner::Result expected = TextScanner::scan_scalar(text);
+        for (const char* kernel : kKernels) {
+            check(kernel, text, expected);
+        }
+        compared += same(TextScanner::scan(text), expected);
+    }
+
+    std::printf("text scanner (%s): %zu inputs, %zu agreed with scalar, %zu failures\n",
+                TextScanner::implementation(), kIterations, compared, failures);
+    for (const char* kernel : kKernels) {
+        if (!TextScanner::scan_using(kernel, "")) {
+            std::printf("  %s not available on this CPU, not checked\n", kernel);
+        }
+    }
+    return failures == 0 && compared == kIterations ? 0 : 1;
+}